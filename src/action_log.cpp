@@ -0,0 +1,375 @@
+#include "action_log.hpp"
+#include "persistence.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <iterator>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace {
+
+constexpr std::string_view magic = "TODOACT1";
+
+struct Writer
+{
+    std::string& out;
+
+    void operator()(std::uint64_t value)
+    {
+        while (value >= 0x80) {
+            out += static_cast<char>(value | 0x80);
+            value >>= 7;
+        }
+        out += static_cast<char>(value);
+    }
+    void operator()(std::int64_t value)
+    {
+        // Zigzag, so small negative numbers stay short
+        (*this)((static_cast<std::uint64_t>(value) << 1) ^
+                static_cast<std::uint64_t>(value >> 63));
+    }
+    void operator()(int value) { (*this)(static_cast<std::int64_t>(value)); }
+    void operator()(std::string_view text)
+    {
+        (*this)(static_cast<std::uint64_t>(text.size()));
+        out.append(text);
+    }
+    void operator()(const std::string& text)
+    {
+        (*this)(std::string_view(text));
+    }
+    void operator()(const Reminder& reminder)
+    {
+        (*this)(reminder.due);
+        (*this)(reminder.id);
+        (*this)(reminder.text);
+    }
+    void operator()(const std::vector<Reminder>& reminders)
+    {
+        (*this)(static_cast<std::uint64_t>(reminders.size()));
+        for (const auto& reminder : reminders)
+            (*this)(reminder);
+    }
+    void operator()(const std::vector<std::uint64_t>& values)
+    {
+        (*this)(static_cast<std::uint64_t>(values.size()));
+        for (auto value : values)
+            (*this)(value);
+    }
+    void operator()(const immer::vector<ListInfo>& lists)
+    {
+        (*this)(static_cast<std::uint64_t>(lists.size()));
+        for (const auto& list : lists) {
+            (*this)(list.name);
+            (*this)(list.items);
+            (*this)(list.done);
+        }
+    }
+    void operator()(const std::optional<AppState>& state)
+    {
+        (*this)(std::uint64_t{state.has_value()});
+        if (state) {
+            auto bytes = Persistence::encode_state(*state);
+            (*this)(std::string_view(
+                reinterpret_cast<const char*>(bytes.data()), bytes.size()));
+        }
+    }
+};
+
+// Reads what Writer wrote; a read past the end leaves `ok` false
+struct Reader
+{
+    std::string_view in;
+    bool ok = true;
+
+    void operator()(std::uint64_t& value)
+    {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (in.empty()) {
+                ok = false;
+                return;
+            }
+            auto byte = static_cast<std::uint8_t>(in.front());
+            in.remove_prefix(1);
+            value |= std::uint64_t{byte & 0x7fu} << shift;
+            if (!(byte & 0x80))
+                return;
+        }
+        ok = false;
+    }
+    void operator()(std::int64_t& value)
+    {
+        std::uint64_t zigzag = 0;
+        (*this)(zigzag);
+        value = static_cast<std::int64_t>(zigzag >> 1) ^
+                -static_cast<std::int64_t>(zigzag & 1);
+    }
+    void operator()(int& value)
+    {
+        std::int64_t wide = 0;
+        (*this)(wide);
+        value = static_cast<int>(wide);
+    }
+    void operator()(std::string_view& text)
+    {
+        std::uint64_t size = 0;
+        (*this)(size);
+        if (!ok || size > in.size()) {
+            ok = false;
+            return;
+        }
+        text = in.substr(0, size);
+        in.remove_prefix(size);
+    }
+    void operator()(std::string& text)
+    {
+        std::string_view view;
+        (*this)(view);
+        text.assign(view);
+    }
+    void operator()(Reminder& reminder)
+    {
+        (*this)(reminder.due);
+        (*this)(reminder.id);
+        (*this)(reminder.text);
+    }
+    void operator()(std::vector<Reminder>& reminders)
+    {
+        std::uint64_t size = 0;
+        (*this)(size);
+        reminders.clear();
+        for (std::uint64_t i = 0; ok && i < size; ++i) {
+            Reminder reminder;
+            (*this)(reminder);
+            reminders.push_back(std::move(reminder));
+        }
+    }
+    void operator()(std::vector<std::uint64_t>& values)
+    {
+        std::uint64_t size = 0;
+        (*this)(size);
+        values.clear();
+        for (std::uint64_t i = 0; ok && i < size; ++i) {
+            std::uint64_t value = 0;
+            (*this)(value);
+            values.push_back(value);
+        }
+    }
+    void operator()(immer::vector<ListInfo>& lists)
+    {
+        std::uint64_t size = 0;
+        (*this)(size);
+        std::vector<ListInfo> read;
+        for (std::uint64_t i = 0; ok && i < size; ++i) {
+            ListInfo list;
+            (*this)(list.name);
+            (*this)(list.items);
+            (*this)(list.done);
+            read.push_back(std::move(list));
+        }
+        lists = immer::vector<ListInfo>(read.begin(), read.end());
+    }
+    void operator()(std::optional<AppState>& state)
+    {
+        std::uint64_t present = 0;
+        (*this)(present);
+        std::string_view bytes;
+        if (present)
+            (*this)(bytes);
+        if (ok && present) {
+            state = Persistence::decode_state(bytes);
+            ok    = state.has_value();
+        }
+    }
+};
+
+// The fields of an action in the order they are logged, for both
+// directions: `io` is a Writer or a Reader.
+template <typename IO, typename A>
+void transfer(IO& io, A& action)
+{
+    using T = std::remove_const_t<A>;
+    if constexpr (std::is_same_v<T, SetInputTextAction>) {
+        io(action.text);
+    } else if constexpr (std::is_same_v<T, SelectTodoAction> ||
+                         std::is_same_v<T, MarkTodoAction> ||
+                         std::is_same_v<T, SetMarkAnchorAction>) {
+        io(action.index);
+    } else if constexpr (std::is_same_v<T, SelectTodoByIdAction>) {
+        io(action.id);
+        io(action.at);
+    } else if constexpr (std::is_same_v<T, FocusColumnAction>) {
+        io(action.column);
+    } else if constexpr (std::is_same_v<T, MoveTodoAction>) {
+        io(action.from);
+        io(action.to);
+    } else if constexpr (std::is_same_v<T, MoveRangeAction>) {
+        io(action.begin);
+        io(action.end);
+        io(action.to);
+    } else if constexpr (std::is_same_v<T, MarkRangeAction>) {
+        io(action.begin);
+        io(action.end);
+    } else if constexpr (std::is_same_v<T, MoveColumnItemAction>) {
+        io(action.from_column);
+        io(action.index);
+        io(action.to_column);
+        io(action.to_index);
+    } else if constexpr (std::is_same_v<T, ToggleSelectedTodoAction> ||
+                         std::is_same_v<T, ToggleMarkedAction> ||
+                         std::is_same_v<T, ArchiveDoneAction>) {
+        io(action.now);
+    } else if constexpr (std::is_same_v<T, SetDueAction>) {
+        io(action.due);
+    } else if constexpr (std::is_same_v<T, SetPriorityAction>) {
+        io(action.priority);
+    } else if constexpr (std::is_same_v<T, ReminderDueAction>) {
+        io(action.reminder);
+    } else if constexpr (std::is_same_v<T, LoadCompleteAction>) {
+        io(action.loaded_state);
+        io(action.message);
+    } else if constexpr (std::is_same_v<T, OpenListAction>) {
+        io(action.name);
+        io(action.select_id);
+    } else if constexpr (std::is_same_v<T, ListOpenedAction>) {
+        io(action.name);
+        io(action.lists);
+        io(action.loaded_state);
+        io(action.message);
+        io(action.select_id);
+    } else if constexpr (std::is_same_v<T, ArchivedAction>) {
+        io(action.list);
+        io(action.ids);
+    } else if constexpr (std::is_same_v<T, ListMergedAction>) {
+        io(action.list);
+        io(action.saved);
+        io(action.merged);
+        io(action.reminders);
+    } else if constexpr (std::is_same_v<T, ListChangedOnDiskAction>) {
+        io(action.list);
+        io(action.before);
+        io(action.after);
+        io(action.reminders);
+    } else if constexpr (std::is_same_v<T, ChangeMergedAction>) {
+        io(action.list);
+        io(action.before);
+        io(action.after);
+        io(action.edited);
+        io(action.merged);
+        io(action.reminders);
+    } else if constexpr (std::is_same_v<T, SetStatusAction>) {
+        io(action.message);
+    } else {
+        static_assert(std::is_empty_v<T>, "Fields of the action not logged");
+    }
+}
+
+// The alternative of Action at `index`, default constructed
+template <std::size_t... I>
+Action make_action(std::size_t index, std::index_sequence<I...>)
+{
+    Action action;
+    ((index == I ? (action.emplace<I>(), true) : false) || ...);
+    return action;
+}
+
+} // namespace
+
+ActionRecorder::ActionRecorder(const std::filesystem::path& path,
+                               const AppState& initial_state)
+    : out_(path, std::ios::binary | std::ios::trunc)
+    , last_(std::chrono::steady_clock::now())
+{
+    auto state = Persistence::encode_state(initial_state);
+    Writer writer{record_};
+    record_.append(magic);
+    writer(std::string_view(reinterpret_cast<const char*>(state.data()),
+                            state.size()));
+    out_.write(record_.data(), static_cast<std::streamsize>(record_.size()));
+}
+
+void ActionRecorder::record(const Action& action)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto now = std::chrono::steady_clock::now();
+    auto delay =
+        std::chrono::duration_cast<std::chrono::microseconds>(now - last_);
+    last_ = now;
+    write(action, delay);
+}
+
+void ActionRecorder::record(const Action& action,
+                            std::chrono::microseconds delay)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    write(action, delay);
+}
+
+void ActionRecorder::write(const Action& action,
+                           std::chrono::microseconds delay)
+{
+    record_.clear();
+    Writer writer{record_};
+    writer(static_cast<std::int64_t>(delay.count()));
+    writer(static_cast<std::uint64_t>(action.index()));
+    std::visit([&](const auto& alternative) { transfer(writer, alternative); },
+               action);
+    out_.write(record_.data(), static_cast<std::streamsize>(record_.size()));
+}
+
+void record_action(ActionRecorder& recorder, const Action& action)
+{
+    recorder.record(action);
+}
+
+std::optional<ActionLog> read_action_log(const std::filesystem::path& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        spdlog::error("Could not open action log {}", path.string());
+        return std::nullopt;
+    }
+    const std::string contents{std::istreambuf_iterator<char>(in),
+                               std::istreambuf_iterator<char>()};
+    Reader reader{contents};
+    if (reader.in.substr(0, magic.size()) != magic) {
+        spdlog::error("{} is not an action log", path.string());
+        return std::nullopt;
+    }
+    reader.in.remove_prefix(magic.size());
+
+    std::string_view state;
+    reader(state);
+    auto initial_state =
+        reader.ok ? Persistence::decode_state(state) : std::nullopt;
+    if (!initial_state) {
+        spdlog::error("Action log {} has no valid initial state",
+                      path.string());
+        return std::nullopt;
+    }
+
+    ActionLog log{std::move(*initial_state), {}};
+    while (!reader.in.empty()) {
+        RecordedAction recorded;
+        std::uint64_t index = 0;
+        reader(recorded.delay_us);
+        reader(index);
+        if (!reader.ok || index >= std::variant_size_v<Action>)
+            break;
+        recorded.action = make_action(
+            index, std::make_index_sequence<std::variant_size_v<Action>>{});
+        std::visit([&](auto& alternative) { transfer(reader, alternative); },
+                   recorded.action);
+        if (!reader.ok)
+            break;
+        log.actions.push_back(std::move(recorded));
+    }
+    if (!reader.ok || !reader.in.empty())
+        spdlog::warn("Action log {} is cut short after {} actions",
+                     path.string(),
+                     log.actions.size());
+    return log;
+}
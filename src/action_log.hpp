@@ -0,0 +1,61 @@
+#pragma once
+
+#include "state.hpp" // Action, AppState
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Recorded sessions: every action the reducer was given and when, in a
+// compact binary file, to replay a real session against later builds
+// (tui_app --replay).
+//
+// The file starts with "TODOACT1" and the state the session started from
+// (as CBOR, length first). Then one record per action: the microseconds
+// since the previous one, the action's index in Action, and its fields in
+// declaration order. Integers are varints (signed ones zigzag encoded),
+// strings are their length followed by their bytes.
+
+class ActionRecorder
+{
+public:
+    // Truncates `path`; see ok()
+    ActionRecorder(const std::filesystem::path& path,
+                   const AppState& initial_state);
+
+    bool ok() const { return static_cast<bool>(out_); }
+
+    // Thread-safe.
+    void record(const Action& action);
+    // With a made-up time since the previous action (generated sessions)
+    void record(const Action& action, std::chrono::microseconds delay);
+
+private:
+    void write(const Action& action, std::chrono::microseconds delay);
+
+    std::mutex mutex_;
+    std::ofstream out_;
+    std::chrono::steady_clock::time_point last_;
+    std::string record_; // Reused for encoding
+};
+
+struct RecordedAction
+{
+    std::int64_t delay_us = 0; // Since the previous action
+    Action action;
+};
+
+struct ActionLog
+{
+    AppState initial_state;
+    std::vector<RecordedAction> actions;
+};
+
+// Nullopt, with the reason logged, if the file isn't an action log. A log
+// cut short (the app crashed) gives the actions before the cut.
+std::optional<ActionLog> read_action_log(const std::filesystem::path& path);
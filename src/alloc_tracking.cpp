@@ -0,0 +1,242 @@
+#include "alloc_tracking.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace alloc_tracking_detail {
+thread_local AllocPhase current_phase = AllocPhase::Other;
+thread_local int current_action       = -1;
+} // namespace alloc_tracking_detail
+
+namespace {
+
+// Constant-initialized, so they count from before main() on
+struct AtomicCounts
+{
+    std::atomic<std::uint64_t> allocations{0};
+    std::atomic<std::uint64_t> frees{0};
+    std::atomic<std::uint64_t> bytes{0};
+
+    AllocCounts load() const
+    {
+        return {allocations.load(std::memory_order_relaxed),
+                frees.load(std::memory_order_relaxed),
+                bytes.load(std::memory_order_relaxed)};
+    }
+};
+
+AtomicCounts phase_counts[alloc_phase_count];
+AtomicCounts action_counts[max_tracked_actions];
+
+AllocReport frame_start;
+AllocReport last_frame;
+
+void count(bool allocation, std::size_t size)
+{
+    using namespace alloc_tracking_detail;
+    AtomicCounts* counts[] = {&phase_counts[static_cast<int>(current_phase)],
+                              nullptr};
+    if (current_phase == AllocPhase::Reduce && current_action >= 0 &&
+        current_action < max_tracked_actions)
+        counts[1] = &action_counts[current_action];
+    for (auto* c : counts) {
+        if (!c)
+            continue;
+        if (allocation) {
+            c->allocations.fetch_add(1, std::memory_order_relaxed);
+            c->bytes.fetch_add(size, std::memory_order_relaxed);
+        } else {
+            c->frees.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+} // namespace
+
+const char* alloc_phase_name(AllocPhase phase)
+{
+    switch (phase) {
+    case AllocPhase::Input:
+        return "input";
+    case AllocPhase::Reduce:
+        return "reduce";
+    case AllocPhase::Render:
+        return "render";
+    case AllocPhase::Draw:
+        return "draw";
+    default:
+        return "other";
+    }
+}
+
+AllocCounts& AllocCounts::operator+=(const AllocCounts& other)
+{
+    allocations += other.allocations;
+    frees += other.frees;
+    bytes += other.bytes;
+    return *this;
+}
+
+AllocCounts& AllocCounts::operator-=(const AllocCounts& other)
+{
+    allocations -= other.allocations;
+    frees -= other.frees;
+    bytes -= other.bytes;
+    return *this;
+}
+
+AllocCounts AllocReport::total() const
+{
+    AllocCounts total;
+    for (const auto& counts : phases)
+        total += counts;
+    return total;
+}
+
+AllocReport& AllocReport::operator-=(const AllocReport& other)
+{
+    for (int i = 0; i < alloc_phase_count; ++i)
+        phases[i] -= other.phases[i];
+    for (int i = 0; i < max_tracked_actions; ++i)
+        actions[i] -= other.actions[i];
+    return *this;
+}
+
+AllocReport alloc_totals()
+{
+    AllocReport report;
+    for (int i = 0; i < alloc_phase_count; ++i)
+        report.phases[i] = phase_counts[i].load();
+    for (int i = 0; i < max_tracked_actions; ++i)
+        report.actions[i] = action_counts[i].load();
+    return report;
+}
+
+void alloc_count(bool allocation, std::size_t size)
+{
+    count(allocation, size);
+}
+
+void alloc_frame_begin()
+{
+    frame_start = alloc_totals();
+}
+
+void alloc_frame_end()
+{
+    last_frame = alloc_totals();
+    last_frame -= frame_start;
+}
+
+const AllocReport& last_alloc_frame()
+{
+    return last_frame;
+}
+
+#ifdef TUI_TODO_ALLOC_TRACKING
+
+// --- Replacements of the global allocation functions ---
+// Counting only touches atomics and thread-locals of trivial types, so it
+// never allocates itself.
+
+namespace {
+
+void* allocate(std::size_t size)
+{
+    count(true, size);
+    if (void* data = std::malloc(size ? size : 1))
+        return data;
+    throw std::bad_alloc();
+}
+
+void* allocate(std::size_t size, std::align_val_t align)
+{
+    count(true, size);
+    auto alignment = static_cast<std::size_t>(align);
+    // aligned_alloc wants a multiple of the alignment
+    auto rounded =
+        std::max(alignment, (size + alignment - 1) / alignment * alignment);
+    if (void* data = std::aligned_alloc(alignment, rounded))
+        return data;
+    throw std::bad_alloc();
+}
+
+void release(void* data)
+{
+    if (!data)
+        return;
+    count(false, 0);
+    std::free(data);
+}
+
+} // namespace
+
+void* operator new(std::size_t size)
+{
+    return allocate(size);
+}
+void* operator new[](std::size_t size)
+{
+    return allocate(size);
+}
+void* operator new(std::size_t size, std::align_val_t align)
+{
+    return allocate(size, align);
+}
+void* operator new[](std::size_t size, std::align_val_t align)
+{
+    return allocate(size, align);
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    try {
+        return allocate(size);
+    } catch (const std::bad_alloc&) {
+        return nullptr;
+    }
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    try {
+        return allocate(size);
+    } catch (const std::bad_alloc&) {
+        return nullptr;
+    }
+}
+
+void operator delete(void* data) noexcept
+{
+    release(data);
+}
+void operator delete[](void* data) noexcept
+{
+    release(data);
+}
+void operator delete(void* data, std::size_t) noexcept
+{
+    release(data);
+}
+void operator delete[](void* data, std::size_t) noexcept
+{
+    release(data);
+}
+void operator delete(void* data, std::align_val_t) noexcept
+{
+    release(data);
+}
+void operator delete[](void* data, std::align_val_t) noexcept
+{
+    release(data);
+}
+void operator delete(void* data, std::size_t, std::align_val_t) noexcept
+{
+    release(data);
+}
+void operator delete[](void* data, std::size_t, std::align_val_t) noexcept
+{
+    release(data);
+}
+
+#endif
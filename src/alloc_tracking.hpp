@@ -0,0 +1,112 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Counts of heap allocations, attributed to the part of the frame (and the
+// action being reduced) that made them. Only built with
+// -DTUI_TODO_ALLOC_TRACKING=ON, which replaces the global operator new and
+// delete; otherwise the scopes below compile to nothing and all counts stay
+// zero. Blocks handed out by the MemoryPool count as allocations too, though
+// most never reach operator new.
+//
+// The steady state of the UI (a frame with no input and nothing due) is
+// meant to allocate nothing: this is how that is checked, by
+// `tui_app --frame-bench` and by the allocations panel (M) in the app.
+
+#ifdef TUI_TODO_ALLOC_TRACKING
+constexpr bool alloc_tracking_enabled = true;
+#else
+constexpr bool alloc_tracking_enabled = false;
+#endif
+
+// Parts of a frame
+enum class AllocPhase
+{
+    Other, // Anything outside a frame, e.g. effects and worker threads
+    Input, // Polling the terminal, firing reminders
+    Reduce,
+    Render, // Building the ImGui frame
+    Draw,   // Rasterizing it and writing it to the terminal
+};
+constexpr int alloc_phase_count = 5;
+
+const char* alloc_phase_name(AllocPhase phase);
+
+struct AllocCounts
+{
+    std::uint64_t allocations = 0;
+    std::uint64_t frees       = 0;
+    std::uint64_t bytes       = 0; // Allocated
+
+    AllocCounts& operator+=(const AllocCounts& other);
+    AllocCounts& operator-=(const AllocCounts& other);
+};
+
+// Action types are told apart by their index in the Action variant
+constexpr int max_tracked_actions = 64;
+
+struct AllocReport
+{
+    std::array<AllocCounts, alloc_phase_count> phases{};
+    std::array<AllocCounts, max_tracked_actions> actions{}; // While reducing
+
+    const AllocCounts& phase(AllocPhase phase) const
+    {
+        return phases[static_cast<int>(phase)];
+    }
+    AllocCounts total() const;
+    AllocReport& operator-=(const AllocReport& other);
+};
+
+// Counts one allocation of `size` bytes, or one free, for allocators that
+// don't go through operator new.
+void alloc_count(bool allocation, std::size_t size);
+
+// Everything counted since the start, by all threads.
+AllocReport alloc_totals();
+
+// Frames are what happened between a begin and the next end. Both, and
+// last_alloc_frame(), belong to the UI thread.
+void alloc_frame_begin();
+void alloc_frame_end();
+const AllocReport& last_alloc_frame();
+
+namespace alloc_tracking_detail {
+extern thread_local AllocPhase current_phase;
+extern thread_local int current_action;
+} // namespace alloc_tracking_detail
+
+// Attributes what the current thread allocates to `phase` (and `action`, an
+// index into the Action variant) until it goes out of scope.
+class AllocPhaseScope
+{
+public:
+    explicit AllocPhaseScope(AllocPhase phase, int action = -1)
+    {
+        if constexpr (alloc_tracking_enabled) {
+            using namespace alloc_tracking_detail;
+            previous_phase_  = current_phase;
+            previous_action_ = current_action;
+            current_phase    = phase;
+            if (action >= 0)
+                current_action = action;
+        }
+    }
+    ~AllocPhaseScope()
+    {
+        if constexpr (alloc_tracking_enabled) {
+            using namespace alloc_tracking_detail;
+            current_phase  = previous_phase_;
+            current_action = previous_action_;
+        }
+    }
+
+    AllocPhaseScope(const AllocPhaseScope&)            = delete;
+    AllocPhaseScope& operator=(const AllocPhaseScope&) = delete;
+
+private:
+    AllocPhase previous_phase_ = AllocPhase::Other;
+    int previous_action_       = -1;
+};
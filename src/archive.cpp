@@ -0,0 +1,102 @@
+#include "archive.hpp"
+#include "persistence.hpp"
+#include "record_file.hpp"
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+
+namespace {
+
+constexpr RecordFile::Format format = {"TODOARC1", {}, 36, 8};
+
+using RecordFile::Ending;
+
+std::vector<Archive::Segment> scan(const std::filesystem::path& path,
+                                   std::uint64_t& end,
+                                   Ending& ending)
+{
+    std::vector<Archive::Segment> found;
+    ending = RecordFile::scan(
+        path, format, end, [&](const auto& record, const char* header) {
+            Archive::Segment segment;
+            segment.offset      = record.offset;
+            segment.packed_size = record.packed_size;
+            segment.size        = record.size;
+            segment.items       = static_cast<std::uint32_t>(
+                RecordFile::get(header + 16, 4));
+            segment.first_done = static_cast<std::int64_t>(
+                RecordFile::get(header + 20, 8));
+            segment.last_done = static_cast<std::int64_t>(
+                RecordFile::get(header + 28, 8));
+            found.push_back(segment);
+        });
+    return found;
+}
+
+} // namespace
+
+namespace Archive {
+
+std::vector<Segment> segments(const std::filesystem::path& path)
+{
+    std::uint64_t end = 0;
+    Ending ending;
+    return scan(path, end, ending);
+}
+
+std::optional<TodoList> read(const std::filesystem::path& path,
+                             const Segment& segment)
+{
+    auto bytes = RecordFile::read(
+        path, format, {segment.offset, segment.packed_size, segment.size});
+    if (!bytes)
+        return std::nullopt;
+    auto state = Persistence::decode_state(*bytes);
+    if (!state)
+        return std::nullopt;
+    return state->todos;
+}
+
+bool append(const std::filesystem::path& path,
+            const std::vector<TodoItem>& items)
+{
+    std::uint64_t end = 0;
+    Ending ending;
+    scan(path, end, ending);
+
+    std::string records;
+    std::string fields;
+    for (std::size_t begin = 0; begin < items.size();
+         begin += segment_items) {
+        auto last = items.begin() +
+                    std::min(begin + segment_items, items.size());
+        AppState chunk;
+        chunk.todos   = TodoList(items.begin() + begin, last);
+        chunk.columns = {};
+
+        auto [oldest, newest] = std::minmax_element(
+            items.begin() + begin, last, [](auto& a, auto& b) {
+                return a.done_at < b.done_at;
+            });
+
+        auto bytes = Persistence::encode_state(chunk);
+        fields.clear();
+        RecordFile::put(fields, chunk.todos.size(), 4);
+        RecordFile::put(
+            fields, static_cast<std::uint64_t>(oldest->done_at), 8);
+        RecordFile::put(
+            fields, static_cast<std::uint64_t>(newest->done_at), 8);
+        RecordFile::frame(
+            records,
+            end,
+            format,
+            format.magic,
+            fields,
+            std::string_view(reinterpret_cast<const char*>(bytes.data()),
+                             bytes.size()));
+    }
+    return RecordFile::append(path, end, ending, records);
+}
+
+} // namespace Archive
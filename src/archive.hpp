@@ -0,0 +1,51 @@
+#pragma once
+
+#include "state.hpp" // TodoItem, TodoList
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+// The cold tier of a list: done items old enough to be out of the way,
+// moved out of "<name>.json" into "<name>.archive" next to it. The file is
+// only ever appended to, and is never read when the list is loaded; the
+// archive view reads it a segment at a time.
+//
+// Each segment is a header followed by its items, in the list file's format
+// (as CBOR), compressed with the LZ codec. The header is "TODOARC1", the
+// size of the items packed and unpacked (u32), how many there are (u32),
+// and the oldest and newest time one was done (i64, seconds since the
+// epoch), all little-endian; the segments of a file can be listed by reading
+// headers alone.
+namespace Archive {
+
+// Items per segment, so that one can be read without waiting
+constexpr std::size_t segment_items = 4096;
+
+struct Segment
+{
+    std::uint64_t offset      = 0; // Of its header in the file
+    std::uint32_t packed_size = 0;
+    std::uint32_t size        = 0;
+    std::uint32_t items       = 0;
+    std::int64_t first_done   = 0;
+    std::int64_t last_done    = 0;
+};
+
+// The segments of the file, oldest first; none if it doesn't exist. A
+// segment cut short (the app stopped while appending) or a damaged header
+// ends the list.
+std::vector<Segment> segments(const std::filesystem::path& path);
+
+// The items of one segment; nullopt if it can't be read
+std::optional<TodoList> read(const std::filesystem::path& path,
+                             const Segment& segment);
+
+// Appends `items` as new segments. A segment cut short at the end of the
+// file is dropped first; if a header before that is damaged nothing is
+// appended (and false returned), so the segments after it aren't lost.
+bool append(const std::filesystem::path& path,
+            const std::vector<TodoItem>& items);
+
+} // namespace Archive
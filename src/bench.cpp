@@ -0,0 +1,668 @@
+// Micro-benchmarks of the app's hot paths on synthetic lists, without the UI.
+//
+//   tui_bench [items]
+//
+// Tag filters: the column-wise bitmask kernels against the naive way of
+// answering the same query, scanning every item's text for the tags.
+//
+// Fuzzy finder: prefiltered, parallel search against scoring every item on
+// one thread.
+//
+// Interning: memory of item texts made from templates, one std::string per
+// item against one shared copy per distinct text.
+//
+// Memory pool: building and dropping a big list with the pooled nodes
+// against immer's default heap.
+//
+// List search: the case-insensitive substring kernel over a list file's
+// worth of text, against lowering a copy and searching that.
+//
+// Snapshots: saving and loading a list as JSON against compressed, with
+// the size of each file.
+//
+// Merging: two replicas of a list that were edited apart (see replica.hpp),
+// the time to turn each one's edits into ops and to apply the other's, and
+// what the merge costs in memory and on disk.
+
+#include "fuzzy.hpp"
+#include "interned_string.hpp"
+#include "list_search.hpp"
+#include "memory_pool.hpp"
+#include "persistence.hpp"
+#include "replica.hpp"
+#include "state.hpp"
+#include "tags.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+// Best of a few runs, in milliseconds
+template <typename Fn>
+double time_ms(Fn&& fn, int runs = 5)
+{
+    double best = 1e300;
+    for (int run = 0; run < runs; ++run) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        std::chrono::duration<double, std::milli> elapsed =
+            std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+TodoList make_tagged_list(std::size_t count,
+                          const std::vector<std::string>& tags)
+{
+    std::mt19937 rng(42);
+    // Skewed, like real tags: a few are everywhere, most are rare
+    std::discrete_distribution<int> pick_tag(
+        tags.size(), 0.0, double(tags.size()), [](double x) {
+            return 1.0 / (1.0 + x);
+        });
+    std::uniform_int_distribution<int> tags_per_item(0, 4);
+
+    auto items = TodoList{}.transient();
+    for (std::size_t i = 0; i < count; ++i) {
+        TodoItem item;
+        item.id          = i + 1;
+        std::string text = "Task number " + std::to_string(i);
+        for (int t = tags_per_item(rng); t > 0; --t)
+            text += " " + tags[pick_tag(rng)];
+        item.text = text;
+        item.tags = parse_tags(text);
+        items.push_back(std::move(item));
+    }
+    return items.persistent();
+}
+
+// --- Naive scan: string compares on every item ---
+bool text_has_tag(std::string_view text, std::string_view tag)
+{
+    for (auto at = text.find(tag); at != std::string_view::npos;
+         at = text.find(tag, at + 1)) {
+        auto end         = at + tag.size();
+        bool starts_word = at == 0 || text[at - 1] == ' ';
+        bool ends_word   = end == text.size() || text[end] == ' ';
+        if (starts_word && ends_word)
+            return true;
+    }
+    return false;
+}
+
+struct NaiveTerm
+{
+    bool negated = false;
+    std::vector<std::string> alternatives;
+};
+
+// Same syntax as parse_tag_query, sigils required
+std::vector<NaiveTerm> parse_naive(std::string_view query)
+{
+    std::vector<NaiveTerm> terms;
+    std::size_t i = 0;
+    while (i < query.size()) {
+        auto end = query.find(' ', i);
+        if (end == std::string_view::npos)
+            end = query.size();
+        std::string_view word = query.substr(i, end - i);
+        i                     = end + 1;
+        if (word.empty())
+            continue;
+        NaiveTerm term;
+        term.negated = word[0] == '-';
+        if (term.negated)
+            word.remove_prefix(1);
+        while (!word.empty()) {
+            auto bar = word.find('|');
+            term.alternatives.emplace_back(word.substr(0, bar));
+            word = bar == std::string_view::npos ? std::string_view{}
+                                                 : word.substr(bar + 1);
+        }
+        terms.push_back(std::move(term));
+    }
+    return terms;
+}
+
+std::size_t naive_count(const TodoList& items, std::string_view query)
+{
+    auto terms        = parse_naive(query);
+    std::size_t count = 0;
+    for (const auto& item : items) {
+        bool ok = true;
+        for (const auto& term : terms) {
+            bool any = std::any_of(
+                term.alternatives.begin(),
+                term.alternatives.end(),
+                [&](const std::string& tag) {
+                    return text_has_tag(item.text, tag);
+                });
+            if (any == term.negated) {
+                ok = false;
+                break;
+            }
+        }
+        count += ok;
+    }
+    return count;
+}
+
+int bench_tag_filter(std::size_t count)
+{
+    std::vector<std::string> tags;
+    for (int i = 0; i < 96; ++i)
+        tags.push_back((i % 2 ? "#tag" : "@tag") + std::to_string(i));
+    std::printf("Tag filter over %zu items, %zu tags (AVX2 kernel: %s)\n",
+                count,
+                tags.size(),
+                tag_filter_vectorized() ? "yes" : "no");
+
+    TodoList items = make_tagged_list(count, tags);
+    TagColumns columns;
+    double gather_ms = time_ms([&] {
+        columns.assign(items, [](const TodoItem& item) { return item.tags; });
+    });
+    std::printf("  gathering mask columns: %.2f ms\n\n", gather_ms);
+
+    const char* queries[] = {
+        "@tag0",
+        "@tag0 #tag1",
+        "#tag3|#tag5|@tag90",
+        "@tag0 -#tag1",
+        "#tag1 @tag2|@tag4 -#tag7 -@tag8",
+        "#tag95",
+    };
+
+    std::printf("  %-34s %9s %10s %10s %10s %8s\n",
+                "query",
+                "matches",
+                "naive ms",
+                "scalar ms",
+                "filter ms",
+                "speedup");
+    int failures = 0;
+    std::vector<std::uint32_t> selection;
+    for (const char* text : queries) {
+        std::size_t expected = 0;
+        double naive_ms = time_ms([&] { expected = naive_count(items, text); },
+                                  1);
+        TagQuery query  = parse_tag_query(text);
+        double scalar_ms =
+            time_ms([&] { select_matching_scalar(columns, query, selection); });
+        std::size_t scalar_matches = selection.size();
+        double filter_ms =
+            time_ms([&] { select_matching(columns, query, selection); });
+
+        std::printf("  %-34s %9zu %10.2f %10.3f %10.3f %7.0fx\n",
+                    text,
+                    selection.size(),
+                    naive_ms,
+                    scalar_ms,
+                    filter_ms,
+                    naive_ms / std::max(filter_ms, 1e-6));
+        if (selection.size() != expected || scalar_matches != expected) {
+            std::printf("  MISMATCH: naive scan found %zu\n", expected);
+            ++failures;
+        }
+    }
+    return failures;
+}
+
+// Top `k` of every item scored in order, the way the finder ranks them
+std::vector<FuzzyMatch>
+naive_fuzzy(const TodoList& items, const std::string& pattern, std::size_t k)
+{
+    std::vector<FuzzyMatch> matches;
+    std::uint32_t index = 0;
+    for (const auto& item : items) {
+        if (auto score = fuzzy_score(pattern, item.text))
+            matches.push_back({*score, index, item.id, item.text});
+        ++index;
+    }
+    auto better = [](const FuzzyMatch& a, const FuzzyMatch& b) {
+        return a.score != b.score ? a.score > b.score : a.index < b.index;
+    };
+    std::sort(matches.begin(), matches.end(), better);
+    matches.resize(std::min(matches.size(), k));
+    return matches;
+}
+
+int bench_fuzzy(std::size_t count)
+{
+    std::vector<std::string> tags;
+    for (int i = 0; i < 96; ++i)
+        tags.push_back((i % 2 ? "#tag" : "@tag") + std::to_string(i));
+    TodoList items = make_tagged_list(count, tags);
+
+    ThreadPool pool;
+    FuzzyFinder finder{pool};
+    std::printf("\nFuzzy finder over %zu items, %u threads\n",
+                count,
+                pool.size());
+    auto search = [&](const std::string& pattern) {
+        finder.search(items, pattern);
+        while (!finder.results().done())
+            std::this_thread::yield();
+        return finder.results();
+    };
+    // The first search also builds the byte masks
+    double masks_ms = time_ms([&] { search("x"); }, 1);
+    std::printf("  first search, building masks: %.2f ms\n\n", masks_ms);
+
+    const char* patterns[] = {"tnum9", "task 12345", "tag7", "zq", "n#t95"};
+    std::printf("  %-34s %9s %10s %10s %8s\n",
+                "pattern",
+                "top",
+                "naive ms",
+                "finder ms",
+                "speedup");
+    int failures = 0;
+    for (const char* pattern : patterns) {
+        std::vector<FuzzyMatch> expected;
+        double naive_ms =
+            time_ms([&] { expected = naive_fuzzy(items, pattern, 50); }, 1);
+        FuzzyResults results;
+        double finder_ms = time_ms([&] { results = search(pattern); });
+
+        std::printf("  %-34s %9zu %10.2f %10.3f %7.0fx\n",
+                    pattern,
+                    results.matches.size(),
+                    naive_ms,
+                    finder_ms,
+                    naive_ms / std::max(finder_ms, 1e-6));
+        bool same = results.matches.size() == expected.size();
+        for (std::size_t i = 0; same && i < expected.size(); ++i) {
+            same = results.matches[i].index == expected[i].index &&
+                   results.matches[i].score == expected[i].score;
+        }
+        if (!same) {
+            std::printf("  MISMATCH: naive scan found a different top %zu\n",
+                        expected.size());
+            ++failures;
+        }
+    }
+    return failures;
+}
+
+// Memory of a std::string holding `text`, including what's inside it
+std::size_t string_bytes(const std::string& text)
+{
+    const char* inside = reinterpret_cast<const char*>(&text);
+    bool local = text.data() >= inside && text.data() < inside + sizeof(text);
+    return sizeof(text) + (local ? 0 : text.capacity() + 1);
+}
+
+int bench_interning(std::size_t count)
+{
+    // Recurring chores and items made from templates: a few hundred texts,
+    // some much more common than others
+    const char* verbs[]   = {"Review", "Deploy", "Water", "Renew", "Check",
+                             "Update", "Clean", "Back up", "Rotate", "Pay"};
+    const char* objects[] = {"the staging cluster certificates",
+                             "pull requests for the release train",
+                             "the plants in the meeting room",
+                             "on-call handover notes",
+                             "monthly infrastructure invoices",
+                             "dependency versions in the lockfiles",
+                             "the shared calendar for next week",
+                             "database snapshots older than 30 days"};
+    std::vector<std::string> templates;
+    for (const char* verb : verbs) {
+        for (const char* object : objects) {
+            for (int n = 0; n < 4; ++n)
+                templates.push_back(std::string(verb) + " " + object +
+                                    (n ? " #" + std::to_string(n) : ""));
+        }
+    }
+    std::mt19937 rng(7);
+    std::geometric_distribution<std::size_t> pick(0.02);
+
+    std::vector<std::string> plain;
+    std::size_t plain_bytes = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        plain.push_back(templates[pick(rng) % templates.size()]);
+        plain_bytes += string_bytes(plain.back());
+    }
+
+    auto before = InternedString::stats();
+    std::vector<InternedString> interned;
+    double intern_ms = time_ms(
+        [&] {
+            interned.clear();
+            interned.reserve(count);
+            for (const auto& text : plain)
+                interned.emplace_back(text);
+        },
+        1);
+    auto after = InternedString::stats();
+    std::size_t interned_bytes = count * sizeof(InternedString) +
+                                 (after.bytes - before.bytes);
+
+    std::unordered_set<std::string> distinct(plain.begin(), plain.end());
+    std::printf("\nInterning %zu texts from templates, %zu distinct\n",
+                count,
+                distinct.size());
+    std::printf("  std::string per item: %8.1f MiB\n",
+                plain_bytes / 1048576.0);
+    std::printf("  interned:             %8.1f MiB (%.1fx less), %.2f ms\n",
+                interned_bytes / 1048576.0,
+                double(plain_bytes) / double(interned_bytes),
+                intern_ms);
+    if (after.strings - before.strings != distinct.size()) {
+        std::printf("  MISMATCH: %zu strings interned\n",
+                    after.strings - before.strings);
+        return 1;
+    }
+    return 0;
+}
+
+// Builds a list of `texts.size()` items and drops it again, the way a bulk
+// load followed by deleting everything would
+template <typename List>
+double build_and_drop(const std::vector<InternedString>& texts)
+{
+    return time_ms([&] {
+        auto items = List{}.transient();
+        for (std::size_t i = 0; i < texts.size(); ++i) {
+            TodoItem item;
+            item.id   = i + 1;
+            item.text = texts[i];
+            items.push_back(std::move(item));
+        }
+        List list = items.persistent();
+    });
+}
+
+int bench_memory_pool(std::size_t count)
+{
+    std::vector<InternedString> texts;
+    texts.reserve(count);
+    for (std::size_t i = 0; i < count; ++i)
+        texts.emplace_back("Task number " + std::to_string(i % 1000));
+
+    std::printf("\nBuilding and dropping a list of %zu items\n", count);
+    double heap_ms = build_and_drop<immer::flex_vector<TodoItem>>(texts);
+    auto before    = memory_pool().stats();
+    double pool_ms = build_and_drop<TodoList>(texts);
+    auto after     = memory_pool().stats();
+
+    std::size_t allocations = after.allocations - before.allocations;
+    std::size_t reused      = after.free_list_hits - before.free_list_hits;
+    std::printf("  default heap: %8.2f ms\n", heap_ms);
+    std::printf("  memory pool:  %8.2f ms, %zu of %zu node allocations "
+                "from free lists\n",
+                pool_ms,
+                reused,
+                allocations);
+    std::printf("  pool: %.1f MiB reserved, %.1f%% free after dropping\n",
+                after.reserved / 1048576.0,
+                after.fragmentation() * 100);
+    if (after.used != before.used) {
+        std::printf("  MISMATCH: %zd bytes still in use after dropping\n",
+                    std::ptrdiff_t(after.used - before.used));
+        return 1;
+    }
+    return 0;
+}
+
+// Every match of `needle` (lower case) in `text`, the obvious way
+std::size_t naive_occurrences(std::string_view text, const std::string& needle)
+{
+    std::string lowered(text);
+    for (char& c : lowered)
+        c = (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+    std::size_t count = 0;
+    for (auto at = lowered.find(needle); at != std::string::npos;
+         at      = lowered.find(needle, at + 1))
+        ++count;
+    return count;
+}
+
+template <typename Find>
+std::size_t
+occurrences(std::string_view text, const std::string& needle, Find&& find)
+{
+    std::size_t count = 0;
+    for (std::size_t at = find(text, needle); at != std::string_view::npos;
+         at             = find(text, needle)) {
+        ++count;
+        text.remove_prefix(at + 1);
+    }
+    return count;
+}
+
+int bench_list_search(std::size_t count)
+{
+    // Roughly what a saved list looks like: a record per item
+    std::mt19937 rng(7);
+    const char* words[] = {"Review", "the", "budget", "Call", "Bob", "about",
+                           "deploy", "Release", "notes", "café", "groceries"};
+    std::string text;
+    for (std::size_t i = 0; i < count; ++i) {
+        text += "{\"text\":\"";
+        for (int w = 0; w < 4; ++w) {
+            text += words[rng() % std::size(words)];
+            text += ' ';
+        }
+        text += std::to_string(i) + "\",\"done\":false,\"id\":" +
+                std::to_string(i + 1) + "},\n";
+    }
+    std::printf("\nList search in %.1f MiB of records (AVX2 kernel: %s)\n",
+                text.size() / 1048576.0,
+                list_search_vectorized() ? "yes" : "no");
+    std::printf("  %-14s %9s %10s %10s %10s %8s\n",
+                "text",
+                "matches",
+                "naive ms",
+                "scalar ms",
+                "kernel ms",
+                "GB/s");
+
+    int failures = 0;
+    for (std::string needle : {"budget bob", "café", "zzqq", "release notes"}) {
+        std::size_t expected = 0, scalar = 0, found = 0;
+        double naive_ms =
+            time_ms([&] { expected = naive_occurrences(text, needle); }, 1);
+        double scalar_ms = time_ms([&] {
+            scalar = occurrences(text, needle, find_ignoring_case_scalar);
+        });
+        double kernel_ms = time_ms(
+            [&] { found = occurrences(text, needle, find_ignoring_case); });
+        std::printf("  %-14s %9zu %10.2f %10.2f %10.2f %8.2f\n",
+                    needle.c_str(),
+                    found,
+                    naive_ms,
+                    scalar_ms,
+                    kernel_ms,
+                    text.size() / (kernel_ms * 1e6));
+        if (found != expected || scalar != expected) {
+            std::printf("  MISMATCH: naive scan found %zu\n", expected);
+            ++failures;
+        }
+    }
+    return failures;
+}
+
+int bench_snapshots(std::size_t count)
+{
+    TodoList items = make_tagged_list(
+        count, {"#work", "#home", "#urgent", "#later", "@bob", "@alice"});
+    auto list = items.transient();
+    for (std::size_t i = 0; i < list.size(); i += 3)
+        list.update(i, [&](TodoItem item) {
+            item.done    = true;
+            item.done_at = 1780000000 + std::int64_t(i);
+            return item;
+        });
+    AppState state;
+    state.todos = list.persistent();
+
+    auto directory = std::filesystem::temp_directory_path();
+    struct Run
+    {
+        const char* name;
+        Persistence::Encoding encoding;
+        std::filesystem::path path;
+        std::optional<AppState> loaded;
+    };
+    Run runs[] = {
+        {"json", Persistence::Encoding::Json, directory / "tui_bench.json"},
+        {"compressed",
+         Persistence::Encoding::Compressed,
+         directory / "tui_bench.lz.json"},
+    };
+
+    std::printf("\nSnapshots of a list of %zu items\n", count);
+    std::printf("  %-11s %10s %10s %10s\n",
+                "encoding",
+                "MiB",
+                "save ms",
+                "load ms");
+    int failures = 0;
+    for (auto& run : runs) {
+        bool saved     = true;
+        double save_ms = time_ms(
+            [&] {
+                saved = Persistence::save_state(run.path, state, run.encoding);
+            },
+            3);
+        double load_ms = time_ms(
+            [&] { run.loaded = Persistence::load_state(run.path); }, 3);
+        std::error_code error;
+        std::printf("  %-11s %10.1f %10.2f %10.2f\n",
+                    run.name,
+                    std::filesystem::file_size(run.path, error) / 1048576.0,
+                    save_ms,
+                    load_ms);
+        if (!saved || !run.loaded || run.loaded->todos.size() != count) {
+            std::printf("  MISMATCH: the %s file didn't load back\n", run.name);
+            ++failures;
+        }
+        std::filesystem::remove(run.path, error);
+    }
+    if (failures == 0 && runs[0].loaded->todos != runs[1].loaded->todos) {
+        std::printf("  MISMATCH: the two files loaded differently\n");
+        ++failures;
+    }
+    return failures;
+}
+
+// `edits` random edits of `items` by `replica`: adds, removals, toggles and
+// moves, as many of each
+TodoList edit_apart(TodoList items, std::uint32_t replica, std::size_t edits)
+{
+    std::mt19937 rng(replica);
+    std::uint64_t next_id = std::uint64_t{replica} << 40;
+    for (std::size_t e = 0; e < edits; ++e) {
+        const std::size_t at = rng() % items.size();
+        switch (e % 4) {
+        case 0: {
+            TodoItem item;
+            item.id   = next_id++;
+            item.text = "Added by " + std::to_string(replica);
+            items     = items.insert(at, std::move(item));
+            break;
+        }
+        case 1: items = items.erase(at); break;
+        case 2:
+            items = items.update(at, [](TodoItem item) {
+                item.done = !item.done;
+                return item;
+            });
+            break;
+        case 3: {
+            TodoItem item = items[at];
+            items         = items.erase(at).insert(rng() % items.size(), item);
+            break;
+        }
+        }
+    }
+    return items;
+}
+
+int bench_merge(std::size_t count)
+{
+    TodoList base = make_tagged_list(count, {"#work", "#home", "@bob"});
+    std::printf("\nMerging two replicas of a list of %zu items\n", count);
+    std::printf("  %-7s %10s %10s %10s %10s %12s\n",
+                "edits",
+                "start ms",
+                "update ms",
+                "apply ms",
+                "B/op",
+                "B/item meta");
+    int failures = 0;
+    for (std::size_t edits : {100, 1000, 10000}) {
+        std::optional<Replica::Document> a, b;
+        double start_ms = time_ms(
+            [&] {
+                a.emplace(1, base);
+                b.emplace(2, base);
+            },
+            1);
+        const TodoList to_a = edit_apart(base, 1, edits);
+        const TodoList to_b = edit_apart(base, 2, edits);
+        Replica::Batch ops_a, ops_b;
+        double update_ms = time_ms(
+            [&] {
+                ops_a = a->update(base, to_a);
+                ops_b = b->update(base, to_b);
+            },
+            1);
+        double apply_ms = time_ms(
+            [&] {
+                a->apply(ops_b);
+                b->apply(ops_a);
+            },
+            1);
+        const std::size_t ops = ops_a.ops.size() + ops_b.ops.size();
+        const std::size_t bytes =
+            Replica::encode(ops_a).size() + Replica::encode(ops_b).size();
+        std::printf("  %-7zu %10.2f %10.2f %10.2f %10.1f %12.1f\n",
+                    edits,
+                    start_ms / 2,
+                    update_ms / 2,
+                    apply_ms / 2,
+                    double(bytes) / double(ops),
+                    double(a->stats().metadata_bytes) / double(count));
+        if (!(a->items() == b->items())) {
+            std::printf("  MISMATCH: the replicas merged differently\n");
+            ++failures;
+        }
+    }
+    return failures;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::size_t count = 1000000;
+    if (argc > 1)
+        count = std::strtoull(argv[1], nullptr, 10);
+    if (count == 0) {
+        std::fprintf(stderr, "Usage: %s [items]\n", argv[0]);
+        return 1;
+    }
+    int failures = bench_tag_filter(count);
+    failures += bench_fuzzy(count);
+    failures += bench_interning(count);
+    failures += bench_memory_pool(count);
+    failures += bench_list_search(count);
+    failures += bench_snapshots(count);
+    failures += bench_merge(count);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,194 @@
+#include "completions.hpp"
+
+#include <algorithm>
+
+CompletionTrie::CompletionTrie(std::size_t max_nodes)
+    : max_nodes_(max_nodes)
+    , nodes_(1) // Root, the empty prefix
+{
+}
+
+std::uint32_t CompletionTrie::find_child(std::uint32_t node, char c) const
+{
+    for (auto child = nodes_[node].first_child; child != none;
+         child      = nodes_[child].next_sibling) {
+        if (nodes_[child].c == c)
+            return child;
+    }
+    return none;
+}
+
+std::uint32_t CompletionTrie::add_child(std::uint32_t node, char c)
+{
+    auto child = static_cast<std::uint32_t>(nodes_.size());
+    Node added;
+    added.parent       = node;
+    added.next_sibling = nodes_[node].first_child;
+    added.c            = c;
+    nodes_.push_back(added);
+    nodes_[node].first_child = child;
+    return child;
+}
+
+void CompletionTrie::promote(Node& node, std::uint32_t end)
+{
+    auto first = node.top.begin();
+    auto last  = first + node.top_size;
+    auto found = std::find(first, last, end);
+    if (found == last) {
+        if (node.top_size < top_k) {
+            ++node.top_size;
+            ++last;
+        } else if (nodes_[*(last - 1)].count > nodes_[end].count) {
+            return;
+        }
+        found  = last - 1;
+        *found = end;
+    }
+    // Only `end` changed, so moving it up keeps the order; on ties the
+    // more recently used text goes first
+    while (found != first &&
+           nodes_[*(found - 1)].count <= nodes_[end].count) {
+        std::iter_swap(found - 1, found);
+        --found;
+    }
+}
+
+void CompletionTrie::insert(std::string_view text)
+{
+    if (text.empty() || text.size() > max_text)
+        return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (nodes_.size() + text.size() > max_nodes_)
+        prune();
+
+    std::vector<std::uint32_t> path{0};
+    std::uint32_t node = 0;
+    for (char c : text) {
+        auto child = find_child(node, c);
+        node       = child != none ? child : add_child(node, c);
+        path.push_back(node);
+    }
+    ++nodes_[node].count;
+    nodes_[node].last_used = ++clock_;
+    for (auto on_path : path)
+        promote(nodes_[on_path], node);
+}
+
+std::uint32_t CompletionTrie::recent_window() const
+{
+    return static_cast<std::uint32_t>(max_nodes_ / 4 / max_text);
+}
+
+void CompletionTrie::prune()
+{
+    // Drop rarer and rarer texts, sparing fewer and fewer recent ones, until
+    // the arena is at most 3/4 full, so pruning doesn't run again right away
+    for (std::uint32_t rare = 1, recent = recent_window();
+         nodes_.size() > 1 && nodes_.size() + max_text > max_nodes_ / 4 * 3;
+         rare *= 2, recent /= 2) {
+        // Forget the texts used `rare` times or less, other than those of
+        // the last `recent` insertions; subtrees left without any text go
+        std::vector<std::uint32_t> weight(nodes_.size());
+        for (auto& node : nodes_) {
+            if (node.count <= rare && clock_ - node.last_used >= recent)
+                node.count = 0;
+        }
+        for (std::size_t i = nodes_.size() - 1; i > 0; --i) {
+            weight[i] += nodes_[i].count;
+            weight[nodes_[i].parent] += weight[i];
+        }
+
+        // Copy the survivors depth-first, so children still come after
+        // their parents
+        std::vector<Node> kept;
+        std::vector<std::uint32_t> renumbered(nodes_.size(), none);
+        std::vector<std::uint32_t> stack{0};
+        while (!stack.empty()) {
+            auto old = stack.back();
+            stack.pop_back();
+            auto index      = static_cast<std::uint32_t>(kept.size());
+            renumbered[old] = index;
+
+            Node node         = nodes_[old];
+            node.first_child  = none;
+            node.next_sibling = none;
+            node.top_size     = 0;
+            if (node.parent != none) {
+                node.parent       = renumbered[node.parent];
+                node.next_sibling = kept[node.parent].first_child;
+                kept[node.parent].first_child = index;
+            }
+            kept.push_back(node);
+
+            for (auto child = nodes_[old].first_child; child != none;
+                 child      = nodes_[child].next_sibling) {
+                if (weight[child] > 0)
+                    stack.push_back(child);
+            }
+        }
+        nodes_ = std::move(kept);
+
+        // Rebuild the caches bottom-up from the children's
+        std::vector<std::uint32_t> candidates;
+        for (std::size_t i = nodes_.size(); i-- > 0;) {
+            Node& node = nodes_[i];
+            candidates.clear();
+            if (node.count > 0)
+                candidates.push_back(static_cast<std::uint32_t>(i));
+            for (auto child = node.first_child; child != none;
+                 child      = nodes_[child].next_sibling) {
+                const Node& below = nodes_[child];
+                candidates.insert(candidates.end(),
+                                  below.top.begin(),
+                                  below.top.begin() + below.top_size);
+            }
+            auto keep = std::min<std::size_t>(candidates.size(), top_k);
+            std::partial_sort(candidates.begin(),
+                              candidates.begin() + keep,
+                              candidates.end(),
+                              [this](std::uint32_t a, std::uint32_t b) {
+                                  const Node& x = nodes_[a];
+                                  const Node& y = nodes_[b];
+                                  return x.count != y.count
+                                             ? x.count > y.count
+                                             : x.last_used > y.last_used;
+                              });
+            std::copy_n(candidates.begin(), keep, node.top.begin());
+            node.top_size = static_cast<std::uint8_t>(keep);
+        }
+    }
+}
+
+std::string CompletionTrie::text_of(std::uint32_t end) const
+{
+    std::string text;
+    for (auto node = end; node != 0; node = nodes_[node].parent)
+        text += nodes_[node].c;
+    std::reverse(text.begin(), text.end());
+    return text;
+}
+
+std::vector<std::string> CompletionTrie::complete(std::string_view prefix) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::uint32_t node = 0;
+    for (char c : prefix) {
+        node = find_child(node, c);
+        if (node == none)
+            return {};
+    }
+    std::vector<std::string> texts;
+    const Node& found = nodes_[node];
+    for (int i = 0; i < found.top_size; ++i) {
+        if (found.top[i] != node)
+            texts.push_back(text_of(found.top[i]));
+    }
+    return texts;
+}
+
+std::size_t CompletionTrie::node_count() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return nodes_.size();
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Prefix trie of the texts todos have been added with, counting how often
+// each was used, for completing the new-todo input. Every node caches the
+// most frequent texts below it, so a lookup is a walk down the prefix plus
+// reading those back, independent of how much history there is.
+//
+// Nodes live in one arena and refer to each other by index. When the arena
+// is full the rarest texts are pruned (those used once, then if that's not
+// enough those used twice or less, and so on), along with the prefixes only
+// they used. Texts used lately are spared, or what was just added (used
+// once so far) would be the first to go: at first those of the last
+// recent_window() insertions, then fewer and fewer as rarity goes up.
+//
+// Thread-safe: texts are added by reducer effects, lookups come from the UI.
+class CompletionTrie
+{
+public:
+    static constexpr int top_k = 5;
+    // Longer texts aren't worth completing, and would eat the arena
+    static constexpr std::size_t max_text = 120;
+
+    explicit CompletionTrie(std::size_t max_nodes = std::size_t{1} << 17);
+
+    void insert(std::string_view text);
+
+    // Most used texts starting with `prefix` (other than `prefix` itself),
+    // most used first.
+    std::vector<std::string> complete(std::string_view prefix) const;
+
+    std::size_t node_count() const;
+
+private:
+    static constexpr std::uint32_t none = ~std::uint32_t{0};
+
+    struct Node
+    {
+        std::uint32_t parent       = none;
+        std::uint32_t first_child  = none;
+        std::uint32_t next_sibling = none;
+        std::uint32_t count        = 0; // Times a text ending here was added
+        std::uint32_t last_used    = 0; // Insertion it was last added by
+        char c                     = '\0';
+        std::uint8_t top_size      = 0;
+        std::array<std::uint32_t, top_k> top{}; // Nodes ending texts below
+    };
+
+    std::uint32_t find_child(std::uint32_t node, char c) const;
+    std::uint32_t add_child(std::uint32_t node, char c);
+    // Moves `end` up in the cache of `node` after its count went up
+    void promote(Node& node, std::uint32_t end);
+    void prune();
+    // As many insertions as fit in a quarter of the arena at max_text each
+    std::uint32_t recent_window() const;
+    std::string text_of(std::uint32_t end) const;
+
+    mutable std::mutex mutex_;
+    std::size_t max_nodes_;
+    std::uint32_t clock_ = 0; // Insertions so far
+    std::vector<Node> nodes_; // Root first; children after their parents
+};
@@ -0,0 +1,112 @@
+// What changed between two list files, such as yesterday's copy and today's,
+// item by item (see list_diff.hpp). The main list is compared, and each
+// board column with the same name in both.
+//
+//   tui_diff OLD NEW
+//
+// Each change is a line: "-" removed, "+" added, "~" edited in place, ">"
+// moved, with its position (in the old list for removals, the new one
+// otherwise). Exits with 0 if the lists are the same, 1 if they differ and 2
+// if a file can't be read, like diff.
+
+#include "list_diff.hpp"
+#include "persistence.hpp"
+#include "state.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+namespace {
+
+void print_item(char change, std::size_t position, const TodoItem& item)
+{
+    std::printf("%c%8zu  [%c] %s\n",
+                change,
+                position + 1,
+                item.done ? 'x' : ' ',
+                item.text.c_str());
+}
+
+// The changes to one list; whether there were any
+bool print_diff(const std::string& name,
+                const TodoList& before,
+                const TodoList& after)
+{
+    auto start          = std::chrono::steady_clock::now();
+    const ListDiff diff = diff_lists(before, after);
+    std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    if (diff.empty())
+        return false;
+
+    std::printf("@@ %s: %zu -> %zu items @@\n",
+                name.c_str(),
+                before.size(),
+                after.size());
+    for (const auto& edit : diff.edits) {
+        switch (edit.change) {
+        case ListChange::Removed:
+            print_item('-', edit.before, before[edit.before]);
+            break;
+        case ListChange::Added:
+            print_item('+', edit.after, after[edit.after]);
+            break;
+        case ListChange::Changed:
+            print_item('~', edit.after, after[edit.after]);
+            std::printf("           (%s)\n",
+                        changed_fields(before[edit.before], after[edit.after])
+                            .c_str());
+            break;
+        case ListChange::Moved:
+            print_item('>', edit.after, after[edit.after]);
+            std::printf("           (from %zu)\n", edit.before + 1);
+            break;
+        }
+    }
+    std::printf("%zu added, %zu removed, %zu changed, %zu moved; %zu of %zu "
+                "items compared one by one, in %.1f ms\n",
+                diff.added,
+                diff.removed,
+                diff.changed,
+                diff.moved,
+                diff.items_compared,
+                before.size() + after.size(),
+                elapsed.count());
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc != 3) {
+        std::fprintf(stderr, "Usage: %s OLD NEW\n", argv[0]);
+        return 2;
+    }
+    auto before = Persistence::load_state(argv[1]);
+    auto after  = Persistence::load_state(argv[2]);
+    if (!before || !after) {
+        std::fprintf(stderr, "Could not read %s\n", argv[before ? 2 : 1]);
+        return 2;
+    }
+
+    bool differ = print_diff("todos", before->todos, after->todos);
+    for (const auto& column : after->columns) {
+        TodoList old_items;
+        for (const auto& old_column : before->columns) {
+            if (old_column.name == column.name)
+                old_items = old_column.items;
+        }
+        differ = print_diff(column.name, old_items, column.items) || differ;
+    }
+    for (const auto& old_column : before->columns) {
+        bool kept = false;
+        for (const auto& column : after->columns)
+            kept = kept || column.name == old_column.name;
+        if (!kept)
+            differ =
+                print_diff(old_column.name, old_column.items, {}) || differ;
+    }
+    return differ ? 1 : 0;
+}
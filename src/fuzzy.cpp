@@ -0,0 +1,219 @@
+#include "fuzzy.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <mutex>
+
+namespace {
+
+// Scoring constants, after fzf
+constexpr int score_match           = 16;
+constexpr int gap_start             = -3;
+constexpr int gap_extension         = -1;
+constexpr int bonus_boundary        = 8;
+constexpr int bonus_camel           = 7;
+constexpr int bonus_consecutive     = 4;
+constexpr int first_char_multiplier = 2;
+
+// Items per task; small enough that the first results show up quickly,
+// big enough that the kernels get long runs
+constexpr std::size_t chunk_size = 16384;
+
+char lower(char c) { return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c; }
+
+bool is_separator(char c)
+{
+    return std::isspace(static_cast<unsigned char>(c)) ||
+           (c != '\0' && std::strchr("/-_.,:;@#()[]", c));
+}
+
+bool better(const FuzzyMatch& a, const FuzzyMatch& b)
+{
+    return a.score != b.score ? a.score > b.score : a.index < b.index;
+}
+
+void keep_best(std::vector<FuzzyMatch>& matches, std::size_t k)
+{
+    if (matches.size() > k) {
+        std::partial_sort(
+            matches.begin(), matches.begin() + k, matches.end(), better);
+        matches.resize(k);
+    } else {
+        std::sort(matches.begin(), matches.end(), better);
+    }
+}
+
+} // namespace
+
+std::optional<int> fuzzy_score(std::string_view pattern, std::string_view text)
+{
+    if (pattern.empty())
+        return 0;
+
+    // Forward: where the earliest complete match ends
+    std::size_t p = 0, end = 0;
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        if (lower(text[i]) == pattern[p] && ++p == pattern.size()) {
+            end = i + 1;
+            break;
+        }
+    }
+    if (p < pattern.size())
+        return std::nullopt;
+
+    // Backward: the latest start of a match ending there, so the window
+    // scored below is as tight as possible
+    std::size_t start = 0;
+    for (std::size_t i = end; i-- > 0;) {
+        if (lower(text[i]) == pattern[p - 1] && --p == 0) {
+            start = i;
+            break;
+        }
+    }
+
+    int score     = 0;
+    int run_bonus = 0; // Bonus of the first character of a consecutive run
+    bool in_gap   = false;
+    for (std::size_t i = start; i < end; ++i) {
+        char c = text[i];
+        if (p < pattern.size() && lower(c) == pattern[p]) {
+            int bonus = 0;
+            if (i == 0 || is_separator(text[i - 1]))
+                bonus = bonus_boundary;
+            else if (std::islower(static_cast<unsigned char>(text[i - 1])) &&
+                     std::isupper(static_cast<unsigned char>(c)))
+                bonus = bonus_camel;
+            if (p > 0 && !in_gap)
+                bonus = std::max({bonus, run_bonus, bonus_consecutive});
+            run_bonus = bonus;
+            score += score_match +
+                     (p == 0 ? bonus * first_char_multiplier : bonus);
+            ++p;
+            in_gap = false;
+        } else {
+            score += in_gap ? gap_extension : gap_start;
+            in_gap = true;
+        }
+    }
+    return score;
+}
+
+TagMask char_mask(std::string_view text)
+{
+    TagMask mask;
+    for (char c : text)
+        mask.set(static_cast<unsigned char>(lower(c)) & 127);
+    return mask;
+}
+
+// Byte masks of the list last searched, one column set per chunk, each
+// built once by whichever search reaches it first.
+struct FuzzyFinder::MaskCache
+{
+    TodoList items;
+    std::vector<TagColumns> chunks;
+    std::unique_ptr<std::once_flag[]> built;
+};
+
+// Shared with the tasks, which may outlive the finder.
+struct FuzzyFinder::Shared
+{
+    std::atomic<std::uint64_t> generation{0}; // Of the latest search
+    std::mutex mutex;
+    FuzzyResults results; // Of the latest search
+};
+
+FuzzyFinder::FuzzyFinder(ThreadPool& pool, std::size_t top_k)
+    : pool_(pool)
+    , top_k_(top_k)
+    , shared_(std::make_shared<Shared>())
+{
+}
+
+void FuzzyFinder::search(const TodoList& items, const std::string& pattern)
+{
+    // Tasks of the previous search notice this and stop
+    const std::uint64_t generation = ++shared_->generation;
+    {
+        std::lock_guard<std::mutex> lock(shared_->mutex);
+        shared_->results       = FuzzyResults{};
+        shared_->results.total = items.size();
+    }
+
+    const std::size_t chunks = (items.size() + chunk_size - 1) / chunk_size;
+    if (!masks_ || !(masks_->items == items)) {
+        masks_        = std::make_shared<MaskCache>();
+        masks_->items = items;
+        masks_->chunks.resize(chunks);
+        masks_->built = std::make_unique<std::once_flag[]>(chunks);
+    }
+
+    std::string lowered;
+    for (char c : pattern)
+        lowered += lower(c);
+    if (lowered.empty()) {
+        std::lock_guard<std::mutex> lock(shared_->mutex);
+        shared_->results.scanned = items.size();
+        return;
+    }
+    TagQuery query;
+    query.all = char_mask(lowered);
+
+    for (std::size_t chunk = 0; chunk < chunks; ++chunk) {
+        pool_.submit([shared = shared_,
+                      masks  = masks_,
+                      query,
+                      lowered,
+                      generation,
+                      chunk,
+                      top_k = top_k_] {
+            if (shared->generation != generation)
+                return;
+            const auto& items = masks->items;
+            std::size_t begin = chunk * chunk_size;
+            std::size_t end   = std::min(begin + chunk_size, items.size());
+
+            auto& columns = masks->chunks[chunk];
+            std::call_once(masks->built[chunk], [&] {
+                columns.lo.reserve(end - begin);
+                columns.hi.reserve(end - begin);
+                auto last = items.begin() + end;
+                for (auto it = items.begin() + begin; it != last; ++it) {
+                    TagMask mask = char_mask(it->text);
+                    columns.lo.push_back(mask.lo);
+                    columns.hi.push_back(mask.hi);
+                }
+            });
+            std::vector<std::uint32_t> candidates;
+            select_matching(columns, query, candidates);
+
+            std::vector<FuzzyMatch> best;
+            for (auto offset : candidates) {
+                auto index       = static_cast<std::uint32_t>(begin + offset);
+                const auto& item = items[index];
+                if (auto score = fuzzy_score(lowered, item.text))
+                    best.push_back({*score, index, item.id, {}});
+            }
+            keep_best(best, top_k);
+            for (auto& match : best)
+                match.text = items[match.index].text;
+
+            std::lock_guard<std::mutex> lock(shared->mutex);
+            if (shared->generation != generation)
+                return;
+            auto& results = shared->results;
+            results.matches.insert(results.matches.end(),
+                                   std::make_move_iterator(best.begin()),
+                                   std::make_move_iterator(best.end()));
+            keep_best(results.matches, top_k);
+            results.scanned += end - begin;
+        });
+    }
+}
+
+FuzzyResults FuzzyFinder::results() const
+{
+    std::lock_guard<std::mutex> lock(shared_->mutex);
+    return shared_->results;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "state.hpp"       // TodoList
+#include "tags.hpp"        // TagMask, TagColumns
+#include "thread_pool.hpp" // ThreadPool
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// fzf-style matching: the pattern's characters must appear in the text in
+// order, case-insensitively. Matches score higher when they are contiguous
+// and start words, and lower the more gaps they have. `pattern` must be
+// lower case.
+std::optional<int> fuzzy_score(std::string_view pattern, std::string_view text);
+
+// Set of (lower-cased) bytes in `text`. Any text a pattern matches contains
+// all of the pattern's bytes, which the tag filter kernels test for whole
+// chunks of items at a time.
+TagMask char_mask(std::string_view text);
+
+struct FuzzyMatch
+{
+    int score = 0;
+    std::uint32_t index = 0; // Position in the searched list
+    std::uint64_t id    = 0;
+    InternedString text;
+};
+
+struct FuzzyResults
+{
+    std::vector<FuzzyMatch> matches; // Best first
+    std::size_t scanned = 0;         // Items looked at so far
+    std::size_t total   = 0;
+
+    bool done() const { return scanned == total; }
+};
+
+// Searches a list in the background. The list is split into chunks that are
+// prefiltered with the byte masks (cached per list, built by the first
+// search) and scored on the thread pool; each chunk merges its best matches
+// into the shared top K as soon as it is done, so results() fills in while
+// the scan is still running. Starting a new search abandons the previous one.
+class FuzzyFinder
+{
+public:
+    explicit FuzzyFinder(ThreadPool& pool, std::size_t top_k = 50);
+
+    void search(const TodoList& items, const std::string& pattern);
+
+    // Best matches found so far by the latest search. Thread-safe, cheap.
+    FuzzyResults results() const;
+
+private:
+    struct Shared;
+    struct MaskCache;
+
+    ThreadPool& pool_;
+    std::size_t top_k_;
+    std::shared_ptr<Shared> shared_;
+    std::shared_ptr<MaskCache> masks_;
+};
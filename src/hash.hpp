@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+// Hashes for what the data files compare or order by (history chunks,
+// replica slots). Fast rather than cryptographic.
+namespace Hash {
+
+// MurmurHash3's finalizer
+inline std::uint64_t mix(std::uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+// A word at a time, from a seed
+struct Hasher
+{
+    std::uint64_t value;
+
+    void add(std::uint64_t word)
+    {
+        value = mix(value ^ (word * 0x9e3779b97f4a7c15ull));
+    }
+
+    void add(std::string_view bytes)
+    {
+        std::size_t i = 0;
+        for (; i + 8 <= bytes.size(); i += 8) {
+            std::uint64_t word;
+            std::memcpy(&word, bytes.data() + i, 8);
+            add(word);
+        }
+        std::uint64_t tail = 0;
+        if (i < bytes.size())
+            std::memcpy(&tail, bytes.data() + i, bytes.size() - i);
+        add(tail ^ (std::uint64_t{bytes.size()} << 56));
+    }
+};
+
+} // namespace Hash
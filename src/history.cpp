@@ -0,0 +1,299 @@
+#include "history.hpp"
+#include "hash.hpp"
+#include "persistence.hpp"
+
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+
+namespace {
+
+constexpr std::string_view chunk_magic   = "TODOHCH1";
+constexpr std::string_view version_magic = "TODOHVR1";
+constexpr RecordFile::Format format = {chunk_magic, version_magic, 28, 16};
+
+// Chunk sizes: a leaf ends after an item whose hash is 0 modulo the target,
+// a group after such a leaf, within bounds
+constexpr std::uint64_t leaf_target  = 64; // Items
+constexpr std::size_t min_leaf       = 16;
+constexpr std::size_t max_leaf       = 256;
+constexpr std::uint64_t group_target = 16; // Leaves
+constexpr std::size_t min_group      = 4;
+constexpr std::size_t max_group      = 64;
+
+// Seeds, so that an item, a leaf and a group never hash alike
+constexpr std::uint64_t item_seed  = 0x6974656d;
+constexpr std::uint64_t leaf_seed  = 0x6c656166;
+constexpr std::uint64_t group_seed = 0x67726f75;
+
+} // namespace
+
+namespace History {
+
+std::uint64_t item_hash(const TodoItem& item)
+{
+    Hash::Hasher hasher{item_seed};
+    hasher.add(item.id);
+    hasher.add(item.done ? 1 : 0);
+    hasher.add(static_cast<std::uint64_t>(item.due));
+    hasher.add(static_cast<std::uint64_t>(item.priority));
+    hasher.add(static_cast<std::uint64_t>(item.done_at));
+    hasher.add(item.text.str());
+    const auto& children = subtask_items(item);
+    for (const auto& child : children)
+        hasher.add(item_hash(child));
+    hasher.add(children.size());
+    return hasher.value;
+}
+
+std::vector<Chunk> leaves(const TodoList& items)
+{
+    std::vector<std::uint64_t> hashes;
+    hashes.reserve(items.size());
+    for (const auto& item : items)
+        hashes.push_back(item_hash(item));
+    return leaves(hashes);
+}
+
+std::vector<Chunk> leaves(const std::vector<std::uint64_t>& hashes)
+{
+    std::vector<Chunk> found;
+    Chunk leaf;
+    Hash::Hasher hasher{leaf_seed};
+    for (std::size_t i = 0; i < hashes.size();) {
+        const std::uint64_t hash = hashes[i];
+        hasher.add(hash);
+        std::size_t length = ++i - leaf.begin;
+        if ((length >= min_leaf && hash % leaf_target == 0) ||
+            length == max_leaf || i == hashes.size()) {
+            leaf.end  = i;
+            leaf.hash = hasher.value;
+            found.push_back(leaf);
+            leaf.begin = i;
+            hasher     = Hash::Hasher{leaf_seed};
+        }
+    }
+    return found;
+}
+
+Store::Store(std::filesystem::path path)
+    : path_(std::move(path))
+{
+}
+
+const std::vector<Version>& Store::versions()
+{
+    scan();
+    return versions_;
+}
+
+void Store::scan()
+{
+    if (ending_ == RecordFile::Ending::Damaged)
+        return;
+    ending_ = RecordFile::scan(
+        path_, format, end_, [&](const Record& record, const char* header) {
+            const std::uint64_t key = RecordFile::get(header + 8, 8);
+            if (std::string_view(header, chunk_magic.size()) == chunk_magic) {
+                chunks_.emplace(key, record);
+            } else {
+                versions_.push_back({record.offset,
+                                     static_cast<std::int64_t>(key),
+                                     static_cast<std::uint32_t>(
+                                         RecordFile::get(header + 24, 4))});
+                version_records_.push_back(record);
+            }
+        });
+}
+
+std::optional<std::string> Store::read(const Record& record) const
+{
+    return RecordFile::read(path_, format, record);
+}
+
+bool Store::append(const AppState& state, std::int64_t saved_at)
+{
+    scan();
+    stats_.chunks_written = 0;
+
+    std::string records;
+    std::string fields;
+    auto write = [&](std::string_view magic,
+                     std::uint64_t key,
+                     std::size_t count,
+                     std::string_view payload) {
+        fields.clear();
+        RecordFile::put(fields, key, 8);
+        RecordFile::put(fields, count, 4);
+        return RecordFile::frame(
+            records, end_, format, magic, fields, payload);
+    };
+
+    // Writes the chunks of `items` the file doesn't have, and returns the
+    // hashes of its groups
+    auto store = [&](const TodoList& items) {
+        std::vector<std::uint64_t> groups;
+        std::vector<std::uint64_t> members;
+        Hash::Hasher hasher{group_seed};
+        const auto found = leaves(items);
+        for (std::size_t i = 0; i < found.size(); ++i) {
+            const Chunk& leaf = found[i];
+            if (!chunks_.count(leaf.hash)) {
+                AppState chunk;
+                chunk.todos = items.drop(leaf.begin).take(leaf.end -
+                                                          leaf.begin);
+                chunk.columns = {};
+                auto bytes    = Persistence::encode_state(chunk);
+                chunks_[leaf.hash] =
+                    write(chunk_magic,
+                          leaf.hash,
+                          chunk.todos.size(),
+                          std::string_view(
+                              reinterpret_cast<const char*>(bytes.data()),
+                              bytes.size()));
+                ++stats_.chunks_written;
+            }
+            members.push_back(leaf.hash);
+            hasher.add(leaf.hash);
+            if ((members.size() >= min_group &&
+                 leaf.hash % group_target == 0) ||
+                members.size() == max_group || i + 1 == found.size()) {
+                if (!chunks_.count(hasher.value)) {
+                    std::string payload;
+                    for (std::uint64_t member : members)
+                        RecordFile::put(payload, member, 8);
+                    chunks_[hasher.value] = write(
+                        chunk_magic, hasher.value, members.size(), payload);
+                    ++stats_.chunks_written;
+                }
+                groups.push_back(hasher.value);
+                members.clear();
+                hasher = Hash::Hasher{group_seed};
+            }
+        }
+        return groups;
+    };
+
+    nlohmann::json manifest = {{"todos", store(state.todos)},
+                               {"columns", nlohmann::json::array()}};
+    for (const auto& column : state.columns) {
+        manifest["columns"].push_back(
+            {{"name", column.name}, {"groups", store(column.items)}});
+    }
+    auto bytes = nlohmann::json::to_cbor(manifest);
+    auto record_of_version =
+        write(version_magic,
+              static_cast<std::uint64_t>(saved_at),
+              state.todos.size(),
+              std::string_view(reinterpret_cast<const char*>(bytes.data()),
+                               bytes.size()));
+    if (!RecordFile::append(path_, end_, ending_, records)) {
+        // Forget what was meant to be written; the next scan finds out
+        *this = Store(path_);
+        return false;
+    }
+    end_ += records.size();
+    ending_ = RecordFile::Ending::Complete;
+    versions_.push_back({record_of_version.offset,
+                         saved_at,
+                         static_cast<std::uint32_t>(state.todos.size())});
+    version_records_.push_back(record_of_version);
+    return true;
+}
+
+std::optional<TodoList> Store::group(std::uint64_t hash)
+{
+    if (auto found = decoded_.find(hash); found != decoded_.end()) {
+        ++stats_.chunks_shared;
+        return found->second;
+    }
+    auto record = chunks_.find(hash);
+    if (record == chunks_.end())
+        return std::nullopt;
+    auto payload = read(record->second);
+    if (!payload)
+        return std::nullopt;
+    ++stats_.chunks_read;
+
+    TodoList items;
+    for (std::size_t at = 0; at + 8 <= payload->size(); at += 8) {
+        const std::uint64_t leaf = RecordFile::get(payload->data() + at, 8);
+        if (auto found = decoded_.find(leaf); found != decoded_.end()) {
+            ++stats_.chunks_shared;
+            items = items + found->second;
+            continue;
+        }
+        auto leaf_record = chunks_.find(leaf);
+        if (leaf_record == chunks_.end())
+            return std::nullopt;
+        auto bytes = read(leaf_record->second);
+        auto state = bytes ? Persistence::decode_state(*bytes) : std::nullopt;
+        if (!state)
+            return std::nullopt;
+        ++stats_.chunks_read;
+        decoded_.emplace(leaf, state->todos);
+        items = items + state->todos;
+    }
+    decoded_.emplace(hash, items);
+    return items;
+}
+
+std::optional<TodoList> Store::list(const std::vector<std::uint64_t>& groups)
+{
+    TodoList items;
+    for (std::uint64_t hash : groups) {
+        auto found = group(hash);
+        if (!found)
+            return std::nullopt;
+        items = items + *found;
+    }
+    return items;
+}
+
+std::optional<AppState> Store::open(const Version& version)
+{
+    stats_.chunks_read   = 0;
+    stats_.chunks_shared = 0;
+    auto record          = std::find_if(
+        version_records_.begin(), version_records_.end(), [&](auto& r) {
+            return r.offset == version.offset;
+        });
+    if (record == version_records_.end())
+        return std::nullopt;
+    auto payload = read(*record);
+    if (!payload)
+        return std::nullopt;
+
+    try {
+        auto manifest = nlohmann::json::from_cbor(*payload);
+        AppState state;
+        auto todos =
+            list(manifest.at("todos").get<std::vector<std::uint64_t>>());
+        if (!todos)
+            return std::nullopt;
+        state.todos          = std::move(*todos);
+        state.selected_index = state.todos.empty() ? -1 : 0;
+        immer::vector<BoardColumn> columns;
+        for (const auto& column : manifest.at("columns")) {
+            auto items = list(
+                column.at("groups").get<std::vector<std::uint64_t>>());
+            if (!items)
+                return std::nullopt;
+            BoardColumn board_column{column.at("name").get<std::string>()};
+            board_column.items          = std::move(*items);
+            board_column.selected_index = board_column.items.empty() ? -1 : 0;
+            columns = columns.push_back(std::move(board_column));
+        }
+        state.columns = std::move(columns);
+        return state;
+    } catch (const nlohmann::json::exception& e) {
+        spdlog::error(
+            "A version in {} is corrupt: {}", path_.string(), e.what());
+        return std::nullopt;
+    }
+}
+
+} // namespace History
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "record_file.hpp" // RecordFile::Record
+#include "state.hpp"       // AppState, TodoItem, TodoList
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+// Every saved version of a list, in "<name>.history" next to it, without a
+// copy of the list per version: like the lists in memory, versions share
+// whatever didn't change between them.
+//
+// A list is cut into chunks of items, which are stored once each, under the
+// hash of what they hold; a version is a manifest of the hashes of its
+// chunks. Chunks end where an item's hash says so rather than at fixed
+// positions, so adding or removing items only changes the chunks around
+// them, and saving a version writes those and the manifest. There are two
+// levels, leaves of items and groups of leaves, so that the manifest of
+// even a huge list stays small.
+//
+// The file is only ever appended to (see RecordFile). Each record is a
+// header followed by its payload, compressed with the LZ codec: "TODOHCH1"
+// (a chunk) or "TODOHVR1" (a version), the chunk's hash or the version's
+// time (u64), the size of the payload packed and unpacked (u32), and the
+// number of items or leaves it holds (u32), all little-endian. A leaf holds
+// items in the list file's format (as CBOR), a group the hashes of its
+// leaves (u64 each), and a version the hashes of the groups of each column.
+namespace History {
+
+// Of everything saved about an item, its subtasks included
+std::uint64_t item_hash(const TodoItem& item);
+
+struct Chunk
+{
+    std::size_t begin  = 0; // Items [begin, end) of the list
+    std::size_t end    = 0;
+    std::uint64_t hash = 0; // Of the items' hashes, in order
+};
+
+// Where a list is cut into leaves, in order. Cuts depend on the items near
+// them only, so the same items mostly cut the same way wherever they are.
+std::vector<Chunk> leaves(const TodoList& items);
+// The same, from the item_hash of each item
+std::vector<Chunk> leaves(const std::vector<std::uint64_t>& hashes);
+
+struct Version
+{
+    std::uint64_t offset  = 0; // Of its record in the file
+    std::int64_t saved_at = 0; // Seconds since the epoch
+    std::uint32_t items   = 0; // Of the main list
+};
+
+// One history file, as far as it has been read. Versions are opened from
+// the chunks decoded for the versions opened before, so paging through
+// versions reads and decodes only what changed. Not thread-safe.
+class Store
+{
+public:
+    explicit Store(std::filesystem::path path);
+
+    const std::filesystem::path& path() const { return path_; }
+
+    // Oldest first, including those appended since the last call
+    const std::vector<Version>& versions();
+
+    // Appends `state` as a new version, with the chunks the file doesn't
+    // have yet. A record cut short at the end of the file is dropped first;
+    // if a record header before that is damaged nothing is appended.
+    bool append(const AppState& state, std::int64_t saved_at);
+
+    // The items and columns of a version, not indexed (see
+    // index_loaded_state); nullopt if the file is damaged.
+    std::optional<AppState> open(const Version& version);
+
+    struct Stats
+    {
+        std::size_t chunks_read    = 0; // By the last open
+        std::size_t chunks_shared  = 0; // Decoded for an earlier one
+        std::size_t chunks_written = 0; // By the last append
+    };
+    const Stats& stats() const { return stats_; }
+
+private:
+    using Record = RecordFile::Record;
+
+    // Indexes the records appended since the last scan
+    void scan();
+    std::optional<std::string> read(const Record& record) const;
+    std::optional<TodoList> group(std::uint64_t hash);
+    std::optional<TodoList> list(const std::vector<std::uint64_t>& groups);
+
+    std::filesystem::path path_;
+    std::uint64_t end_         = 0; // Of the last whole record
+    RecordFile::Ending ending_ = RecordFile::Ending::Complete; // At end_
+    std::unordered_map<std::uint64_t, Record> chunks_;
+    std::vector<Version> versions_;
+    std::vector<Record> version_records_;
+    std::unordered_map<std::uint64_t, TodoList> decoded_; // Leaves, groups
+    Stats stats_;
+};
+
+} // namespace History
@@ -0,0 +1,101 @@
+#include "interned_string.hpp"
+#include "memory_pool.hpp"
+
+#include <array>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+
+namespace {
+
+constexpr std::size_t shard_count = 64;
+
+template <typename Rep>
+struct Shard
+{
+    std::mutex mutex;
+    // Keys view the text of their string
+    std::unordered_map<std::string_view, Rep*> strings;
+};
+
+// The table. Never destroyed: strings held by other statics may be released
+// after it would have been.
+template <typename Rep>
+std::array<Shard<Rep>, shard_count>& shards()
+{
+    static auto* shards = new std::array<Shard<Rep>, shard_count>;
+    return *shards;
+}
+
+template <typename Rep>
+Shard<Rep>& shard_of(std::string_view text)
+{
+    return shards<Rep>()[std::hash<std::string_view>{}(text) % shard_count];
+}
+
+template <typename Rep>
+std::size_t block_size(std::size_t text_size)
+{
+    return sizeof(Rep) + text_size + 1;
+}
+
+} // namespace
+
+InternedString::Rep* InternedString::intern(std::string_view text)
+{
+    if (text.empty())
+        return nullptr;
+    auto& shard = shard_of<Rep>(text);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto found = shard.strings.find(text);
+    if (found != shard.strings.end()) {
+        // A string whose last reference is just going away can't come back,
+        // its releaser is about to free it; it gets replaced instead
+        Rep* rep  = found->second;
+        auto refs = rep->refs.load(std::memory_order_relaxed);
+        while (refs > 0) {
+            if (rep->refs.compare_exchange_weak(
+                    refs, refs + 1, std::memory_order_relaxed))
+                return rep;
+        }
+        shard.strings.erase(found);
+    }
+    void* block = memory_pool().allocate(block_size<Rep>(text.size()));
+    Rep* rep    = new (block) Rep{{1}, static_cast<std::uint32_t>(text.size())};
+    std::memcpy(rep->chars(), text.data(), text.size());
+    rep->chars()[text.size()] = '\0';
+    shard.strings.emplace(rep->text(), rep);
+    return rep;
+}
+
+void InternedString::release(Rep* rep)
+{
+    if (rep->refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+        return;
+    auto& shard = shard_of<Rep>(rep->text());
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto found = shard.strings.find(rep->text());
+        if (found != shard.strings.end() && found->second == rep)
+            shard.strings.erase(found);
+    }
+    std::size_t size = block_size<Rep>(rep->size);
+    rep->~Rep();
+    memory_pool().deallocate(rep, size);
+}
+
+InternedString::Stats InternedString::stats()
+{
+    Stats stats;
+    for (auto& shard : shards<Rep>()) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (const auto& [text, rep] : shard.strings) {
+            ++stats.strings;
+            stats.references += rep->refs.load(std::memory_order_relaxed);
+            stats.bytes += block_size<Rep>(rep->size);
+        }
+    }
+    return stats;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+// Immutable string of which there is only ever one copy per distinct text.
+// Todo texts repeat a lot (recurring chores, items made from templates), so
+// items hold these instead of their own std::string: a copy is a pointer
+// copy plus a reference count increment, and comparing two is comparing
+// pointers.
+//
+// Texts are looked up in a global hash table split into shards, each with
+// its own lock, so threads interning at the same time rarely wait on each
+// other. The last reference to a text removes it from the table. A text and
+// its count share one block from the memory pool.
+class InternedString
+{
+public:
+    InternedString() = default; // The empty string
+    InternedString(std::string_view text) : rep_(intern(text)) {}
+    InternedString(const std::string& text)
+        : InternedString(std::string_view(text))
+    {
+    }
+    InternedString(const char* text) : InternedString(std::string_view(text))
+    {
+    }
+
+    InternedString(const InternedString& other) noexcept : rep_(other.rep_)
+    {
+        if (rep_)
+            rep_->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+    InternedString(InternedString&& other) noexcept
+        : rep_(std::exchange(other.rep_, nullptr))
+    {
+    }
+    InternedString& operator=(InternedString other) noexcept
+    {
+        std::swap(rep_, other.rep_);
+        return *this;
+    }
+    ~InternedString()
+    {
+        if (rep_)
+            release(rep_);
+    }
+
+    std::string_view str() const
+    {
+        return rep_ ? rep_->text() : std::string_view();
+    }
+    const char* c_str() const { return rep_ ? rep_->chars() : ""; }
+    std::size_t size() const { return rep_ ? rep_->size : 0; }
+    bool empty() const { return rep_ == nullptr; }
+
+    operator std::string_view() const { return str(); }
+
+    // Equal texts are the same string
+    bool operator==(const InternedString& other) const
+    {
+        return rep_ == other.rep_;
+    }
+
+    struct Stats
+    {
+        std::size_t strings    = 0; // Distinct texts
+        std::size_t references = 0; // InternedStrings holding them
+        std::size_t bytes      = 0; // Of the texts and counts, table excluded
+    };
+    static Stats stats();
+
+private:
+    friend struct std::hash<InternedString>;
+
+    // Followed by the characters and a terminating null
+    struct Rep
+    {
+        std::atomic<std::uint32_t> refs;
+        std::uint32_t size;
+
+        char* chars() { return reinterpret_cast<char*>(this + 1); }
+        const char* chars() const
+        {
+            return reinterpret_cast<const char*>(this + 1);
+        }
+        std::string_view text() const { return {chars(), size}; }
+    };
+
+    static Rep* intern(std::string_view text);
+    static void release(Rep* rep);
+
+    Rep* rep_ = nullptr;
+};
+
+template <>
+struct std::hash<InternedString>
+{
+    std::size_t operator()(const InternedString& text) const noexcept
+    {
+        return std::hash<const void*>{}(text.rep_);
+    }
+};
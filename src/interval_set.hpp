@@ -0,0 +1,136 @@
+#pragma once
+
+#include <immer/flex_vector.hpp>
+
+#include <algorithm>
+#include <cstddef>
+
+// Half-open range of list indices [begin, end).
+struct Interval
+{
+    int begin = 0;
+    int end   = 0;
+
+    int size() const { return end - begin; }
+    bool operator==(const Interval&) const = default;
+};
+
+// Persistent set of indices stored as sorted, disjoint and non-adjacent
+// intervals. Selecting 5000 consecutive rows is a single interval, and every
+// update is a couple of binary searches plus take/drop/concat on the
+// underlying flex_vector.
+class IntervalSet
+{
+public:
+    using intervals_t = immer::flex_vector<Interval>;
+
+    const intervals_t& intervals() const { return intervals_; }
+    bool empty() const { return intervals_.empty(); }
+    // Number of indices in the set
+    int count() const { return count_; }
+
+    bool contains(int index) const
+    {
+        auto i = first_ending_after(index);
+        return i < intervals_.size() && intervals_[i].begin <= index;
+    }
+
+    // Adds [begin, end), merging it with any overlapping or adjacent
+    // intervals.
+    IntervalSet insert(int begin, int end) const
+    {
+        if (begin >= end)
+            return *this;
+        // Intervals in [lo, hi) touch the new one and get merged into it
+        auto lo = first_ending_after(begin - 1);
+        auto hi = first_beginning_after(end);
+        Interval merged{begin, end};
+        int removed = 0;
+        for (auto i = lo; i < hi; ++i) {
+            const auto& old = intervals_[i];
+            merged.begin    = std::min(merged.begin, old.begin);
+            merged.end      = std::max(merged.end, old.end);
+            removed += old.size();
+        }
+        return splice(lo, hi, {merged}, merged.size() - removed);
+    }
+
+    // Removes [begin, end), splitting intervals that straddle its bounds.
+    IntervalSet erase(int begin, int end) const
+    {
+        if (begin >= end)
+            return *this;
+        auto lo = first_ending_after(begin);
+        auto hi = first_beginning_after(end - 1);
+        if (lo >= hi)
+            return *this;
+        intervals_t kept;
+        const auto& first = intervals_[lo];
+        const auto& last  = intervals_[hi - 1];
+        if (first.begin < begin)
+            kept = kept.push_back({first.begin, begin});
+        if (last.end > end)
+            kept = kept.push_back({end, last.end});
+        int delta = 0;
+        for (const auto& iv : kept)
+            delta += iv.size();
+        for (auto i = lo; i < hi; ++i)
+            delta -= intervals_[i].size();
+        return splice(lo, hi, kept, delta);
+    }
+
+    IntervalSet toggle(int index) const
+    {
+        return contains(index) ? erase(index, index + 1)
+                               : insert(index, index + 1);
+    }
+
+    bool operator==(const IntervalSet& other) const
+    {
+        return count_ == other.count_ && intervals_ == other.intervals_;
+    }
+
+private:
+    // Index of the first interval whose end is past `index`
+    std::size_t first_ending_after(int index) const
+    {
+        std::size_t lo = 0, hi = intervals_.size();
+        while (lo < hi) {
+            auto mid = lo + (hi - lo) / 2;
+            if (intervals_[mid].end <= index)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return lo;
+    }
+
+    // Index of the first interval beginning after `index`
+    std::size_t first_beginning_after(int index) const
+    {
+        std::size_t lo = 0, hi = intervals_.size();
+        while (lo < hi) {
+            auto mid = lo + (hi - lo) / 2;
+            if (intervals_[mid].begin <= index)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return lo;
+    }
+
+    IntervalSet splice(std::size_t lo,
+                       std::size_t hi,
+                       const intervals_t& replacement,
+                       int count_delta) const
+    {
+        IntervalSet result;
+        result.intervals_ =
+            intervals_.take(lo) + replacement + intervals_.drop(hi);
+        result.count_ = count_ + count_delta;
+        return result;
+    }
+
+    intervals_t intervals_;
+    int count_ = 0;
+};
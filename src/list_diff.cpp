@@ -0,0 +1,416 @@
+#include "list_diff.hpp"
+#include "history.hpp" // History::leaves, History::item_hash
+
+#include <immer/algorithm.hpp>
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+using Match = std::pair<std::size_t, std::size_t>;
+
+// Steps of the search for where to split before settling for the furthest
+// point reached, as GNU diff does: a little longer a script, rather than
+// quadratic time on lists that have little in common
+constexpr std::ptrdiff_t max_cost = 1024;
+
+// Myers' linear space refinement: find a point that a shortest edit script
+// goes through, half way along it, by searching from both ends at once, and
+// diff either side of it on its own
+class Myers
+{
+public:
+    Myers(const std::vector<std::uint64_t>& a,
+          const std::vector<std::uint64_t>& b,
+          std::vector<Match>& matches)
+        : a_(a)
+        , b_(b)
+        , matches_(matches)
+    {
+    }
+
+    void run(std::ptrdiff_t a0,
+             std::ptrdiff_t a1,
+             std::ptrdiff_t b0,
+             std::ptrdiff_t b1)
+    {
+        while (a0 < a1 && b0 < b1 && a_[a0] == b_[b0])
+            matches_.emplace_back(a0++, b0++);
+        std::ptrdiff_t common_end = 0;
+        while (a0 < a1 && b0 < b1 && a_[a1 - 1] == b_[b1 - 1]) {
+            --a1;
+            --b1;
+            ++common_end;
+        }
+        if (a0 < a1 && b0 < b1) {
+            auto [x, y] = split(a0, a1, b0, b1);
+            // Nothing in common, or (should it ever come to that) no way
+            // to make progress: all of one removed and all of the other added
+            if ((x > a0 || y > b0) && (x < a1 || y < b1)) {
+                run(a0, x, b0, y);
+                run(x, a1, y, b1);
+            }
+        }
+        for (std::ptrdiff_t i = 0; i < common_end; ++i)
+            matches_.emplace_back(a1 + i, b1 + i);
+    }
+
+private:
+    // Where the paths from both ends meet, relative to a0 and b0 and then
+    // made absolute; (a0, b0) if they never do
+    std::pair<std::ptrdiff_t, std::ptrdiff_t> split(std::ptrdiff_t a0,
+                                                    std::ptrdiff_t a1,
+                                                    std::ptrdiff_t b0,
+                                                    std::ptrdiff_t b1)
+    {
+        const std::ptrdiff_t n      = a1 - a0;
+        const std::ptrdiff_t m      = b1 - b0;
+        const std::ptrdiff_t max_d  = (n + m + 1) / 2;
+        const std::ptrdiff_t offset = max_d + 1;
+        const std::ptrdiff_t delta  = n - m;
+        const bool front            = delta % 2 != 0;
+        // Furthest x reached on each diagonal, from the start and from the
+        // end; -1 where not reached yet
+        forward_.assign(2 * offset + 1, -1);
+        backward_.assign(2 * offset + 1, -1);
+        std::ptrdiff_t* v1 = forward_.data() + offset;
+        std::ptrdiff_t* v2 = backward_.data() + offset;
+        v1[1]              = 0;
+        v2[1]              = 0;
+        // Diagonals that left the grid are skipped from then on
+        std::ptrdiff_t k1_start = 0, k1_end = 0, k2_start = 0, k2_end = 0;
+        std::ptrdiff_t best_x = 0, best_y = 0; // Furthest from the start
+
+        for (std::ptrdiff_t d = 0; d < max_d; ++d) {
+            if (d == max_cost)
+                return {a0 + best_x, b0 + best_y};
+            for (auto k1 = -d + k1_start; k1 <= d - k1_end; k1 += 2) {
+                std::ptrdiff_t x1;
+                if (k1 == -d || (k1 != d && v1[k1 - 1] < v1[k1 + 1]))
+                    x1 = v1[k1 + 1];
+                else
+                    x1 = v1[k1 - 1] + 1;
+                std::ptrdiff_t y1 = x1 - k1;
+                while (x1 < n && y1 < m && a_[a0 + x1] == b_[b0 + y1]) {
+                    ++x1;
+                    ++y1;
+                }
+                v1[k1] = x1;
+                if (x1 > n) {
+                    k1_end += 2;
+                    continue;
+                } else if (y1 > m) {
+                    k1_start += 2;
+                    continue;
+                }
+                if (x1 + y1 > best_x + best_y) {
+                    best_x = x1;
+                    best_y = y1;
+                }
+                if (front) {
+                    std::ptrdiff_t k2 = delta - k1;
+                    if (k2 >= -offset && k2 <= offset && v2[k2] != -1 &&
+                        x1 >= n - v2[k2])
+                        return {a0 + x1, b0 + y1};
+                }
+            }
+            for (auto k2 = -d + k2_start; k2 <= d - k2_end; k2 += 2) {
+                std::ptrdiff_t x2;
+                if (k2 == -d || (k2 != d && v2[k2 - 1] < v2[k2 + 1]))
+                    x2 = v2[k2 + 1];
+                else
+                    x2 = v2[k2 - 1] + 1;
+                std::ptrdiff_t y2 = x2 - k2;
+                while (x2 < n && y2 < m &&
+                       a_[a1 - 1 - x2] == b_[b1 - 1 - y2]) {
+                    ++x2;
+                    ++y2;
+                }
+                v2[k2] = x2;
+                if (x2 > n) {
+                    k2_end += 2;
+                } else if (y2 > m) {
+                    k2_start += 2;
+                } else if (!front) {
+                    std::ptrdiff_t k1 = delta - k2;
+                    if (k1 >= -offset && k1 <= offset && v1[k1] != -1 &&
+                        v1[k1] >= n - x2)
+                        return {a0 + v1[k1], b0 + v1[k1] - k1};
+                }
+            }
+        }
+        return {a0, b0};
+    }
+
+    const std::vector<std::uint64_t>& a_;
+    const std::vector<std::uint64_t>& b_;
+    std::vector<Match>& matches_;
+    std::vector<std::ptrdiff_t> forward_;
+    std::vector<std::ptrdiff_t> backward_;
+};
+
+// Hashes of items, kept by the leaf of the list they are in. Versions of a
+// list share most of their leaves, and a list is usually diffed again as
+// the old side of the next diff, so a leaf is mostly hashed once. The lists
+// of the last two diffs are held on to: none of the leaves known is freed
+// while known, for another to get its address.
+class HashCache
+{
+public:
+    void start(const TodoList& before, const TodoList& after)
+    {
+        previous_.swap(current_);
+        current_.clear();
+        held_[0] = std::move(held_[2]);
+        held_[1] = std::move(held_[3]);
+        held_[2] = before;
+        held_[3] = after;
+    }
+
+    // Of items [begin, end) of `items`, one of the lists started with
+    std::vector<std::uint64_t> hashes(const TodoList& items,
+                                      std::size_t begin,
+                                      std::size_t end)
+    {
+        std::vector<std::uint64_t> found;
+        found.reserve(end - begin);
+        immer::for_each_chunk(
+            items.begin() + begin,
+            items.begin() + end,
+            [&](const TodoItem* first, const TodoItem* last) {
+                const auto count = std::size_t(last - first);
+                auto known       = current_.find(first);
+                if (known == current_.end() || known->second.size() != count) {
+                    auto earlier = previous_.find(first);
+                    if (earlier != previous_.end() &&
+                        earlier->second.size() == count) {
+                        known = current_.insert_or_assign(first,
+                                                          earlier->second)
+                                    .first;
+                    } else {
+                        std::vector<std::uint64_t> hashed;
+                        hashed.reserve(count);
+                        for (auto item = first; item != last; ++item)
+                            hashed.push_back(History::item_hash(*item));
+                        known = current_
+                                    .insert_or_assign(first, std::move(hashed))
+                                    .first;
+                    }
+                }
+                found.insert(
+                    found.end(), known->second.begin(), known->second.end());
+            });
+        return found;
+    }
+
+private:
+    using Leaves =
+        std::unordered_map<const TodoItem*, std::vector<std::uint64_t>>;
+
+    Leaves current_;  // Of the lists of this diff
+    Leaves previous_; // Of the last one
+    TodoList held_[4];
+};
+
+// Each thread diffs with its own
+HashCache& hash_cache()
+{
+    thread_local HashCache cache;
+    return cache;
+}
+
+// Equal, found without comparing them when both are the item of a leaf both
+// lists share
+bool same_item(const TodoItem& a, const TodoItem& b)
+{
+    return &a == &b || a == b;
+}
+
+std::vector<std::uint64_t> slice(const std::vector<std::uint64_t>& hashes,
+                                 std::size_t begin,
+                                 std::size_t end)
+{
+    return {hashes.begin() + std::ptrdiff_t(begin),
+            hashes.begin() + std::ptrdiff_t(end)};
+}
+
+} // namespace
+
+std::vector<std::pair<std::size_t, std::size_t>>
+common_subsequence(const std::vector<std::uint64_t>& a,
+                   const std::vector<std::uint64_t>& b)
+{
+    // What only one side has can't be matched. Leaving it out first costs a
+    // lookup per element and saves Myers from wading through it (two lists
+    // with nothing in common take no time at all).
+    const std::unordered_set<std::uint64_t> in_a(a.begin(), a.end());
+    const std::unordered_set<std::uint64_t> in_b(b.begin(), b.end());
+    std::vector<std::uint64_t> shared_a, shared_b;
+    std::vector<std::size_t> a_at, b_at;
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        if (in_b.count(a[i])) {
+            shared_a.push_back(a[i]);
+            a_at.push_back(i);
+        }
+    }
+    for (std::size_t j = 0; j < b.size(); ++j) {
+        if (in_a.count(b[j])) {
+            shared_b.push_back(b[j]);
+            b_at.push_back(j);
+        }
+    }
+
+    std::vector<Match> matches;
+    Myers(shared_a, shared_b, matches)
+        .run(0,
+             std::ptrdiff_t(shared_a.size()),
+             0,
+             std::ptrdiff_t(shared_b.size()));
+    for (auto& [i, j] : matches) {
+        i = a_at[i];
+        j = b_at[j];
+    }
+    return matches;
+}
+
+ListDiff diff_lists(const TodoList& before, const TodoList& after)
+{
+    ListDiff diff;
+    std::vector<std::size_t> hunks; // Of each edit, a run of them together
+    auto hunk = [&](std::size_t removed_begin,
+                    std::size_t removed_end,
+                    std::size_t added_begin,
+                    std::size_t added_end) {
+        if (removed_begin == removed_end && added_begin == added_end)
+            return;
+        const std::size_t id = hunks.empty() ? 0 : hunks.back() + 1;
+        for (std::size_t i = removed_begin; i < removed_end; ++i)
+            diff.edits.push_back({ListChange::Removed, i, added_begin});
+        for (std::size_t j = added_begin; j < added_end; ++j)
+            diff.edits.push_back({ListChange::Added, removed_end, j});
+        hunks.resize(diff.edits.size(), id);
+    };
+
+    // What both lists start and end with is left out: usually most of
+    // them, and mostly the very same leaves
+    const std::size_t shortest = std::min(before.size(), after.size());
+    std::size_t prefix         = 0;
+    for (auto a = before.begin(), b = after.begin();
+         prefix < shortest && same_item(*a, *b);
+         ++a, ++b)
+        ++prefix;
+    std::size_t suffix = 0;
+    for (auto a = before.end(), b = after.end(); prefix + suffix < shortest;
+         ++suffix) {
+        if (!same_item(*--a, *--b))
+            break;
+    }
+    const std::size_t old_size = before.size() - prefix - suffix;
+    const std::size_t new_size = after.size() - prefix - suffix;
+
+    // Leaves in both of the rest first, then item by item between them
+    HashCache& cache = hash_cache();
+    cache.start(before, after);
+    const auto a          = cache.hashes(before, prefix, prefix + old_size);
+    const auto b          = cache.hashes(after, prefix, prefix + new_size);
+    const auto old_leaves = History::leaves(a);
+    const auto new_leaves = History::leaves(b);
+    std::vector<std::uint64_t> old_hashes, new_hashes;
+    for (const auto& leaf : old_leaves)
+        old_hashes.push_back(leaf.hash);
+    for (const auto& leaf : new_leaves)
+        new_hashes.push_back(leaf.hash);
+    auto same_leaves = common_subsequence(old_hashes, new_hashes);
+    same_leaves.emplace_back(old_leaves.size(), new_leaves.size());
+
+    std::size_t old_at = 0, new_at = 0; // Items up to there are done
+    for (auto [i, j] : same_leaves) {
+        const std::size_t old_end =
+            i < old_leaves.size() ? old_leaves[i].begin : old_size;
+        const std::size_t new_end =
+            j < new_leaves.size() ? new_leaves[j].begin : new_size;
+        if (old_at < old_end && new_at < new_end) {
+            diff.items_compared += old_end - old_at + new_end - new_at;
+            auto same_items = common_subsequence(slice(a, old_at, old_end),
+                                                 slice(b, new_at, new_end));
+            same_items.emplace_back(old_end - old_at, new_end - new_at);
+            std::size_t p = 0, q = 0;
+            for (auto [x, y] : same_items) {
+                hunk(prefix + old_at + p,
+                     prefix + old_at + x,
+                     prefix + new_at + q,
+                     prefix + new_at + y);
+                p = x + 1;
+                q = y + 1;
+            }
+        } else {
+            hunk(prefix + old_at,
+                 prefix + old_end,
+                 prefix + new_at,
+                 prefix + new_end);
+        }
+        if (i < old_leaves.size()) {
+            old_at = old_leaves[i].end;
+            new_at = new_leaves[j].end;
+        }
+    }
+
+    // An id both removed and added is the same item, edited or moved
+    std::unordered_map<std::uint64_t, std::size_t> removed_ids;
+    for (std::size_t e = 0; e < diff.edits.size(); ++e) {
+        const ListEdit& edit = diff.edits[e];
+        if (edit.change == ListChange::Removed && before[edit.before].id != 0)
+            removed_ids.emplace(before[edit.before].id, e);
+    }
+    std::vector<bool> paired(diff.edits.size(), false);
+    for (std::size_t e = 0; e < diff.edits.size(); ++e) {
+        ListEdit& edit = diff.edits[e];
+        if (edit.change != ListChange::Added)
+            continue;
+        auto removed = removed_ids.find(after[edit.after].id);
+        if (removed == removed_ids.end() || paired[removed->second])
+            continue;
+        paired[removed->second] = true;
+        edit.before             = diff.edits[removed->second].before;
+        edit.change             = hunks[removed->second] == hunks[e]
+                                      ? ListChange::Changed
+                                      : ListChange::Moved;
+    }
+
+    std::size_t kept = 0;
+    for (std::size_t e = 0; e < diff.edits.size(); ++e) {
+        if (paired[e])
+            continue;
+        const ListEdit& edit = diff.edits[kept++] = diff.edits[e];
+        switch (edit.change) {
+        case ListChange::Added: ++diff.added; break;
+        case ListChange::Removed: ++diff.removed; break;
+        case ListChange::Changed: ++diff.changed; break;
+        case ListChange::Moved: ++diff.moved; break;
+        }
+    }
+    diff.edits.resize(kept);
+    return diff;
+}
+
+std::string changed_fields(const TodoItem& before, const TodoItem& after)
+{
+    std::string fields;
+    auto field = [&](bool differs, const char* name) {
+        if (!differs)
+            return;
+        if (!fields.empty())
+            fields += ", ";
+        fields += name;
+    };
+    field(before.text != after.text, "text");
+    field(before.done != after.done, "done");
+    field(before.due != after.due, "due");
+    field(before.priority != after.priority, "priority");
+    field(before.subtasks != after.subtasks, "subtasks");
+    field(before.done_at != after.done_at && before.done == after.done,
+          "done at");
+    return fields;
+}
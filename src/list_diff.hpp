@@ -0,0 +1,67 @@
+#pragma once
+
+#include "state.hpp" // TodoList
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// What changed between two versions of a list, item by item, for lists far
+// too long to compare every item with every other.
+//
+// The items both lists start and end with are skipped first, compared
+// where they aren't the very same item of a leaf both lists share (most
+// are: versions of a list share all but the leaves edited). What is left
+// in between is cut into leaves the way the history stores them (see
+// History::leaves), and the leaves are diffed by hash: a leaf in both is a
+// run of items in both, which is never looked at again. Only the windows
+// between such runs are diffed item by item. Both levels use Myers'
+// algorithm in its linear space form. Item hashes are kept, per thread, by
+// the leaf of the list they are in, for the next diff of the same lists.
+//
+// So a diff reads the items up to the first and from the last change, and
+// otherwise takes time with the size of what changed and hashes the items
+// of leaves it hasn't seen; memory goes with the size of what is between
+// the first and the last change.
+//
+// An item removed and added again with the same id was edited where it is
+// (Changed) or, if it is now somewhere else, moved (Moved).
+enum class ListChange
+{
+    Added,
+    Removed,
+    Changed,
+    Moved,
+};
+
+struct ListEdit
+{
+    ListChange change;
+    std::size_t before = 0; // Index in the old list, unless Added
+    std::size_t after  = 0; // Index in the new list, unless Removed
+};
+
+struct ListDiff
+{
+    std::vector<ListEdit> edits; // In the order of the new list
+    std::size_t added          = 0;
+    std::size_t removed        = 0;
+    std::size_t changed        = 0;
+    std::size_t moved          = 0;
+    std::size_t items_compared = 0; // In windows diffed item by item
+
+    bool empty() const { return edits.empty(); }
+};
+
+ListDiff diff_lists(const TodoList& before, const TodoList& after);
+
+// What differs between two versions of an item, e.g. "done, priority"
+std::string changed_fields(const TodoItem& before, const TodoItem& after);
+
+// The pairs (i, j) such that a[i] == b[j] in a longest common subsequence
+// of `a` and `b`, in increasing order
+std::vector<std::pair<std::size_t, std::size_t>>
+common_subsequence(const std::vector<std::uint64_t>& a,
+                   const std::vector<std::uint64_t>& b);
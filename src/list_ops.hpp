@@ -0,0 +1,75 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+
+// Structural edits on immer::flex_vector expressed with take/drop and
+// concatenation. On RRB-trees each of these is O(log n) and shares all
+// untouched leaves with the input, unlike rebuilding the vector element by
+// element.
+namespace ListOps {
+
+// Removes the half-open range [begin, end).
+template <typename Vector>
+Vector erase_range(const Vector& v, std::size_t begin, std::size_t end)
+{
+    return v.take(begin) + v.drop(end);
+}
+
+// Inserts `value` so that it ends up at position `index`.
+template <typename Vector>
+Vector insert_at(const Vector& v,
+                 std::size_t index,
+                 typename Vector::value_type value)
+{
+    return v.take(index).push_back(std::move(value)) + v.drop(index);
+}
+
+// Moves the half-open range [begin, end) so that its first element ends up
+// at position `to` of the result. `to` is clamped to the valid positions.
+template <typename Vector>
+Vector
+move_range(const Vector& v, std::size_t begin, std::size_t end, std::size_t to)
+{
+    auto block = v.drop(begin).take(end - begin);
+    auto rest  = erase_range(v, begin, end);
+    if (to > rest.size())
+        to = rest.size();
+    return rest.take(to) + block + rest.drop(to);
+}
+
+// Removes every range in `ranges` (sorted, disjoint, with begin/end members)
+// in a single pass by concatenating the slices between them.
+template <typename Vector, typename Ranges>
+Vector erase_ranges(const Vector& v, const Ranges& ranges)
+{
+    Vector result;
+    std::size_t kept_from = 0;
+    for (const auto& r : ranges) {
+        result    = result + v.drop(kept_from).take(r.begin - kept_from);
+        kept_from = r.end;
+    }
+    return result + v.drop(kept_from);
+}
+
+// Replaces every element inside `ranges` with fn(element). Only the ranges
+// are rebuilt, the slices between them are shared with `v`.
+template <typename Vector, typename Ranges, typename Fn>
+Vector update_ranges(const Vector& v, const Ranges& ranges, Fn&& fn)
+{
+    Vector result;
+    std::size_t kept_from = 0;
+    for (const auto& r : ranges) {
+        auto segment = Vector{}.transient();
+        std::for_each(v.begin() + r.begin,
+                      v.begin() + r.end,
+                      [&](const auto& x) { segment.push_back(fn(x)); });
+        result = result + v.drop(kept_from).take(r.begin - kept_from) +
+                 segment.persistent();
+        kept_from = r.end;
+    }
+    return result + v.drop(kept_from);
+}
+
+} // namespace ListOps
@@ -0,0 +1,478 @@
+#include "list_search.hpp"
+#include "lz.hpp"
+#include "persistence.hpp"
+#include "state.hpp" // AppState, valid_list_name
+#include "trace.hpp" // TraceScope
+
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define LIST_SEARCH_HAVE_AVX2_KERNEL 1
+#include <immintrin.h>
+#endif
+
+#ifdef _WIN32
+#include <fstream>
+#include <iterator>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Bytes scanned between checks for a newer search
+constexpr std::size_t block_size = 4 << 20;
+
+char lower(char c) { return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c; }
+
+bool equal_ignoring_case(const char* text, std::string_view needle)
+{
+    for (std::size_t i = 0; i < needle.size(); ++i) {
+        if (lower(text[i]) != needle[i])
+            return false;
+    }
+    return true;
+}
+
+#ifdef LIST_SEARCH_HAVE_AVX2_KERNEL
+// 32 candidate positions per iteration: those where both the first and the
+// last byte of the needle match (letters folded to lower case by setting
+// 0x20) are checked in full.
+__attribute__((target("avx2"))) std::size_t
+find_avx2(std::string_view text, std::string_view needle)
+{
+    const std::size_t m = needle.size();
+    auto is_letter      = [](char c) { return c >= 'a' && c <= 'z'; };
+    const __m256i first = _mm256_set1_epi8(needle.front());
+    const __m256i last  = _mm256_set1_epi8(needle.back());
+    const __m256i fold_first =
+        _mm256_set1_epi8(is_letter(needle.front()) ? 0x20 : 0);
+    const __m256i fold_last =
+        _mm256_set1_epi8(is_letter(needle.back()) ? 0x20 : 0);
+
+    const char* data = text.data();
+    std::size_t i    = 0;
+    for (; i + m - 1 + 32 <= text.size(); i += 32) {
+        __m256i a  = _mm256_loadu_si256((const __m256i*)(data + i));
+        __m256i b  = _mm256_loadu_si256((const __m256i*)(data + i + m - 1));
+        __m256i eq = _mm256_and_si256(
+            _mm256_cmpeq_epi8(_mm256_or_si256(a, fold_first), first),
+            _mm256_cmpeq_epi8(_mm256_or_si256(b, fold_last), last));
+        unsigned lanes = static_cast<unsigned>(_mm256_movemask_epi8(eq));
+        while (lanes) {
+            std::size_t at = i + __builtin_ctz(lanes);
+            if (equal_ignoring_case(data + at, needle))
+                return at;
+            lanes &= lanes - 1;
+        }
+    }
+    std::size_t rest = find_ignoring_case_scalar(text.substr(i), needle);
+    return rest == std::string_view::npos ? rest : i + rest;
+}
+#endif
+
+// The file's bytes. Read rather than mapped: lists are saved by truncating
+// and rewriting them in place, and a mapping of a file cut short under it
+// faults on the pages past its new end.
+std::string read_file(const std::filesystem::path& path)
+{
+    std::string bytes;
+#ifdef _WIN32
+    std::ifstream in(path, std::ios::binary);
+    bytes.assign(std::istreambuf_iterator<char>(in),
+                 std::istreambuf_iterator<char>());
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return bytes;
+    struct stat st;
+    if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+        bytes.resize(static_cast<std::size_t>(st.st_size));
+        std::size_t done = 0;
+        while (done < bytes.size()) {
+            ssize_t got = ::pread(fd,
+                                  bytes.data() + done,
+                                  bytes.size() - done,
+                                  static_cast<off_t>(done));
+            if (got < 0 && errno == EINTR)
+                continue;
+            if (got <= 0) // Cut short since, or unreadable
+                break;
+            done += static_cast<std::size_t>(got);
+        }
+        bytes.resize(done);
+    }
+    ::close(fd);
+#endif
+    return bytes;
+}
+
+std::size_t skip_space(std::string_view text, std::size_t at)
+{
+    while (at < text.size() &&
+           (text[at] == ' ' || text[at] == '\n' || text[at] == '\r' ||
+            text[at] == '\t'))
+        ++at;
+    return at;
+}
+
+// Where the contents of the file's "strings" array start (after its '['),
+// or npos for files from before the strings table
+std::size_t strings_table(std::string_view text)
+{
+    constexpr std::string_view key = "\"strings\"";
+    for (auto at = text.find(key); at != std::string_view::npos;
+         at     = text.find(key, at + 1)) {
+        // A key is followed by ':', a text that happens to be "strings" isn't
+        std::size_t colon = skip_space(text, at + key.size());
+        if (colon < text.size() && text[colon] == ':') {
+            std::size_t open = skip_space(text, colon + 1);
+            if (open < text.size() && text[open] == '[')
+                return open + 1;
+        }
+    }
+    return std::string_view::npos;
+}
+
+// Where the string literal whose opening quote is at `at` ends (its closing
+// quote), or npos if it doesn't
+std::size_t string_end(std::string_view text, std::size_t at)
+{
+    std::size_t end = at;
+    while (true) {
+        auto quote = static_cast<const char*>(
+            std::memchr(text.data() + end + 1, '"', text.size() - end - 1));
+        if (!quote)
+            return std::string_view::npos;
+        end = std::size_t(quote - text.data());
+        // Escaped if after an odd number of backslashes
+        std::size_t slashes = 0;
+        while (text[end - 1 - slashes] == '\\')
+            ++slashes;
+        if (slashes % 2 == 0)
+            return end;
+    }
+}
+
+// Whether a string literal (quotes included) holds `needle`. The escaped
+// needle can also match across an escape ("n" in "\n"), so the decoded text
+// is checked again; it is returned if it does.
+std::optional<std::string> literal_match(std::string_view literal,
+                                         const std::string& needle,
+                                         const std::string& escaped)
+{
+    auto inside = literal.substr(1, literal.size() - 2);
+    if (find_ignoring_case(inside, escaped) == std::string_view::npos)
+        return std::nullopt;
+    try {
+        auto decoded = nlohmann::json::parse(literal).get<std::string>();
+        if (find_ignoring_case(decoded, needle) != std::string_view::npos)
+            return decoded;
+    } catch (const nlohmann::json::exception&) {
+    }
+    return std::nullopt;
+}
+
+// Calls fn(index, literal) for each string of the array whose contents start
+// at `at`, the literal with its quotes. Returns where the array ends.
+template <typename Fn>
+std::size_t for_each_string(std::string_view text, std::size_t at, Fn&& fn)
+{
+    std::size_t index = 0;
+    while (at < text.size() && text[at] != ']') {
+        if (text[at] != '"') { // Space or comma
+            ++at;
+            continue;
+        }
+        std::size_t end = string_end(text, at);
+        if (end == std::string_view::npos)
+            return text.size();
+        fn(index++, text.substr(at, end + 1 - at));
+        at = end + 1;
+    }
+    return at;
+}
+
+// The object around position `at`, braces included. Only for items of files
+// with a strings table whose objects hold no text that could hold braces.
+std::string_view enclosing_object(std::string_view text, std::size_t at)
+{
+    std::size_t begin = at;
+    for (int depth = 0; begin-- > 0;) {
+        if (text[begin] == '}')
+            ++depth;
+        else if (text[begin] == '{' && depth-- == 0)
+            break;
+    }
+    std::size_t end = at;
+    for (int depth = 0; end < text.size(); ++end) {
+        if (text[end] == '{')
+            ++depth;
+        else if (text[end] == '}' && depth-- == 0)
+            break;
+    }
+    if (begin == std::string_view::npos || end == text.size())
+        return {};
+    return text.substr(begin, end + 1 - begin);
+}
+
+// Items (subtasks and board columns included) whose text contains `needle`,
+// in a file the kernel found it (as `escaped`) in, with its strings table at
+// `table`. Only the texts and the records that refer to the matching ones
+// are parsed. Items may also have their text inline rather than in the
+// table, where it is checked too; if one matches or holds braces, the
+// records can't be told apart without parsing, and nullopt has the file
+// parsed whole.
+std::optional<std::vector<ListSearchMatch>>
+match_records(const std::string& list,
+              std::string_view text,
+              std::size_t table,
+              const std::string& needle,
+              const std::string& escaped,
+              std::size_t max_matches)
+{
+    std::vector<ListSearchMatch> found;
+
+    // Which texts match, by position in the table
+    std::vector<std::pair<std::size_t, std::string>> texts;
+    auto collect = [&](std::size_t index, std::string_view literal) {
+        if (auto decoded = literal_match(literal, needle, escaped))
+            texts.emplace_back(index, std::move(*decoded));
+    };
+    std::size_t table_end = for_each_string(text, table, collect);
+
+    // The items referring to them
+    constexpr std::string_view key = "\"text\"";
+    for (auto at = text.find(key);
+         at != std::string_view::npos && found.size() < max_matches;
+         at = text.find(key, at + 1)) {
+        if (at >= table && at < table_end) {
+            at = table_end;
+            continue;
+        }
+        std::size_t value = skip_space(text, at + key.size());
+        if (value >= text.size() || text[value] != ':')
+            continue;
+        value = skip_space(text, value + 1);
+        if (value < text.size() && text[value] == '"') {
+            std::size_t end = string_end(text, value);
+            if (end == std::string_view::npos)
+                break;
+            // Braces in it would throw off enclosing_object() for the items
+            // around it, which come later in the file
+            auto literal = text.substr(value, end + 1 - value);
+            if (literal.find_first_of("{}") != std::string_view::npos ||
+                literal_match(literal, needle, escaped))
+                return std::nullopt;
+            at = end;
+            continue;
+        }
+        std::size_t index   = 0;
+        std::size_t numeral = value;
+        while (numeral < text.size() && text[numeral] >= '0' &&
+               text[numeral] <= '9')
+            index = index * 10 + std::size_t(text[numeral++] - '0');
+        if (numeral == value)
+            continue;
+        auto match = std::lower_bound(
+            texts.begin(), texts.end(), index, [](const auto& t, auto i) {
+                return t.first < i;
+            });
+        if (match == texts.end() || match->first != index)
+            continue;
+        try {
+            auto item = nlohmann::json::parse(enclosing_object(text, at));
+            found.push_back({list,
+                             item.value("id", std::uint64_t{0}),
+                             item.value("done", false),
+                             match->second});
+        } catch (const nlohmann::json::exception&) {
+        }
+    }
+    return found;
+}
+
+// Files from before the strings table are parsed whole
+void match_items(const std::string& list,
+                 const TodoList& items,
+                 const std::string& needle,
+                 std::size_t max_matches,
+                 std::vector<ListSearchMatch>& found)
+{
+    for (const auto& item : items) {
+        if (found.size() >= max_matches)
+            return;
+        if (find_ignoring_case(item.text, needle) != std::string_view::npos)
+            found.push_back({list, item.id, item.done, std::string(item.text)});
+        match_items(list, subtask_items(item), needle, max_matches, found);
+    }
+}
+
+} // namespace
+
+std::size_t find_ignoring_case_scalar(std::string_view text,
+                                      std::string_view needle)
+{
+    if (needle.empty())
+        return 0;
+    for (std::size_t i = 0; i + needle.size() <= text.size(); ++i) {
+        if (lower(text[i]) == needle[0] &&
+            equal_ignoring_case(text.data() + i, needle))
+            return i;
+    }
+    return std::string_view::npos;
+}
+
+bool list_search_vectorized()
+{
+#ifdef LIST_SEARCH_HAVE_AVX2_KERNEL
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    return has_avx2;
+#else
+    return false;
+#endif
+}
+
+std::size_t find_ignoring_case(std::string_view text, std::string_view needle)
+{
+#ifdef LIST_SEARCH_HAVE_AVX2_KERNEL
+    if (!needle.empty() && list_search_vectorized())
+        return find_avx2(text, needle);
+#endif
+    return find_ignoring_case_scalar(text, needle);
+}
+
+// Shared with the tasks, which may outlive the search.
+struct ListSearch::Shared
+{
+    std::atomic<std::uint64_t> generation{0}; // Of the latest search
+    std::mutex mutex;
+    ListSearchResults results; // Of the latest search
+};
+
+ListSearch::ListSearch(ThreadPool& pool, std::size_t max_matches)
+    : pool_(pool)
+    , max_matches_(max_matches)
+    , shared_(std::make_shared<Shared>())
+{
+}
+
+void ListSearch::search(const std::filesystem::path& directory,
+                        const std::string& text)
+{
+    // Tasks of the previous search notice this and stop
+    const std::uint64_t generation = ++shared_->generation;
+
+    std::vector<std::pair<std::string, std::filesystem::path>> files;
+    std::uint64_t bytes = 0;
+    std::error_code error;
+    for (const auto& entry :
+         std::filesystem::directory_iterator(directory, error)) {
+        std::string name = entry.path().stem().string();
+        if (entry.path().extension() == ".json" && valid_list_name(name)) {
+            bytes += entry.file_size(error);
+            files.emplace_back(std::move(name), entry.path());
+        }
+    }
+
+    std::string needle;
+    for (char c : text)
+        needle += lower(c);
+    // As it is written in the files, where quotes and backslashes are escaped
+    std::string escaped = nlohmann::json(needle).dump(
+        -1, ' ', false, nlohmann::json::error_handler_t::ignore);
+    escaped             = escaped.substr(1, escaped.size() - 2);
+    {
+        std::lock_guard<std::mutex> lock(shared_->mutex);
+        shared_->results       = ListSearchResults{};
+        shared_->results.files = files.size();
+        shared_->results.bytes = bytes;
+        if (needle.empty())
+            shared_->results.files_scanned = files.size();
+    }
+    if (needle.empty())
+        return;
+
+    for (auto& [name, path] : files) {
+        pool_.submit([shared = shared_,
+                      pool   = &pool_,
+                      generation,
+                      list = std::move(name),
+                      path = std::move(path),
+                      needle,
+                      escaped,
+                      max_matches = max_matches_] {
+            if (shared->generation != generation)
+                return;
+            TraceScope traced{"search list", "search"};
+
+            // Most files stop here, the kernel finds nothing
+            const std::string contents = read_file(path);
+            std::string_view text      = contents;
+            std::string unpacked; // A compressed file, searched as JSON
+            if (Lz::is_frame(text)) {
+                if (auto bytes = Lz::decompress_frame(text, *pool))
+                    unpacked = std::move(*bytes);
+                text = unpacked;
+            }
+            bool hit = false;
+            for (std::size_t at = 0; at < text.size() && !hit;
+                 at += block_size) {
+                if (shared->generation != generation)
+                    return;
+                // Blocks overlap so as not to miss a text across two
+                hit = find_ignoring_case(
+                          text.substr(at, block_size + escaped.size() - 1),
+                          escaped) != std::string_view::npos;
+            }
+
+            std::optional<std::vector<ListSearchMatch>> records;
+            std::size_t table = hit ? strings_table(text) : 0;
+            if (hit && table != std::string_view::npos)
+                records = match_records(
+                    list, text, table, needle, escaped, max_matches);
+
+            std::vector<ListSearchMatch> found;
+            if (records) {
+                found = std::move(*records);
+            } else if (hit) {
+                if (auto state = Persistence::load_state(path)) {
+                    match_items(list, state->todos, needle, max_matches, found);
+                    for (const auto& column : state->columns)
+                        match_items(
+                            list, column.items, needle, max_matches, found);
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(shared->mutex);
+            if (shared->generation != generation)
+                return;
+            auto& results = shared->results;
+            for (auto& match : found) {
+                if (results.matches.size() >= max_matches) {
+                    results.truncated = true;
+                    break;
+                }
+                results.matches.push_back(std::move(match));
+            }
+            ++results.files_scanned;
+        });
+    }
+}
+
+ListSearchResults ListSearch::results() const
+{
+    std::lock_guard<std::mutex> lock(shared_->mutex);
+    return shared_->results;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "thread_pool.hpp" // ThreadPool
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Position of the first occurrence of `needle` in `text`, ignoring ASCII
+// case, or npos. `needle` must be lower case. Compares the needle's first
+// and last bytes 32 positions at a time, with AVX2 when the CPU has it.
+std::size_t find_ignoring_case(std::string_view text, std::string_view needle);
+
+// The portable kernel, exposed for benchmarking against the vectorized one.
+std::size_t find_ignoring_case_scalar(std::string_view text,
+                                      std::string_view needle);
+
+// Whether find_ignoring_case runs the AVX2 kernel on this machine
+bool list_search_vectorized();
+
+struct ListSearchMatch
+{
+    std::string list; // Name of the list (its file without ".json")
+    std::uint64_t id = 0;
+    bool done        = false;
+    std::string text;
+};
+
+struct ListSearchResults
+{
+    std::vector<ListSearchMatch> matches; // In the order they were found
+    std::size_t files_scanned = 0;
+    std::size_t files         = 0;
+    std::uint64_t bytes       = 0; // Of all the files
+    bool truncated            = false; // Stopped at the maximum
+
+    bool done() const { return files_scanned == files; }
+};
+
+// Searches the files of every list in a directory for items containing a
+// text, in the background, one file per task on the pool. Most files are
+// ruled out by the substring kernel alone, run over their bytes as read;
+// only in files where it finds the text are the records around the hits
+// parsed, to know which items they are. Matches show up in results() as
+// each file is done. Starting a new search abandons the previous one.
+//
+// What is searched is the files, so edits to the open list that aren't
+// saved yet aren't found.
+class ListSearch
+{
+public:
+    explicit ListSearch(ThreadPool& pool, std::size_t max_matches = 500);
+
+    void search(const std::filesystem::path& directory,
+                const std::string& text);
+
+    // Matches found so far by the latest search. Thread-safe.
+    ListSearchResults results() const;
+
+private:
+    struct Shared;
+
+    ThreadPool& pool_;
+    std::size_t max_matches_;
+    std::shared_ptr<Shared> shared_;
+};
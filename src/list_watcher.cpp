@@ -0,0 +1,162 @@
+#include "list_watcher.hpp"
+#include "trace.hpp" // TraceScope, trace_thread_name
+#include "workspace.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <chrono>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr auto tick = std::chrono::milliseconds(250); // Checks for stopping
+
+// Writers often save in steps (truncate, write, rename): the file is read
+// once they have been quiet for this long
+constexpr auto settle = std::chrono::milliseconds(100);
+
+ChangeMergedAction merge_change(AppState edited,
+                                ListChangedOnDiskAction change)
+{
+    TraceScope traced{"merge change", "watcher"};
+    ChangeMergedAction merged{std::move(change.list),
+                              std::move(change.before),
+                              std::move(change.after),
+                              std::nullopt,
+                              std::nullopt,
+                              {}};
+    if (merged.before && merged.after)
+        merged.merged = merge_changed_lists(
+            edited, *merged.before, *merged.after, merged.reminders);
+    merged.edited = std::move(edited);
+    return merged;
+}
+
+} // namespace
+
+AppEffect merge_change_effect(AppState edited, ListChangedOnDiskAction change)
+{
+    return [edited, change](lager::context<Action> ctx) {
+        if (global_list_watcher)
+            global_list_watcher->merge(edited, change);
+        else
+            ctx.dispatch(merge_change(edited, change));
+    };
+}
+
+ListWatcher::ListWatcher(Workspace& workspace)
+    : workspace_(workspace)
+{
+#ifdef __linux__
+    inotify_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_ >= 0 &&
+        ::inotify_add_watch(inotify_,
+                            workspace_.directory().c_str(),
+                            IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        ::close(inotify_);
+        inotify_ = -1;
+    }
+    if (inotify_ < 0)
+        spdlog::warn("inotify unavailable, checking list files every second");
+#endif
+    thread_ = std::thread([this] { run(); });
+}
+
+ListWatcher::~ListWatcher()
+{
+    stopping_ = true;
+    thread_.join();
+#ifdef __linux__
+    if (inotify_ >= 0)
+        ::close(inotify_);
+#endif
+}
+
+void ListWatcher::poll(const Dispatch& dispatch)
+{
+    if (!has_ready_.load(std::memory_order_acquire))
+        return;
+    std::vector<Action> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ready.swap(ready_);
+        has_ready_.store(false, std::memory_order_relaxed);
+    }
+    for (auto& action : ready)
+        dispatch(std::move(action));
+}
+
+void ListWatcher::merge(AppState edited, ListChangedOnDiskAction change)
+{
+    merging_.submit([this,
+                     edited = std::move(edited),
+                     change = std::move(change)]() mutable {
+        auto merged = merge_change(std::move(edited), std::move(change));
+        std::lock_guard<std::mutex> lock(mutex_);
+        ready_.push_back(std::move(merged));
+        has_ready_.store(true, std::memory_order_release);
+    });
+}
+
+void ListWatcher::run()
+{
+    trace_thread_name("list watcher");
+    while (!stopping_) {
+        if (!wait())
+            continue;
+        TraceScope traced{"reload", "watcher"};
+        auto changed = workspace_.reload_if_changed();
+        if (!changed)
+            continue;
+        ListChangedOnDiskAction action{std::move(changed->name),
+                                       std::move(changed->before),
+                                       std::move(changed->after),
+                                       std::move(changed->reminders)};
+        std::lock_guard<std::mutex> lock(mutex_);
+        ready_.push_back(std::move(action));
+        has_ready_.store(true, std::memory_order_release);
+    }
+}
+
+bool ListWatcher::wait()
+{
+#ifdef __linux__
+    if (inotify_ >= 0) {
+        // Events name the file; only lists are of interest, not the
+        // sidecar, archives, histories or this program's temporary files
+        alignas(inotify_event) char buffer[4096];
+        bool written = false;
+        auto drain   = [&] {
+            ssize_t size;
+            while ((size = ::read(inotify_, buffer, sizeof buffer)) > 0) {
+                for (ssize_t at = 0; at < size;) {
+                    auto* event = reinterpret_cast<inotify_event*>(buffer + at);
+                    std::string_view name =
+                        event->len > 0 ? event->name : "";
+                    written = written || name.ends_with(".json");
+                    at += sizeof(inotify_event) + event->len;
+                }
+            }
+        };
+        pollfd watched{inotify_, POLLIN, 0};
+        if (::poll(&watched, 1, static_cast<int>(tick.count())) <= 0)
+            return false;
+        drain();
+        while (written && !stopping_ &&
+               ::poll(&watched, 1, static_cast<int>(settle.count())) > 0)
+            drain();
+        return written;
+    }
+#endif
+    for (int i = 0; i < 4 && !stopping_; ++i)
+        std::this_thread::sleep_for(tick);
+    return !stopping_;
+}
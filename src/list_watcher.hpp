@@ -0,0 +1,51 @@
+#pragma once
+
+#include "state.hpp"       // Action, Dispatch
+#include "thread_pool.hpp" // ThreadPool
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class Workspace;
+
+// Notices when the file of the list shown is written by another program (a
+// sync client, a script, an editor) and reads it again, on a thread of its
+// own (see Workspace::reload_if_changed): on Linux as soon as inotify says a
+// list file in the workspace's directory was written, elsewhere by looking
+// at the file's modification time every second. What changed is handed to
+// the UI thread as a ListChangedOnDiskAction. The reducer takes it in one
+// step if the list wasn't edited since it was saved; otherwise the change
+// is merged with the edits on a second thread (see merge), and handed over
+// as a ChangeMergedAction.
+class ListWatcher
+{
+public:
+    explicit ListWatcher(Workspace& workspace);
+    ~ListWatcher(); // Stops within a quarter of a second
+
+    ListWatcher(const ListWatcher&)            = delete;
+    ListWatcher& operator=(const ListWatcher&) = delete;
+
+    // Dispatches the changes read since the last call. An atomic load when
+    // there are none, so it runs every frame.
+    void poll(const Dispatch& dispatch);
+
+    // Merges `change` with the edits of `edited` (see merge_changed_lists)
+    // for the next poll. Thread-safe.
+    void merge(AppState edited, ListChangedOnDiskAction change);
+
+private:
+    void run();
+    bool wait(); // For a list file to be written, or a while
+
+    Workspace& workspace_;
+    int inotify_ = -1; // Or polling
+    std::atomic<bool> stopping_{false};
+    std::atomic<bool> has_ready_{false};
+    std::mutex mutex_;
+    std::vector<Action> ready_;
+    ThreadPool merging_{1}; // Finishes its merges before ready_ goes
+    std::thread thread_;
+};
@@ -0,0 +1,274 @@
+#include "lz.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+constexpr std::size_t min_match  = 4;
+constexpr std::size_t max_offset = 65535;
+constexpr int hash_bits          = 14;
+// LZ4's limits near the end of a block (the last bytes are literals), which
+// decoders that copy whole words rely on
+constexpr std::size_t last_literals = 5;
+constexpr std::size_t match_margin  = 12;
+
+std::uint32_t read32(const char* at)
+{
+    std::uint32_t value;
+    std::memcpy(&value, at, sizeof(value));
+    return value;
+}
+
+void put32(std::string& out, std::uint32_t value)
+{
+    for (int i = 0; i < 4; ++i)
+        out += static_cast<char>(value >> (8 * i));
+}
+
+std::uint32_t get32(const char* in)
+{
+    std::uint32_t value = 0;
+    for (int i = 0; i < 4; ++i)
+        value |= std::uint32_t{static_cast<unsigned char>(in[i])} << (8 * i);
+    return value;
+}
+
+constexpr std::string_view frame_magic = "TODOLZF1";
+
+std::uint32_t hash(std::uint32_t bytes)
+{
+    return (bytes * 2654435761u) >> (32 - hash_bits);
+}
+
+// The part of a length that doesn't fit its nibble
+void put_length(std::string& out, std::size_t length)
+{
+    for (; length >= 255; length -= 255)
+        out += static_cast<char>(255);
+    out += static_cast<char>(length);
+}
+
+// A match length of 0 is the last sequence, literals only
+void put_sequence(std::string& out,
+                  const char* literals,
+                  std::size_t literal_count,
+                  std::size_t offset,
+                  std::size_t match_length)
+{
+    std::size_t match_code = match_length ? match_length - min_match : 0;
+    out += static_cast<char>((std::min<std::size_t>(literal_count, 15) << 4) |
+                             std::min<std::size_t>(match_code, 15));
+    if (literal_count >= 15)
+        put_length(out, literal_count - 15);
+    out.append(literals, literal_count);
+    if (match_length == 0)
+        return;
+    out += static_cast<char>(offset & 0xff);
+    out += static_cast<char>(offset >> 8);
+    if (match_code >= 15)
+        put_length(out, match_code - 15);
+}
+
+bool read_length(const unsigned char*& in,
+                 const unsigned char* end,
+                 std::size_t& length)
+{
+    unsigned char byte;
+    do {
+        if (in == end)
+            return false;
+        byte = *in++;
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+bool decode(std::string_view block, char* dst, std::size_t size)
+{
+    std::size_t o = 0;
+    auto in       = reinterpret_cast<const unsigned char*>(block.data());
+    auto end      = in + block.size();
+    while (true) {
+        if (in == end)
+            return false;
+        unsigned token      = *in++;
+        std::size_t literal = token >> 4;
+        if (literal == 15 && !read_length(in, end, literal))
+            return false;
+        if (literal > std::size_t(end - in) || literal > size - o)
+            return false;
+        if (literal <= 16 && end - in >= 16 && size - o >= 16)
+            std::memcpy(dst + o, in, 16); // Past the end, rewritten later
+        else
+            std::memcpy(dst + o, in, literal);
+        in += literal;
+        o += literal;
+        if (in == end)
+            break; // The last sequence has no match
+
+        if (end - in < 2)
+            return false;
+        std::size_t offset = in[0] | (std::size_t{in[1]} << 8);
+        std::size_t length = token & 15;
+        in += 2;
+        if (length == 15 && !read_length(in, end, length))
+            return false;
+        length += min_match;
+        if (offset == 0 || offset > o || length > size - o)
+            return false;
+        const char* src = dst + o - offset;
+        if (offset >= 16 && size - o >= length + 16) {
+            // Whole words at a time, a little past the end of the match
+            for (std::size_t k = 0; k < length; k += 16)
+                std::memcpy(dst + o + k, src + k, 16);
+        } else if (offset >= length) {
+            std::memcpy(dst + o, src, length);
+        } else {
+            // Overlapping: the match repeats what it is copying
+            for (std::size_t k = 0; k < length; ++k)
+                dst[o + k] = src[k];
+        }
+        o += length;
+    }
+    return o == size;
+}
+
+} // namespace
+
+namespace Lz {
+
+std::string compress(std::string_view data)
+{
+    const char* base    = data.data();
+    const std::size_t n = data.size();
+    std::string out;
+    out.reserve(n / 2 + 16);
+
+    std::size_t anchor = 0; // Start of the literals not written yet
+    if (n > match_margin) {
+        std::vector<std::uint32_t> table(std::size_t{1} << hash_bits, 0);
+        const std::size_t limit     = n - match_margin;
+        const std::size_t match_end = n - last_literals;
+        std::size_t misses          = 0;
+        for (std::size_t i = 0; i < limit;) {
+            std::uint32_t bytes   = read32(base + i);
+            std::uint32_t& slot   = table[hash(bytes)];
+            std::size_t candidate = slot;
+            slot                  = static_cast<std::uint32_t>(i);
+            if (candidate >= i || i - candidate > max_offset ||
+                read32(base + candidate) != bytes) {
+                // Skip ahead faster through data that doesn't compress
+                i += 1 + (misses++ >> 6);
+                continue;
+            }
+            while (i > anchor && candidate > 0 &&
+                   base[i - 1] == base[candidate - 1]) {
+                --i;
+                --candidate;
+            }
+            std::size_t length = min_match;
+            while (i + length < match_end &&
+                   base[i + length] == base[candidate + length])
+                ++length;
+            put_sequence(out, base + anchor, i - anchor, i - candidate, length);
+            i += length;
+            anchor = i;
+            misses = 0;
+            if (i - 2 < limit)
+                table[hash(read32(base + i - 2))] =
+                    static_cast<std::uint32_t>(i - 2);
+        }
+    }
+    put_sequence(out, base + anchor, n - anchor, 0, 0);
+    return out;
+}
+
+std::optional<std::string> decompress(std::string_view block,
+                                      std::size_t size)
+{
+    std::string out(size, '\0');
+    if (!decode(block, out.data(), size))
+        return std::nullopt;
+    return out;
+}
+
+std::string compress_frame(std::string_view data, ThreadPool& pool)
+{
+    const std::size_t count =
+        (data.size() + frame_block_size - 1) / frame_block_size;
+    std::vector<std::string> blocks(count);
+    pool.run_all(count, [&](std::size_t i) {
+        blocks[i] = compress(data.substr(i * frame_block_size,
+                                         frame_block_size));
+    });
+
+    std::string out(frame_magic);
+    put32(out, static_cast<std::uint32_t>(count));
+    std::size_t packed_size = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        put32(out, static_cast<std::uint32_t>(blocks[i].size()));
+        put32(out,
+              static_cast<std::uint32_t>(std::min(
+                  frame_block_size, data.size() - i * frame_block_size)));
+        packed_size += blocks[i].size();
+    }
+    out.reserve(out.size() + packed_size);
+    for (const auto& block : blocks)
+        out += block;
+    return out;
+}
+
+bool is_frame(std::string_view data)
+{
+    return data.substr(0, frame_magic.size()) == frame_magic;
+}
+
+std::optional<std::string> decompress_frame(std::string_view frame,
+                                            ThreadPool& pool)
+{
+    const std::size_t header = frame_magic.size() + 4;
+    if (!is_frame(frame) || frame.size() < header)
+        return std::nullopt;
+    const std::size_t count = get32(frame.data() + frame_magic.size());
+    if ((frame.size() - header) / 8 < count)
+        return std::nullopt;
+
+    struct Block
+    {
+        std::size_t in, packed_size, out, size;
+    };
+    std::vector<Block> blocks(count);
+    std::size_t in  = header + 8 * count;
+    std::size_t out = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        const char* sizes = frame.data() + header + 8 * i;
+        blocks[i]         = {in, get32(sizes), out, get32(sizes + 4)};
+        if (blocks[i].packed_size > frame.size() - in ||
+            blocks[i].size > frame_block_size)
+            return std::nullopt;
+        in += blocks[i].packed_size;
+        out += blocks[i].size;
+    }
+    if (in != frame.size())
+        return std::nullopt;
+
+    std::string data(out, '\0');
+    std::atomic<bool> intact{true};
+    pool.run_all(count, [&](std::size_t i) {
+        const Block& block = blocks[i];
+        if (!decode(frame.substr(block.in, block.packed_size),
+                    data.data() + block.out,
+                    block.size))
+            intact = false;
+    });
+    if (!intact)
+        return std::nullopt;
+    return data;
+}
+
+} // namespace Lz
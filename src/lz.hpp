@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+
+class ThreadPool;
+
+// A small LZ77 codec in the LZ4 block format, for data files, which repeat
+// themselves a lot (keys, ids, texts from templates). Fast rather than
+// tight: a greedy match finder over a 64 KiB window, one hash probe per
+// position.
+//
+// A block is a series of sequences: a token byte (literal count in the high
+// nibble, match length minus 4 in the low one, 15 meaning more length bytes
+// follow, each adding up to 255), the literals, a 2-byte little-endian
+// offset back into the output, and the match length bytes. The last
+// sequence has literals only. The size of the input isn't stored: callers
+// keep it next to the block.
+namespace Lz {
+
+std::string compress(std::string_view data);
+
+// Nullopt if `block` is corrupt or doesn't decode to exactly `size` bytes
+std::optional<std::string> decompress(std::string_view block,
+                                      std::size_t size);
+
+// Whole files are cut into blocks of this size, compressed independently so
+// that both ways run on all cores, and framed: "TODOLZF1", the number of
+// blocks (u32), the size of each packed and unpacked (u32 each), then the
+// blocks, all little-endian. A frame keeps its own sizes.
+constexpr std::size_t frame_block_size = std::size_t{1} << 20;
+
+std::string compress_frame(std::string_view data, ThreadPool& pool);
+
+// Whether `data` starts like a frame (a JSON file never does)
+bool is_frame(std::string_view data);
+
+// Nullopt if `frame` is corrupt
+std::optional<std::string> decompress_frame(std::string_view frame,
+                                            ThreadPool& pool);
+
+} // namespace Lz
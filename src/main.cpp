@@ -1,9 +1,28 @@
-#include "persistence.hpp" // save_state, load_state, get_default_data_path
-#include "state.hpp"       // State, Action, Reducer, Effects
+#include "action_log.hpp"     // ActionRecorder, read_action_log
+#include "alloc_tracking.hpp" // AllocPhaseScope, alloc_frame_begin/end
+#include "archive.hpp"        // Archive::segments/read
+#include "completions.hpp"    // CompletionTrie
+#include "fuzzy.hpp"          // FuzzyFinder
+#include "history.hpp"        // History::Store
+#include "list_diff.hpp"      // diff_lists, changed_fields
+#include "list_search.hpp"    // ListSearch
+#include "list_watcher.hpp"   // ListWatcher
+#include "memory_pool.hpp"    // memory_pool
+#include "persistence.hpp"    // get_default_data_path
+#include "profiler.hpp"       // FrameProfiler
+#include "reducer_thread.hpp" // ReducerThread
+#include "state.hpp"          // State, Action, Reducer, Effects
+#include "tags.hpp"           // TagColumns, select_matching
+#include "thread_pool.hpp"    // ThreadPool
+#include "timing_wheel.hpp"   // TimingWheel
+#include "trace.hpp"          // TraceScope, trace_instant
+#include "workspace.hpp"      // Workspace
 
 #include <imtui/imtui-impl-ncurses.h>
 #include <imtui/imtui.h>
 
+#include <immer/algorithm.hpp>
+
 #include <lager/event_loop/manual.hpp>
 #include <lager/store.hpp>
 #include <lager/watch.hpp>
@@ -13,18 +32,979 @@
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+#include <array>
+#include <charconv>
 #include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
 #include <functional>
+#include <iomanip>
 #include <iostream>
+#include <iterator>
 #include <memory>
+#include <numeric>
+#include <optional>
+#include <sstream>
 #include <string>
+#include <string_view>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
-void renderUI(lager::store<Action, AppState>& store)
+std::int64_t nowSeconds()
+{
+    return std::chrono::duration_cast<std::chrono::seconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+// Fixed size, so formatting the due date of every visible row each frame
+// doesn't allocate
+struct DueTimeText
+{
+    char chars[32];
+    const char* c_str() const { return chars; }
+};
+
+// Local time as "YYYY-MM-DD HH:MM"
+DueTimeText formatDueTime(std::int64_t due)
+{
+    std::time_t time = static_cast<std::time_t>(due);
+    std::tm local{};
+#ifdef _WIN32
+    localtime_s(&local, &time);
+#else
+    localtime_r(&time, &local);
+#endif
+    DueTimeText text;
+    std::strftime(
+        text.chars, sizeof(text.chars), "%Y-%m-%d %H:%M", &local);
+    return text;
+}
+
+// Appends `value` in decimal, without a temporary string
+void appendNumber(std::string& text, int value)
+{
+    char digits[16];
+    auto end = std::to_chars(std::begin(digits), std::end(digits), value).ptr;
+    text.append(digits, end);
+}
+
+// Accepts "YYYY-MM-DD", "YYYY-MM-DD HH:MM" (local time) or an offset from
+// now such as "+30m", "+2h" or "+1d". An empty string clears the due date
+// (returns 0); anything else is rejected.
+std::optional<std::int64_t> parseDueTime(const std::string& text,
+                                         std::int64_t now)
+{
+    if (text.empty())
+        return 0;
+    if (text[0] == '+') {
+        std::istringstream in(text.substr(1));
+        std::int64_t amount = 0;
+        char unit           = 0;
+        if (!(in >> amount >> unit) || amount < 0 || !(in >> std::ws).eof())
+            return std::nullopt;
+        switch (unit) {
+        case 'm':
+            return now + amount * 60;
+        case 'h':
+            return now + amount * 60 * 60;
+        case 'd':
+            return now + amount * 24 * 60 * 60;
+        default:
+            return std::nullopt;
+        }
+    }
+    std::tm local{};
+    std::istringstream in(text);
+    in >> std::get_time(&local, "%Y-%m-%d");
+    if (in.fail())
+        return std::nullopt;
+    if (!(in >> std::ws).eof()) {
+        in >> std::get_time(&local, "%H:%M");
+        if (in.fail() || !(in >> std::ws).eof())
+            return std::nullopt;
+    }
+    local.tm_isdst = -1;
+    std::time_t time = std::mktime(&local);
+    if (time == static_cast<std::time_t>(-1))
+        return std::nullopt;
+    return static_cast<std::int64_t>(time);
+}
+
+// Draws `count` rows of todo items into the current child window, row i
+// showing item_at(i). Only the rows that are actually visible get built
+// (ImGuiListClipper), so the cost of a frame doesn't depend on the length of
+// the list. The callbacks dispatch while rows are still being drawn, so
+// item_at must read from the frame's snapshot (see renderUI): toggling a
+// subtask rebuilds its parents, and the store's own lists would be gone.
+void renderTodoRows(int count,
+                    const std::function<const TodoItem&(int)>& item_at,
+                    int selected,
+                    const IntervalSet& marks,
+                    const std::function<void(int)>& on_select,
+                    const std::function<void(int)>& on_activate)
+{
+    const float row_height = ImGui::GetTextLineHeightWithSpacing();
+
+    // Keep the selection in view when it changes. Off-screen rows are never
+    // built, so ImGui can't scroll to them by itself.
+    ImGuiStorage* storage    = ImGui::GetStateStorage();
+    ImGuiID last_selected_id = ImGui::GetID("##last_selected");
+    if (storage->GetInt(last_selected_id, -1) != selected) {
+        storage->SetInt(last_selected_id, selected);
+        if (selected >= 0) {
+            float top    = selected * row_height;
+            float height = ImGui::GetWindowHeight();
+            if (top < ImGui::GetScrollY()) {
+                ImGui::SetScrollY(top);
+            } else if (top + row_height > ImGui::GetScrollY() + height) {
+                ImGui::SetScrollY(top + row_height - height);
+            }
+        }
+    }
+
+    // Double-click to activate
+    static ImGuiID last_clicked_list = 0;
+    static int last_clicked_idx      = -1;
+    static auto last_click_time      = std::chrono::steady_clock::now();
+    const ImGuiID list_id            = ImGui::GetID("##rows");
+    const std::int64_t now           = nowSeconds();
+
+    // Shared by all rows, so once it has grown to fit the longest label,
+    // building labels no longer allocates
+    static std::string label;
+
+    ImGuiListClipper clipper;
+    clipper.Begin(count, row_height);
+    while (clipper.Step()) {
+        for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+            const auto& todo = item_at(i);
+            bool is_selected = (i == selected);
+            label.assign(marks.contains(i) ? "* " : "  ");
+            label += todo.done ? "[x] " : "[ ] ";
+            if (todo.priority > 0) {
+                label += 'P';
+                appendNumber(label, todo.priority);
+                label += ' ';
+            }
+            label += todo.text;
+            if (todo.subtasks.node) {
+                // Cached, collapsed subtrees are never traversed
+                Progress progress = subtask_progress(todo);
+                label += " (";
+                appendNumber(label, progress.done);
+                label += '/';
+                appendNumber(label, progress.total);
+                label += ')';
+            }
+            if (todo.due != 0) {
+                bool overdue = !todo.done && todo.due <= now;
+                label += overdue ? "  ! due " : "  due ";
+                label += formatDueTime(todo.due).c_str();
+            }
+
+            // Use ImGui's built-in selection highlighting
+            ImGui::PushID(i);
+            if (ImGui::Selectable(label.c_str(), is_selected)) {
+                on_select(i);
+
+                auto now = std::chrono::steady_clock::now();
+                if (last_clicked_list == list_id && last_clicked_idx == i &&
+                    std::chrono::duration_cast<std::chrono::milliseconds>(
+                        now - last_click_time)
+                            .count() < 500) {
+                    on_activate(i);
+                    last_clicked_idx = -1; // Reset to prevent triple-click
+                } else {
+                    last_clicked_list = list_id;
+                    last_clicked_idx  = i;
+                    last_click_time   = now;
+                }
+            }
+            ImGui::PopID();
+        }
+    }
+    clipper.End();
+}
+
+void renderTodoRows(const TodoList& items,
+                    int selected,
+                    const IntervalSet& marks,
+                    const std::function<void(int)>& on_select,
+                    const std::function<void(int)>& on_activate)
+{
+    renderTodoRows(
+        static_cast<int>(items.size()),
+        [&](int i) -> const TodoItem& { return items[i]; },
+        selected,
+        marks,
+        on_select,
+        on_activate);
+}
+
+// Row of the selected item in the priority view: its entry is found by key,
+// O(log n), without scanning the view.
+int prioritySelectedRow(const AppState& state)
+{
+    int selected = state.selected_index;
+    if (selected < 0 || selected >= static_cast<int>(state.todos.size()))
+        return -1;
+    return static_cast<int>(state.priority_view.lower_bound(
+        priority_entry(state.todos[selected])));
+}
+
+// Rows of a list that match a tag filter. Masks are gathered into columns
+// only for the rows that changed and the kernels only run when the rows or
+// the query do, so an unchanged filtered view costs nothing per frame.
+template <typename Rows>
+class CachedTagFilter
+{
+public:
+    // `item_of` gives the TodoItem of a row
+    template <typename ItemOf>
+    const std::vector<std::uint32_t>&
+    select(const Rows& rows, const std::string& query, ItemOf&& item_of)
+    {
+        auto mask_of      = [&](const auto& row) { return item_of(row).tags; };
+        auto chunks       = chunks_of(rows);
+        bool rows_changed = chunks != chunks_;
+        if (rows_changed) {
+            refresh(rows, chunks, mask_of);
+            rows_   = rows;
+            chunks_ = std::move(chunks);
+        }
+        // Tags added since the query was compiled may now match
+        auto generation = tag_dictionary().size();
+        if (rows_changed || query != query_ || generation != generation_) {
+            query_         = query;
+            generation_    = generation;
+            auto compiled  = parse_tag_query(query);
+            select_matching(columns_, compiled, selection_);
+            if (compiled.by_text) {
+                std::erase_if(selection_, [&](std::uint32_t i) {
+                    return !matches_tag_query(query, item_of(rows[i]).text);
+                });
+            }
+        }
+        return selection_;
+    }
+
+private:
+    // The leaves of the RRB-tree, which versions of a list share unless an
+    // edit touched them
+    using Chunks = std::vector<std::pair<const void*, std::size_t>>;
+
+    static Chunks chunks_of(const Rows& rows)
+    {
+        Chunks chunks;
+        immer::for_each_chunk(rows, [&](const auto* first, const auto* last) {
+            chunks.emplace_back(first, static_cast<std::size_t>(last - first));
+        });
+        return chunks;
+    }
+
+    // Only the rows between the leaves both versions start and end with are
+    // read again. rows_ keeps the old leaves alive, so a leaf at the same
+    // address is the same leaf.
+    template <typename MaskOf>
+    void refresh(const Rows& rows, const Chunks& chunks, MaskOf&& mask_of)
+    {
+        std::size_t head = 0, tail = 0;
+        std::size_t first = 0;
+        while (first < chunks.size() && first < chunks_.size() &&
+               chunks[first] == chunks_[first])
+            head += chunks[first++].second;
+        for (auto a = chunks.rbegin(), b = chunks_.rbegin();
+             a != chunks.rend() - first && b != chunks_.rend() - first &&
+             *a == *b;
+             ++a, ++b)
+            tail += a->second;
+        columns_.splice(head,
+                        columns_.size() - tail,
+                        rows,
+                        rows.size() - head - tail,
+                        mask_of);
+    }
+
+    Rows rows_;
+    Chunks chunks_;
+    TagColumns columns_;
+    std::string query_;
+    std::size_t generation_ = 0;
+    std::vector<std::uint32_t> selection_;
+};
+
+// Positions of the items of a list by id, rebuilt only when the list
+// changes: stepping through the priority view then finds each row's item in
+// O(1) and the reducer checks it is there in O(log n), instead of searching
+// the list on every step.
+class ItemPositions
+{
+public:
+    int find(const TodoList& items, std::uint64_t id)
+    {
+        if (!(items == items_)) {
+            items_ = items;
+            positions_.clear();
+            positions_.reserve(items.size());
+            int position = 0;
+            for (const auto& item : items)
+                positions_.emplace(item.id, position++);
+        }
+        auto found = positions_.find(id);
+        return found == positions_.end() ? -1 : found->second;
+    }
+
+private:
+    TodoList items_;
+    std::unordered_map<std::uint64_t, int> positions_;
+};
+
+// What the list view shows: the current list, or the main list by priority,
+// either of them possibly narrowed down by a tag filter.
+struct ListRows
+{
+    int count = 0;
+    std::function<const TodoItem&(int)> item_at;
+    int selected = -1;                 // Row of the selected item, if shown
+    std::function<Action(int)> select; // Selects the item of a row
+};
+
+// Keeps only the rows at the (ascending) positions in `selection`.
+void narrowRows(ListRows& rows, const std::vector<std::uint32_t>& selection)
+{
+    auto found = std::lower_bound(
+        selection.begin(), selection.end(), std::uint32_t(rows.selected));
+    rows.selected = rows.selected >= 0 && found != selection.end() &&
+                            *found == std::uint32_t(rows.selected)
+                        ? static_cast<int>(found - selection.begin())
+                        : -1;
+    rows.count    = static_cast<int>(selection.size());
+    rows.item_at  = [item_at = std::move(rows.item_at),
+                    &selection](int i) -> const TodoItem& {
+        return item_at(selection[i]);
+    };
+    rows.select = [select = std::move(rows.select), &selection](int i) {
+        return select(selection[i]);
+    };
+}
+
+ListRows
+listRows(const AppState& state, bool by_priority, const std::string& filter)
+{
+    static CachedTagFilter<TodoList> list_filter;
+    static CachedTagFilter<PriorityView::entries_t> view_filter;
+    static ItemPositions positions;
+
+    ListRows rows;
+    if (by_priority) {
+        const auto& view = state.priority_view;
+        rows.count       = static_cast<int>(view.size());
+        rows.item_at = [&view](int i) -> const TodoItem& {
+            return view[i].item;
+        };
+        rows.selected = prioritySelectedRow(state);
+        rows.select   = [&view, &state](int i) -> Action {
+            auto id = view[i].id;
+            return SelectTodoByIdAction{id, positions.find(state.todos, id)};
+        };
+        if (!filter.empty()) {
+            narrowRows(rows,
+                       view_filter.select(
+                           view.entries(),
+                           filter,
+                           [](const PriorityEntry& e) -> const TodoItem& {
+                               return e.item;
+                           }));
+        }
+    } else {
+        // Into the frame's snapshot, which dispatching doesn't free even
+        // when the list is a subtask list whose parents get rebuilt
+        const auto& items = current_list(state);
+        rows.count        = static_cast<int>(items.size());
+        rows.item_at = [&items](int i) -> const TodoItem& {
+            return items[i];
+        };
+        rows.selected = current_selection(state);
+        rows.select   = [](int i) -> Action { return SelectTodoAction{i}; };
+        if (!filter.empty()) {
+            narrowRows(rows,
+                       list_filter.select(
+                           items,
+                           filter,
+                           [](const TodoItem& item) -> const TodoItem& {
+                               return item;
+                           }));
+        }
+    }
+    return rows;
+}
+
+// "Column > Parent > Subtask" for the list that is currently open.
+std::string currentListTitle(const AppState& state)
 {
-    auto& state = store.get();
+    std::string title    = column_name(state, state.active_column);
+    const TodoList* list = &column_items(state, state.active_column);
+    for (int index : state.path) {
+        const auto& parent = (*list)[index];
+        list               = &subtask_items(parent);
+        title += " > ";
+        title += parent.text;
+    }
+    return title;
+}
+
+// Kanban view: every column side by side, each one virtualized on its own.
+void renderBoard(const AppState& state, const Dispatch& dispatch)
+{
+    const int columns   = column_count(state);
+    const float spacing = ImGui::GetStyle().ItemSpacing.x;
+    const float width =
+        (ImGui::GetContentRegionAvail().x - spacing * (columns - 1)) /
+        columns;
+
+    for (int c = 0; c < columns; c++) {
+        if (c > 0)
+            ImGui::SameLine();
+        ImGui::PushID(c);
+        ImGui::BeginChild("Column", ImVec2(width, 0), true);
+
+        // The active column shows the subtasks that are open in it
+        const bool active  = c == state.active_column;
+        const auto& items =
+            active ? current_list(state) : column_items(state, c);
+        std::string header = (active ? currentListTitle(state)
+                                     : column_name(state, c)) +
+                             " (" + std::to_string(items.size()) + ")";
+        ImGui::TextColored(active ? ImVec4(1.0f, 1.0f, 0.4f, 1.0f)
+                                  : ImVec4(0.7f, 0.7f, 0.7f, 1.0f),
+                           "%s",
+                           header.c_str());
+        ImGui::Separator();
+
+        ImGui::BeginChild("Rows");
+        renderTodoRows(
+            items,
+            active ? current_selection(state) : column_selection(state, c),
+            active ? effective_marks(state) : IntervalSet{},
+            [&](int i) {
+                dispatch(FocusColumnAction{c});
+                dispatch(SelectTodoAction{i});
+            },
+            [&](int) {
+                dispatch(ToggleSelectedTodoAction{nowSeconds()});
+            });
+        ImGui::EndChild();
+
+        ImGui::EndChild();
+        ImGui::PopID();
+    }
+}
+
+// One tab per list of the workspace, with its item count; the open list's
+// is its live count, the others' that of their file.
+void renderListTabs(const AppState& state, const Dispatch& dispatch)
+{
+    for (int i = 0; i < int(state.lists.size()); ++i) {
+        const ListInfo& list = state.lists[i];
+        const bool open      = list.name == state.list_name;
+        const int items      = open ? int(state.todos.size()) : list.items;
+        char label[64];
+        if (items >= 0)
+            std::snprintf(
+                label, sizeof(label), "%s (%d)", list.name.c_str(), items);
+        else
+            std::snprintf(label, sizeof(label), "%s", list.name.c_str());
+
+        if (i > 0)
+            ImGui::SameLine();
+        ImGui::PushID(i);
+        if (open)
+            ImGui::PushStyleColor(ImGuiCol_Button,
+                                  ImVec4(0.3f, 0.3f, 0.6f, 1.0f));
+        if (ImGui::Button(label) && !open)
+            dispatch(OpenListAction{list.name});
+        if (open)
+            ImGui::PopStyleColor();
+        ImGui::PopID();
+    }
+}
+
+// The list `step` tabs away from the open one, wrapping around
+const std::string& neighbourList(const AppState& state, int step)
+{
+    const int count = static_cast<int>(state.lists.size());
+    int open        = 0;
+    while (open < count && state.lists[open].name != state.list_name)
+        ++open;
+    if (open == count)
+        return state.list_name;
+    return state.lists[((open + step) % count + count) % count].name;
+}
+
+// Where the searches run, so the UI keeps drawing (and picking up results)
+// while one does
+ThreadPool& searchPool()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+// The finder behind the '/' palette
+FuzzyFinder& fuzzyFinder()
+{
+    static FuzzyFinder finder{searchPool()};
+    return finder;
+}
 
+// The search through every list's file behind the 'F' palette
+ListSearch& listSearch()
+{
+    static ListSearch search{searchPool()};
+    return search;
+}
+
+// The archive view (A): the archived items of the open list, newest first.
+// The archive is read a segment at a time, as the selection gets near the
+// end of what has been read.
+struct ArchiveView
+{
+    std::string list;
+    std::vector<Archive::Segment> segments; // Oldest first, as in the file
+    std::size_t segments_read = 0;          // From the newest
+    std::size_t items         = 0;          // In all segments
+    std::vector<TodoItem> read;             // Items of the segments read
+    int selected              = 0;
+};
+
+ArchiveView& archiveView()
+{
+    static ArchiveView view;
+    return view;
+}
+
+// Reads the next older segment, if there is one
+void readArchiveSegment(ArchiveView& view)
+{
+    if (!global_workspace || view.segments_read == view.segments.size())
+        return;
+    const auto& segment =
+        view.segments[view.segments.size() - 1 - view.segments_read++];
+    auto items =
+        Archive::read(global_workspace->archive_path_of(view.list), segment);
+    if (items)
+        view.read.insert(view.read.end(), items->begin(), items->end());
+}
+
+void openArchiveView(const std::string& list)
+{
+    ArchiveView& view = archiveView();
+    view              = ArchiveView{};
+    view.list         = list;
+    if (global_workspace)
+        view.segments =
+            Archive::segments(global_workspace->archive_path_of(list));
+    for (const auto& segment : view.segments)
+        view.items += segment.items;
+    readArchiveSegment(view);
+}
+
+void renderArchive(ArchiveView& view)
+{
+    const int page = static_cast<int>(ImGui::GetWindowHeight() /
+                                      ImGui::GetTextLineHeightWithSpacing());
+    while (view.selected + page >= static_cast<int>(view.read.size()) &&
+           view.segments_read < view.segments.size())
+        readArchiveSegment(view);
+    const int count = static_cast<int>(view.read.size());
+    view.selected   = std::clamp(view.selected, 0, std::max(0, count - 1));
+    if (count == 0) {
+        ImGui::TextColored(ImVec4(0.5f, 0.5f, 0.5f, 1.0f), "Nothing archived.");
+        return;
+    }
+    renderTodoRows(
+        count,
+        [&](int i) -> const TodoItem& { return view.read[i]; },
+        view.selected,
+        IntervalSet{},
+        [&](int i) { view.selected = i; },
+        [](int) {});
+}
+
+// The history browser (H): the saved versions of the open list, newest
+// first, each shown as it was saved. Paging to the next version only reads
+// the chunks of it that the versions shown before didn't have. D shows what
+// changed since the version instead (see list_diff.hpp).
+struct HistoryView
+{
+    std::string list;
+    std::optional<History::Store> store;
+    std::vector<History::Version> versions; // Oldest first, as in the file
+    int version  = 0;  // From the newest
+    int opened   = -1; // Which version `shown` is
+    AppState shown;
+    int selected = 0;
+    bool diffing = false;
+    int diffed   = -1;  // Which version `diff` is from
+    TodoList diffed_to; // And the list it is to
+    ListDiff diff;
+};
+
+HistoryView& historyView()
+{
+    static HistoryView view;
+    return view;
+}
+
+void openHistoryView(const std::string& list)
+{
+    HistoryView& view = historyView();
+    view              = HistoryView{};
+    view.list         = list;
+    if (global_workspace) {
+        view.store.emplace(global_workspace->history_path_of(list));
+        view.versions = view.store->versions();
+    }
+}
+
+// The changes of a diff, one row each, colored by what happened to the item
+void renderDiffRows(const ListDiff& diff,
+                    const TodoList& before,
+                    const TodoList& after,
+                    int selected,
+                    const std::function<void(int)>& on_select)
+{
+    const float row_height   = ImGui::GetTextLineHeightWithSpacing();
+    ImGuiStorage* storage    = ImGui::GetStateStorage();
+    ImGuiID last_selected_id = ImGui::GetID("##last_selected");
+    if (storage->GetInt(last_selected_id, -1) != selected) {
+        storage->SetInt(last_selected_id, selected);
+        float top    = selected * row_height;
+        float height = ImGui::GetWindowHeight();
+        if (top < ImGui::GetScrollY()) {
+            ImGui::SetScrollY(top);
+        } else if (top + row_height > ImGui::GetScrollY() + height) {
+            ImGui::SetScrollY(top + row_height - height);
+        }
+    }
+
+    static std::string label;
+    ImGuiListClipper clipper;
+    clipper.Begin(static_cast<int>(diff.edits.size()), row_height);
+    while (clipper.Step()) {
+        for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+            const ListEdit& edit = diff.edits[i];
+            const TodoItem& todo = edit.change == ListChange::Removed
+                                       ? before[edit.before]
+                                       : after[edit.after];
+            ImVec4 color;
+            switch (edit.change) {
+            case ListChange::Added:
+                label.assign("+ ");
+                color = ImVec4(0.4f, 0.9f, 0.4f, 1.0f);
+                break;
+            case ListChange::Removed:
+                label.assign("- ");
+                color = ImVec4(0.9f, 0.4f, 0.4f, 1.0f);
+                break;
+            case ListChange::Changed:
+                label.assign("~ ");
+                color = ImVec4(0.9f, 0.9f, 0.4f, 1.0f);
+                break;
+            case ListChange::Moved:
+                label.assign("> ");
+                color = ImVec4(0.4f, 0.9f, 0.9f, 1.0f);
+                break;
+            }
+            label += todo.done ? "[x] " : "[ ] ";
+            label += todo.text;
+            if (edit.change == ListChange::Changed) {
+                label += "  (";
+                label += changed_fields(before[edit.before], after[edit.after]);
+                label += ')';
+            } else if (edit.change == ListChange::Moved) {
+                label += "  (was ";
+                appendNumber(label, static_cast<int>(edit.before) + 1);
+                label += ", now ";
+                appendNumber(label, static_cast<int>(edit.after) + 1);
+                label += ')';
+            }
+
+            ImGui::PushID(i);
+            ImGui::PushStyleColor(ImGuiCol_Text, color);
+            if (ImGui::Selectable(label.c_str(), i == selected))
+                on_select(i);
+            ImGui::PopStyleColor();
+            ImGui::PopID();
+        }
+    }
+    clipper.End();
+}
+
+void renderHistory(HistoryView& view, const TodoList& current)
+{
+    const int count = static_cast<int>(view.versions.size());
+    if (count == 0) {
+        ImGui::TextColored(ImVec4(0.5f, 0.5f, 0.5f, 1.0f),
+                           "No saved versions.");
+        return;
+    }
+    view.version = std::clamp(view.version, 0, count - 1);
+    if (view.opened != view.version) {
+        auto state  = view.store->open(view.versions[count - 1 - view.version]);
+        view.shown  = state ? std::move(*state) : AppState{};
+        view.opened = view.version;
+    }
+    if (view.diffing) {
+        // Again only when either side changed; the current list is the same
+        // structure as long as it isn't edited, so checking is quick
+        if (view.diffed != view.version || !(view.diffed_to == current)) {
+            view.diff      = diff_lists(view.shown.todos, current);
+            view.diffed    = view.version;
+            view.diffed_to = current;
+        }
+        const int rows = static_cast<int>(view.diff.edits.size());
+        view.selected  = std::clamp(view.selected, 0, std::max(0, rows - 1));
+        if (rows == 0) {
+            ImGui::TextColored(ImVec4(0.5f, 0.5f, 0.5f, 1.0f), "No changes.");
+            return;
+        }
+        renderDiffRows(view.diff,
+                       view.shown.todos,
+                       view.diffed_to,
+                       view.selected,
+                       [&](int i) { view.selected = i; });
+        return;
+    }
+    const TodoList& items = view.shown.todos;
+    const int rows        = static_cast<int>(items.size());
+    view.selected         = std::clamp(view.selected, 0, std::max(0, rows - 1));
+    renderTodoRows(
+        rows,
+        [&](int i) -> const TodoItem& { return items[i]; },
+        view.selected,
+        IntervalSet{},
+        [&](int i) { view.selected = i; },
+        [](int) {});
+}
+
+// The palette: the best matches found so far, best first.
+void renderFuzzyMatches(const FuzzyResults& results, int& selected)
+{
+    const int count = static_cast<int>(results.matches.size());
+    selected        = std::clamp(selected, 0, std::max(0, count - 1));
+    for (int i = 0; i < count; ++i) {
+        ImGui::PushID(i);
+        if (ImGui::Selectable(results.matches[i].text.c_str(), i == selected))
+            selected = i;
+        if (i == selected)
+            ImGui::SetScrollHereY();
+        ImGui::PopID();
+    }
+}
+
+// The 'F' palette: matches in every list, as the files are searched.
+void renderListMatches(const ListSearchResults& results, int& selected)
+{
+    const int count = static_cast<int>(results.matches.size());
+    selected        = std::clamp(selected, 0, std::max(0, count - 1));
+    for (int i = 0; i < count; ++i) {
+        const ListSearchMatch& match = results.matches[i];
+        char label[256];
+        std::snprintf(label,
+                      sizeof(label),
+                      "%s: [%c] %s",
+                      match.list.c_str(),
+                      match.done ? 'x' : ' ',
+                      match.text.c_str());
+        ImGui::PushID(i);
+        if (ImGui::Selectable(label, i == selected))
+            selected = i;
+        if (i == selected)
+            ImGui::SetScrollHereY();
+        ImGui::PopID();
+    }
+}
+
+// Completions of the new-todo input, kept up to date by its callback.
+struct InputCompletions
+{
+    std::string typed;                    // What's in the input line
+    std::optional<std::string> looked_up; // What `suggestions` complete
+    std::vector<std::string> suggestions;
+    int chosen = 0; // The one Tab fills in
+};
+
+// Tracks the text being typed; Tab completes it, Up/Down pick another
+// suggestion.
+int completionCallback(ImGuiInputTextCallbackData* data)
+{
+    auto& completions = *static_cast<InputCompletions*>(data->UserData);
+    const int count   = static_cast<int>(completions.suggestions.size());
+    if (data->EventFlag == ImGuiInputTextFlags_CallbackCompletion &&
+        completions.chosen < count) {
+        data->DeleteChars(0, data->BufTextLen);
+        data->InsertChars(
+            0, completions.suggestions[completions.chosen].c_str());
+    } else if (data->EventFlag == ImGuiInputTextFlags_CallbackHistory &&
+               count > 0) {
+        int step           = data->EventKey == ImGuiKey_UpArrow ? -1 : 1;
+        completions.chosen = (completions.chosen + step + count) % count;
+    }
+    completions.typed.assign(data->Buf, data->BufTextLen);
+    return 0;
+}
+
+// The allocations panel (M): what the last frame allocated in each of its
+// phases, next to the counts since the start, and the actions whose
+// reducing allocated the most.
+void renderAllocations()
+{
+    const ImVec2 display = ImGui::GetIO().DisplaySize;
+    ImGui::SetNextWindowPos(ImVec2(display.x - 48, 3), ImGuiCond_Always);
+    ImGui::SetNextWindowSize(ImVec2(46, 16), ImGuiCond_Always);
+    ImGui::Begin("Allocations (M)",
+                 nullptr,
+                 ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoMove);
+    if (!alloc_tracking_enabled) {
+        ImGui::TextWrapped("Not built in; configure with "
+                           "-DTUI_TODO_ALLOC_TRACKING=ON");
+        ImGui::End();
+        return;
+    }
+
+    using Count = unsigned long long;
+
+    const AllocReport& frame = last_alloc_frame();
+    const AllocReport totals = alloc_totals();
+    ImGui::Text("%-7s %6s %8s %9s", "", "frame", "bytes", "total");
+    for (int p = 0; p < alloc_phase_count; ++p) {
+        ImGui::Text("%-7s %6llu %8llu %9llu",
+                    alloc_phase_name(static_cast<AllocPhase>(p)),
+                    Count(frame.phases[p].allocations),
+                    Count(frame.phases[p].bytes),
+                    Count(totals.phases[p].allocations));
+    }
+
+    ImGui::Separator();
+    constexpr int action_count = static_cast<int>(std::size(action_names));
+    std::array<int, action_count> order;
+    std::iota(order.begin(), order.end(), 0);
+    auto shown = order.begin() + std::min(4, action_count);
+    std::partial_sort(order.begin(), shown, order.end(), [&](int a, int b) {
+        return totals.actions[a].allocations > totals.actions[b].allocations;
+    });
+    for (auto i = order.begin(); i != shown; ++i) {
+        if (totals.actions[*i].allocations == 0)
+            break;
+        ImGui::Text("%-18s %9llu",
+                    action_names[*i],
+                    Count(totals.actions[*i].allocations));
+    }
+    ImGui::End();
+}
+
+// Times the phases of the frames of the main loop, for the overlay below.
+FrameProfiler& frameProfiler()
+{
+    static FrameProfiler profiler;
+    return profiler;
+}
+
+// The timings overlay (T): the last, average and slowest time of every
+// phase over the frames kept, a sparkline of the most recent frames, and
+// what the worst of them spent its time on.
+void renderFrameTimings()
+{
+    const FrameProfiler& profiler = frameProfiler();
+    const ImVec2 display          = ImGui::GetIO().DisplaySize;
+    ImGui::SetNextWindowPos(ImVec2(display.x - 48, display.y - 16),
+                            ImGuiCond_Always);
+    ImGui::SetNextWindowSize(ImVec2(46, 14), ImGuiCond_Always);
+    ImGui::Begin("Frame timings (T)",
+                 nullptr,
+                 ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoMove);
+    const int frames = static_cast<int>(profiler.size());
+    if (frames == 0) {
+        ImGui::End();
+        return;
+    }
+
+    // Rows are the phases, then the whole frame
+    auto time_of = [&](int frame, int row) {
+        const FrameTiming& timing = profiler.frame(frame);
+        return row < frame_phase_count ? timing.phase_ns[row]
+                                       : timing.total_ns;
+    };
+    ImGui::Text("%-16s %6s %6s %6s", "ms", "last", "avg", "max");
+    for (int row = 0; row <= frame_phase_count; ++row) {
+        std::int64_t sum = 0;
+        std::int64_t max = 0;
+        for (int f = 0; f < frames; ++f) {
+            sum += time_of(f, row);
+            max = std::max(max, time_of(f, row));
+        }
+        ImGui::Text("%-16s %6.2f %6.2f %6.2f",
+                    row < frame_phase_count
+                        ? frame_phase_name(static_cast<FramePhase>(row))
+                        : "frame",
+                    time_of(frames - 1, row) / 1e6,
+                    sum / 1e6 / frames,
+                    max / 1e6);
+    }
+
+    // One character per frame, from ' ' to '@' relative to the slowest one
+    // shown
+    static constexpr char ramp[] = " .:-=+*#%@";
+    constexpr int levels         = sizeof(ramp) - 2;
+    constexpr int width          = 42;
+    const int shown              = std::min(frames, width);
+    std::int64_t slowest         = 1;
+    for (int f = frames - shown; f < frames; ++f)
+        slowest = std::max(slowest, profiler.frame(f).total_ns);
+    char sparkline[width + 1];
+    for (int i = 0; i < shown; ++i) {
+        auto total   = profiler.frame(frames - shown + i).total_ns;
+        sparkline[i] = ramp[(total * levels + slowest - 1) / slowest];
+    }
+    sparkline[shown] = '\0';
+    ImGui::Separator();
+    ImGui::TextUnformatted(sparkline);
+
+    const int worst           = profiler.worst();
+    const FrameTiming& timing = profiler.frame(worst);
+    int slowest_phase         = 0;
+    for (int p = 1; p < frame_phase_count; ++p) {
+        if (timing.phase_ns[p] > timing.phase_ns[slowest_phase])
+            slowest_phase = p;
+    }
+    ImGui::Text("worst %.2f ms, %d frames ago, %s %.2f",
+                timing.total_ns / 1e6,
+                frames - 1 - worst,
+                frame_phase_name(static_cast<FramePhase>(slowest_phase)),
+                timing.phase_ns[slowest_phase] / 1e6);
+    ImGui::End();
+}
+
+// What the input line is for
+enum class InputMode
+{
+    NewTodo,
+    DueDate,
+    TagFilter,
+    Fuzzy,
+    NewList,
+    SearchLists,
+};
+
+// `state` must outlive the frame unchanged: it is read on after dispatching,
+// so it can't be a reference to a store's current value.
+void renderUI(const AppState& state, const Dispatch& dispatch)
+{
     ImGui::SetNextWindowPos(ImVec2(0, 0));
     ImGui::SetNextWindowSize(ImGui::GetIO().DisplaySize);
 
@@ -40,17 +1020,42 @@ void renderUI(lager::store<Action, AppState>& store)
     // Title
     ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.4f, 1.0f),
                        "TODO List Manager (Lager)");
+    renderListTabs(state, dispatch);
     ImGui::Separator();
 
     // State for input visibility
     static bool show_input             = false;
+    static InputMode input_mode        = InputMode::NewTodo;
+    static bool show_board             = false;
+    static bool show_by_priority       = false;
+    static std::string tag_filter;
+    static int fuzzy_selected          = 0;
+    static InputCompletions completions;
+    static bool show_allocations       = false;
+    static bool show_timings           = false;
+    static bool show_archive           = false;
+    static bool show_history           = false;
     static std::string preserved_input = state.current_input;
     static char input_buffer[256];
 
+    // Keys that closed the input line this frame aren't for the list
+    const bool input_was_open = show_input;
+
     // Show either input field OR buttons
     if (show_input) {
         // Input field replaces buttons
-        ImGui::TextColored(ImVec4(0.9f, 0.9f, 0.4f, 1.0f), "New Todo Item:");
+        const char* prompt = "New Todo Item:";
+        if (input_mode == InputMode::DueDate)
+            prompt = "Due:";
+        else if (input_mode == InputMode::TagFilter)
+            prompt = "Filter:";
+        else if (input_mode == InputMode::Fuzzy)
+            prompt = "Find:";
+        else if (input_mode == InputMode::NewList)
+            prompt = "Open list:";
+        else if (input_mode == InputMode::SearchLists)
+            prompt = "Find in all lists:";
+        ImGui::TextColored(ImVec4(0.9f, 0.9f, 0.4f, 1.0f), "%s", prompt);
         ImGui::SameLine();
 
         // Copy the current input state to our buffer
@@ -64,16 +1069,70 @@ void renderUI(lager::store<Action, AppState>& store)
         // Highlight the input field
         ImGui::PushStyleColor(ImGuiCol_FrameBg, ImVec4(0.2f, 0.2f, 0.3f, 1.0f));
 
+        ImGuiInputTextFlags flags = ImGuiInputTextFlags_EnterReturnsTrue;
+        if (input_mode == InputMode::NewTodo)
+            flags |= ImGuiInputTextFlags_CallbackAlways |
+                     ImGuiInputTextFlags_CallbackCompletion |
+                     ImGuiInputTextFlags_CallbackHistory;
         if (ImGui::InputText("##input",
                              input_buffer,
                              sizeof(input_buffer),
-                             ImGuiInputTextFlags_EnterReturnsTrue)) {
-            // When Enter is pressed, add the todo and hide the input
+                             flags,
+                             completionCallback,
+                             &completions)) {
+            // When Enter is pressed, add the todo (or set the due date, or
+            // the filter) and hide the input
             preserved_input = input_buffer;
-            store.dispatch(SetInputTextAction{input_buffer});
-            store.dispatch(AddTodoAction{});
+            switch (input_mode) {
+            case InputMode::NewTodo:
+                dispatch(SetInputTextAction{input_buffer});
+                dispatch(AddTodoAction{});
+                break;
+            case InputMode::DueDate:
+                if (auto due = parseDueTime(preserved_input, nowSeconds()))
+                    dispatch(SetDueAction{*due});
+                else
+                    dispatch(SetStatusAction{"Invalid due date."});
+                break;
+            case InputMode::TagFilter:
+                tag_filter = preserved_input;
+                // Marks are list positions, hidden rows would be hit too
+                dispatch(ClearMarksAction{});
+                break;
+            case InputMode::Fuzzy: {
+                // Jump to the pick; results may still be coming in
+                auto results = fuzzyFinder().results();
+                if (fuzzy_selected < int(results.matches.size()))
+                    dispatch(SelectTodoByIdAction{
+                        results.matches[fuzzy_selected].id,
+                        int(results.matches[fuzzy_selected].index)});
+                break;
+            }
+            case InputMode::NewList:
+                dispatch(OpenListAction{preserved_input});
+                break;
+            case InputMode::SearchLists: {
+                // Open the pick's list and select it there
+                auto results = listSearch().results();
+                if (fuzzy_selected < int(results.matches.size())) {
+                    const auto& match = results.matches[fuzzy_selected];
+                    dispatch(OpenListAction{match.list, match.id});
+                }
+                break;
+            }
+            }
             show_input      = false; // Hide the input after adding
             preserved_input = "";    // Clear for next time
+        } else if (input_mode == InputMode::Fuzzy && ImGui::IsItemEdited()) {
+            // Search as you type, the previous search is abandoned
+            fuzzyFinder().search(current_list(state), input_buffer);
+            fuzzy_selected = 0;
+        } else if (input_mode == InputMode::SearchLists &&
+                   ImGui::IsItemEdited()) {
+            if (global_workspace)
+                listSearch().search(global_workspace->directory(),
+                                    input_buffer);
+            fuzzy_selected = 0;
         } else if (ImGui::IsItemDeactivatedAfterEdit()) {
             // Update preserved input when editing ends
             preserved_input = input_buffer;
@@ -81,6 +1140,25 @@ void renderUI(lager::store<Action, AppState>& store)
 
         ImGui::PopStyleColor(); // Pop input highlight
 
+        // Looking completions up is a walk down the typed prefix, cheap
+        // enough for every keystroke
+        if (input_mode == InputMode::NewTodo && global_completions &&
+            completions.looked_up != completions.typed) {
+            completions.looked_up = completions.typed;
+            completions.suggestions =
+                global_completions->complete(completions.typed);
+            completions.chosen = 0;
+        }
+
+        // Up/Down pick among the matches while typing
+        if (input_mode == InputMode::Fuzzy ||
+            input_mode == InputMode::SearchLists) {
+            if (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_UpArrow)))
+                --fuzzy_selected;
+            if (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_DownArrow)))
+                ++fuzzy_selected; // Clamped when drawn
+        }
+
         // Cancel button (or ESC key)
         ImGui::SameLine();
         if (ImGui::Button("Cancel") ||
@@ -98,43 +1176,147 @@ void renderUI(lager::store<Action, AppState>& store)
         bool add_pressed = ImGui::Button("Add (a)") || ImGui::IsKeyPressed('a');
         if (add_pressed) {
             show_input      = true;
+            input_mode      = InputMode::NewTodo;
             preserved_input = ""; // Clear input for new entry
             input_buffer[0] = '\0';
+            completions     = InputCompletions{};
         }
 
         ImGui::SameLine();
         bool remove_pressed =
             ImGui::Button("Remove (r)") || ImGui::IsKeyPressed('r');
         if (remove_pressed) {
-            store.dispatch(RemoveSelectedTodoAction{});
+            if (effective_marks(state).empty())
+                dispatch(RemoveSelectedTodoAction{});
+            else
+                dispatch(RemoveMarkedAction{});
         }
 
         ImGui::SameLine();
         bool toggle_pressed =
             ImGui::Button("Toggle (t)") || ImGui::IsKeyPressed('t');
         if (toggle_pressed) {
-            store.dispatch(ToggleSelectedTodoAction{});
+            if (effective_marks(state).empty())
+                dispatch(ToggleSelectedTodoAction{nowSeconds()});
+            else
+                dispatch(ToggleMarkedAction{nowSeconds()});
+        }
+
+        ImGui::SameLine();
+        bool due_pressed = ImGui::Button("Due (d)") || ImGui::IsKeyPressed('d');
+        if (due_pressed && current_selection(state) >= 0) {
+            // Start from the current due date, if any
+            const auto& item =
+                current_list(state)[current_selection(state)];
+            show_input      = true;
+            input_mode      = InputMode::DueDate;
+            preserved_input = item.due ? formatDueTime(item.due).c_str() : "";
+        }
+
+        ImGui::SameLine();
+        bool board_pressed =
+            ImGui::Button("Board (b)") || ImGui::IsKeyPressed('b');
+        if (board_pressed) {
+            show_board = !show_board;
+            if (!show_board) {
+                // The list view always works on the main list
+                dispatch(FocusColumnAction{0});
+            }
+        }
+
+        ImGui::SameLine();
+        bool archive_pressed =
+            ImGui::Button("Archive (A)") || ImGui::IsKeyPressed('A');
+        if (archive_pressed) {
+            show_archive = !show_archive;
+            show_history = false;
+            if (show_archive)
+                openArchiveView(state.list_name);
+        }
+
+        ImGui::SameLine();
+        bool history_pressed =
+            ImGui::Button("History (H)") || ImGui::IsKeyPressed('H');
+        if (history_pressed) {
+            show_history = !show_history;
+            show_archive = false;
+            if (show_history)
+                openHistoryView(state.list_name);
+        }
+
+        ImGui::SameLine();
+        bool priority_pressed =
+            ImGui::Button("By priority (p)") || ImGui::IsKeyPressed('p');
+        if (priority_pressed) {
+            show_by_priority = !show_by_priority;
+            // Marks are positions in the list, they mean nothing when sorted
+            dispatch(ClearMarksAction{});
+        }
+
+        ImGui::SameLine();
+        bool filter_pressed =
+            ImGui::Button("Filter (f)") || ImGui::IsKeyPressed('f');
+        if (filter_pressed) {
+            // Edit the current filter; an empty one shows everything
+            show_input      = true;
+            input_mode      = InputMode::TagFilter;
+            preserved_input = tag_filter;
+        }
+
+        ImGui::SameLine();
+        bool find_pressed =
+            ImGui::Button("Find (/)") || ImGui::IsKeyPressed('/');
+        if (find_pressed) {
+            show_input      = true;
+            input_mode      = InputMode::Fuzzy;
+            preserved_input = "";
+            input_buffer[0] = '\0';
+            fuzzy_selected  = 0;
+            fuzzyFinder().search(current_list(state), "");
+        }
+
+        ImGui::SameLine();
+        bool search_lists_pressed =
+            ImGui::Button("Find in lists (F)") || ImGui::IsKeyPressed('F');
+        if (search_lists_pressed) {
+            show_input      = true;
+            input_mode      = InputMode::SearchLists;
+            preserved_input = "";
+            input_buffer[0] = '\0';
+            fuzzy_selected  = 0;
+            listSearch().search({}, "");
+        }
+
+        ImGui::SameLine();
+        bool list_pressed =
+            ImGui::Button("List (N)") || ImGui::IsKeyPressed('N');
+        if (list_pressed) {
+            // Another list by name, a new one if there is none
+            show_input      = true;
+            input_mode      = InputMode::NewList;
+            preserved_input = "";
+            input_buffer[0] = '\0';
         }
 
         ImGui::SameLine();
         bool save_pressed =
             ImGui::Button("Save (s)") || ImGui::IsKeyPressed('s');
         if (save_pressed) {
-            store.dispatch(RequestSaveAction{});
+            dispatch(RequestSaveAction{});
         }
 
         ImGui::SameLine();
         bool load_pressed =
             ImGui::Button("Load (l)") || ImGui::IsKeyPressed('l');
         if (load_pressed) {
-            store.dispatch(RequestLoadAction{});
+            dispatch(RequestLoadAction{});
         }
 
         ImGui::SameLine();
         bool quit_pressed =
             ImGui::Button("Quit (q)") || ImGui::IsKeyPressed('q');
         if (quit_pressed) {
-            store.dispatch(QuitAction{});
+            dispatch(QuitAction{});
         }
 
         ImGui::PopStyleColor(2); // Pop button style colors
@@ -149,58 +1331,299 @@ void renderUI(lager::store<Action, AppState>& store)
     ImGui::PushStyleColor(ImGuiCol_HeaderActive,
                           ImVec4(0.5f, 0.5f, 0.8f, 0.7f));
 
-    // Todo list with keyboard navigation
-    ImGui::BeginChild(
-        "TodoList", ImVec2(0, -ImGui::GetFrameHeightWithSpacing()), true);
+    // The main list shown in priority order instead of its own order
+    const bool sorted = show_by_priority && !show_board &&
+                        state.active_column == 0 && state.path.empty();
+    // A tag filter narrows the list view down, the board shows everything
+    const bool filtered = !tag_filter.empty() && !show_board;
+    // Only in the plain list view are rows positions in the list
+    const bool reordered = sorted || filtered;
+    const ListRows rows  = show_board
+                               ? ListRows{}
+                               : listRows(state, sorted, filtered ? tag_filter
+                                                                  : "");
+
+    // The archive view has its own keys, and the list's don't apply
+    ArchiveView& archive = archiveView();
+    if (show_archive && archive.list != state.list_name)
+        show_archive = false; // Another list was opened
+    if (!input_was_open && show_archive) {
+        if (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_UpArrow)))
+            --archive.selected;
+        if (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_DownArrow)))
+            ++archive.selected; // Clamped when drawn
+        if (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Escape)))
+            show_archive = false;
+    }
+
+    // So does the history browser: Left and Right go back and forth
+    // between versions
+    HistoryView& history = historyView();
+    if (show_history && history.list != state.list_name)
+        show_history = false;
+    if (!input_was_open && show_history) {
+        if (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_UpArrow)))
+            --history.selected;
+        if (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_DownArrow)))
+            ++history.selected;
+        if (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_LeftArrow)))
+            ++history.version; // Older; clamped when drawn
+        if (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_RightArrow)))
+            --history.version;
+        if (ImGui::IsKeyPressed('D')) {
+            history.diffing  = !history.diffing;
+            history.selected = 0;
+        }
+        if (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Escape)))
+            show_history = false;
+    }
+
+    // Handle keyboard navigation in the active list, when not adding
+    if (!input_was_open && !show_archive && !show_history) {
+        int active        = state.active_column;
+        const auto& items = current_list(state);
+        int selected      = current_selection(state);
+
+        const int last   = static_cast<int>(items.size()) - 1;
+        const bool shift = ImGui::GetIO().KeyShift;
+        const bool up =
+            ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_UpArrow));
+        const bool down =
+            ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_DownArrow));
 
-    // Handle keyboard navigation in the list
-    if (!show_input) { // Only navigate list when not adding
         // Up/Down arrows to navigate
-        if (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_UpArrow)) &&
-            state.selected_index > 0) {
-            store.dispatch(SelectTodoAction{state.selected_index - 1});
+        if (reordered) {
+            if (up && rows.selected > 0) {
+                dispatch(rows.select(rows.selected - 1));
+            }
+            if (down && rows.selected + 1 < rows.count) {
+                dispatch(rows.select(rows.selected + 1));
+            }
+        } else {
+            if (up && !shift && selected > 0) {
+                dispatch(SelectTodoAction{selected - 1});
+            }
+            if (down && !shift && selected < last) {
+                dispatch(SelectTodoAction{selected + 1});
+            }
+        }
+
+        // + and - raise and lower the priority of the selected item
+        if (selected >= 0 &&
+            (ImGui::IsKeyPressed('+') || ImGui::IsKeyPressed('='))) {
+            dispatch(SetPriorityAction{items[selected].priority + 1});
+        }
+        if (selected >= 0 && ImGui::IsKeyPressed('-')) {
+            dispatch(SetPriorityAction{items[selected].priority - 1});
+        }
+
+        // Shift+Up/Down (or K/J) to move the selected item, PageUp/PageDown
+        // to move it by a whole page. A contiguous block of marked items
+        // moves as a whole. Sorted or filtered rows aren't the list's own
+        // order, so neither moving nor marking apply there.
+        const IntervalSet marks = effective_marks(state);
+        Interval block{selected, selected + 1};
+        if (marks.intervals().size() == 1) {
+            block = marks.intervals()[0];
+        }
+        if (!reordered && block.begin >= 0) {
+            const int page_rows = std::max(
+                1,
+                static_cast<int>(ImGui::GetIO().DisplaySize.y /
+                                 ImGui::GetTextLineHeightWithSpacing()) -
+                    8);
+            if (block.begin > 0 &&
+                ((up && shift) || ImGui::IsKeyPressed('K'))) {
+                dispatch(
+                    MoveRangeAction{block.begin, block.end, block.begin - 1});
+            }
+            if (block.end <= last &&
+                ((down && shift) || ImGui::IsKeyPressed('J'))) {
+                dispatch(
+                    MoveRangeAction{block.begin, block.end, block.begin + 1});
+            }
+            if (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_PageUp))) {
+                dispatch(MoveRangeAction{
+                    block.begin, block.end, block.begin - page_rows});
+            }
+            if (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_PageDown))) {
+                dispatch(MoveRangeAction{
+                    block.begin, block.end, block.begin + page_rows});
+            }
+        }
+
+        // m marks the selected item, v starts (and then ends) marking a
+        // range, Esc drops all marks (and the tag filter)
+        if (!reordered && selected >= 0 && ImGui::IsKeyPressed('m')) {
+            dispatch(MarkTodoAction{selected});
+        }
+        if (!reordered && selected >= 0 && ImGui::IsKeyPressed('v')) {
+            if (state.mark_anchor < 0) {
+                dispatch(SetMarkAnchorAction{selected});
+            } else {
+                int anchor = state.mark_anchor;
+                dispatch(MarkRangeAction{std::min(anchor, selected),
+                                         std::max(anchor, selected) + 1});
+            }
+        }
+        if (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Escape))) {
+            tag_filter.clear();
+            dispatch(ClearMarksAction{});
+        }
+
+        // [ and ] switch to the previous and next list of the workspace
+        if (state.lists.size() > 1 && ImGui::IsKeyPressed('[')) {
+            tag_filter.clear();
+            dispatch(OpenListAction{neighbourList(state, -1)});
         }
-        if (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_DownArrow)) &&
-            state.selected_index < static_cast<int>(state.todos.size()) - 1) {
-            store.dispatch(SelectTodoAction{state.selected_index + 1});
+        if (state.lists.size() > 1 && ImGui::IsKeyPressed(']')) {
+            tag_filter.clear();
+            dispatch(OpenListAction{neighbourList(state, 1)});
         }
 
-        // Enter key to toggle selected item
+        // Enter key to toggle selected (or marked) items
         if (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Space))) {
-            store.dispatch(ToggleSelectedTodoAction{});
+            if (marks.empty())
+                dispatch(ToggleSelectedTodoAction{nowSeconds()});
+            else
+                dispatch(ToggleMarkedAction{nowSeconds()});
         }
 
-        // Delete key to remove selected item
+        // Delete key to remove selected (or marked) items
         if (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Delete))) {
-            store.dispatch(RemoveSelectedTodoAction{});
+            if (marks.empty())
+                dispatch(RemoveSelectedTodoAction{});
+            else
+                dispatch(RemoveMarkedAction{});
         }
-    }
 
-    for (int i = 0; i < state.todos.size(); i++) {
-        const auto& todo  = state.todos[i];
-        bool is_selected  = (i == state.selected_index);
-        std::string label = (todo.done ? "[x] " : "[ ] ") + todo.text;
+        // o (or Right in the list view) opens the subtasks of the selected
+        // item, Backspace (or Left) goes back to its parent
+        const bool left =
+            ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_LeftArrow));
+        const bool right =
+            ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_RightArrow));
+        if (selected >= 0 &&
+            (ImGui::IsKeyPressed('o') || (right && !show_board))) {
+            dispatch(OpenSubtasksAction{});
+        }
+        if (!state.path.empty() &&
+            (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Backspace)) ||
+             (left && !show_board))) {
+            dispatch(CloseSubtasksAction{});
+        }
 
-        // Use ImGui's built-in selection highlighting
-        if (ImGui::Selectable(label.c_str(), is_selected)) {
-            store.dispatch(SelectTodoAction{i});
+        if (show_board) {
+            // Left/Right to change column
+            if (left && active > 0) {
+                dispatch(FocusColumnAction{active - 1});
+            }
+            if (right && active < column_count(state) - 1) {
+                dispatch(FocusColumnAction{active + 1});
+            }
 
-            // Double-click to toggle
-            static int last_clicked_idx = -1;
-            static auto last_click_time = std::chrono::steady_clock::now();
-            auto now                    = std::chrono::steady_clock::now();
+            // < and > move the selected item to the neighbouring column
+            if (selected >= 0 && ImGui::IsKeyPressed('<') && active > 0) {
+                int to = active - 1;
+                dispatch(MoveColumnItemAction{
+                    active,
+                    selected,
+                    to,
+                    static_cast<int>(column_items(state, to).size())});
+            }
+            if (selected >= 0 && ImGui::IsKeyPressed('>') &&
+                active < column_count(state) - 1) {
+                int to = active + 1;
+                dispatch(MoveColumnItemAction{
+                    active,
+                    selected,
+                    to,
+                    static_cast<int>(column_items(state, to).size())});
+            }
+        }
+    }
 
-            if (last_clicked_idx == i &&
-                std::chrono::duration_cast<std::chrono::milliseconds>(
-                    now - last_click_time)
-                        .count() < 500) {
-                store.dispatch(ToggleSelectedTodoAction{});
-                last_clicked_idx = -1; // Reset to prevent triple-click
+    const bool finding = show_input && input_mode == InputMode::Fuzzy;
+    const FuzzyResults matches =
+        finding ? fuzzyFinder().results() : FuzzyResults{};
+    const bool searching_lists =
+        show_input && input_mode == InputMode::SearchLists;
+    const ListSearchResults list_matches =
+        searching_lists ? listSearch().results() : ListSearchResults{};
+    if (finding) {
+        // The palette takes the place of the list while it is open
+        ImGui::BeginChild(
+            "Matches", ImVec2(0, -ImGui::GetFrameHeightWithSpacing()), true);
+        renderFuzzyMatches(matches, fuzzy_selected);
+    } else if (searching_lists) {
+        ImGui::BeginChild(
+            "Matches", ImVec2(0, -ImGui::GetFrameHeightWithSpacing()), true);
+        renderListMatches(list_matches, fuzzy_selected);
+    } else if (show_archive) {
+        ImGui::TextColored(ImVec4(0.9f, 0.9f, 0.4f, 1.0f),
+                           "Archive of %s",
+                           state.list_name.c_str());
+        ImGui::BeginChild(
+            "Archive", ImVec2(0, -ImGui::GetFrameHeightWithSpacing()), true);
+        renderArchive(archive);
+    } else if (show_history) {
+        const int count = static_cast<int>(history.versions.size());
+        if (count > 0) {
+            const int shown     = std::clamp(history.version, 0, count - 1);
+            const auto& version = history.versions[count - 1 - shown];
+            if (history.diffing && history.diffed == shown) {
+                const ListDiff& diff = history.diff;
+                ImGui::TextColored(ImVec4(0.9f, 0.9f, 0.4f, 1.0f),
+                                   "Changes to %s since version %d of %d, "
+                                   "saved %s: +%zu -%zu ~%zu >%zu",
+                                   state.list_name.c_str(),
+                                   count - shown,
+                                   count,
+                                   formatDueTime(version.saved_at).c_str(),
+                                   diff.added,
+                                   diff.removed,
+                                   diff.changed,
+                                   diff.moved);
             } else {
-                last_clicked_idx = i;
-                last_click_time  = now;
+                ImGui::TextColored(ImVec4(0.9f, 0.9f, 0.4f, 1.0f),
+                                   "History of %s: version %d of %d, saved %s",
+                                   state.list_name.c_str(),
+                                   count - shown,
+                                   count,
+                                   formatDueTime(version.saved_at).c_str());
             }
+        } else {
+            ImGui::TextColored(ImVec4(0.9f, 0.9f, 0.4f, 1.0f),
+                               "History of %s",
+                               state.list_name.c_str());
+        }
+        ImGui::BeginChild(
+            "History", ImVec2(0, -ImGui::GetFrameHeightWithSpacing()), true);
+        renderHistory(history, state.todos);
+    } else if (show_board) {
+        ImGui::BeginChild(
+            "Board", ImVec2(0, -ImGui::GetFrameHeightWithSpacing()), false);
+        renderBoard(state, dispatch);
+    } else {
+        // Where we are, when inside subtasks
+        if (!state.path.empty()) {
+            ImGui::TextColored(ImVec4(0.9f, 0.9f, 0.4f, 1.0f),
+                               "%s",
+                               currentListTitle(state).c_str());
         }
+
+        // Todo list with keyboard navigation
+        ImGui::BeginChild(
+            "TodoList", ImVec2(0, -ImGui::GetFrameHeightWithSpacing()), true);
+        renderTodoRows(
+            rows.count,
+            rows.item_at,
+            rows.selected,
+            reordered ? IntervalSet{} : effective_marks(state),
+            [&](int i) { dispatch(rows.select(i)); },
+            [&](int) {
+                dispatch(ToggleSelectedTodoAction{nowSeconds()});
+            });
     }
 
     ImGui::EndChild();
@@ -211,28 +1634,407 @@ void renderUI(lager::store<Action, AppState>& store)
     ImGui::TextColored(ImVec4(0.7f, 0.7f, 0.7f, 1.0f),
                        "Status: %s",
                        state.status_message.c_str());
+    if (int marked = effective_marks(state).count()) {
+        ImGui::SameLine();
+        ImGui::TextColored(
+            ImVec4(0.9f, 0.9f, 0.4f, 1.0f), "[%d marked]", marked);
+    }
+    if (!state.due_index.empty()) {
+        // The index is ordered by due time, the next one is its first entry
+        const Reminder& next = state.due_index[0];
+        ImGui::SameLine();
+        ImGui::TextColored(ImVec4(0.9f, 0.6f, 0.4f, 1.0f),
+                           "[next due %s: %s]",
+                           formatDueTime(next.due).c_str(),
+                           next.text.c_str());
+    }
+    if (finding) {
+        ImGui::SameLine();
+        ImGui::TextColored(ImVec4(0.4f, 0.9f, 0.9f, 1.0f),
+                           "[%zu matches, %zu/%zu scanned]",
+                           matches.matches.size(),
+                           matches.scanned,
+                           matches.total);
+    }
+    if (searching_lists) {
+        ImGui::SameLine();
+        ImGui::TextColored(ImVec4(0.4f, 0.9f, 0.9f, 1.0f),
+                           "[%zu%s matches, %zu/%zu lists, %.1f MB]",
+                           list_matches.matches.size(),
+                           list_matches.truncated ? "+" : "",
+                           list_matches.files_scanned,
+                           list_matches.files,
+                           list_matches.bytes / 1e6);
+    }
+    if (show_archive) {
+        ImGui::SameLine();
+        ImGui::TextColored(ImVec4(0.4f, 0.9f, 0.9f, 1.0f),
+                           "[archive: %zu of %zu items read, %zu/%zu segments]",
+                           archive.read.size(),
+                           archive.items,
+                           archive.segments_read,
+                           archive.segments.size());
+    }
+    if (show_history && history.store) {
+        ImGui::SameLine();
+        ImGui::TextColored(ImVec4(0.4f, 0.9f, 0.9f, 1.0f),
+                           "[history: %zu items, %zu chunks read, %zu shared]",
+                           history.shown.todos.size(),
+                           history.store->stats().chunks_read,
+                           history.store->stats().chunks_shared);
+        if (history.diffing) {
+            ImGui::SameLine();
+            ImGui::TextColored(ImVec4(0.4f, 0.9f, 0.9f, 1.0f),
+                               "[diff: %zu items compared]",
+                               history.diff.items_compared);
+        }
+    }
+    if (filtered) {
+        ImGui::SameLine();
+        ImGui::TextColored(ImVec4(0.4f, 0.9f, 0.9f, 1.0f),
+                           "[filter %s: %d shown]",
+                           tag_filter.c_str(),
+                           rows.count);
+    }
 
     // Help text for keyboard shortcuts - changes when adding
-    if (show_input) {
+    if (show_input && input_mode == InputMode::DueDate) {
+        ImGui::TextColored(ImVec4(0.5f, 0.5f, 0.5f, 1.0f),
+                           "YYYY-MM-DD [HH:MM] or +30m/+2h/+1d, empty to "
+                           "clear; Enter to set, Esc to cancel");
+    } else if (show_input && input_mode == InputMode::TagFilter) {
+        ImGui::TextColored(ImVec4(0.5f, 0.5f, 0.5f, 1.0f),
+                           "Tags to show, e.g. @oncall #infra|#db -#later; "
+                           "empty shows all; Enter to apply, Esc to cancel");
+    } else if (finding) {
+        ImGui::TextColored(ImVec4(0.5f, 0.5f, 0.5f, 1.0f),
+                           "Type to search the list; Up/Down to pick, Enter "
+                           "to jump to it, Esc to cancel");
+    } else if (searching_lists) {
+        ImGui::TextColored(ImVec4(0.5f, 0.5f, 0.5f, 1.0f),
+                           "Type to search the saved lists; Up/Down to pick, "
+                           "Enter to open it, Esc to cancel");
+    } else if (show_input && input_mode == InputMode::NewList) {
+        ImGui::TextColored(ImVec4(0.5f, 0.5f, 0.5f, 1.0f),
+                           "Name of the list to open, a new one is created; "
+                           "letters, digits, - and _; Esc to cancel");
+    } else if (show_archive && !show_input) {
+        ImGui::TextColored(ImVec4(0.5f, 0.5f, 0.5f, 1.0f),
+                           "Done items moved out of the list; Up/Down to "
+                           "scroll, A or Esc to go back to the list");
+    } else if (show_history && !show_input) {
         ImGui::TextColored(ImVec4(0.5f, 0.5f, 0.5f, 1.0f),
-                           "Enter to add the todo item, Esc to cancel");
+                           "Every saved version; Left/Right for older/newer, "
+                           "D for what changed since, Up/Down to scroll, H "
+                           "or Esc to go back");
+    } else if (show_input) {
+        for (int i = 0; i < int(completions.suggestions.size()); ++i) {
+            if (i > 0)
+                ImGui::SameLine();
+            ImGui::TextColored(i == completions.chosen
+                                   ? ImVec4(0.9f, 0.9f, 0.4f, 1.0f)
+                                   : ImVec4(0.5f, 0.5f, 0.5f, 1.0f),
+                               "[%s]",
+                               completions.suggestions[i].c_str());
+        }
+        ImGui::TextColored(ImVec4(0.5f, 0.5f, 0.5f, 1.0f),
+                           "Enter to add the todo item, Tab to complete, "
+                           "Up/Down to pick a completion, Esc to cancel");
     } else {
         ImGui::TextColored(ImVec4(0.5f, 0.5f, 0.5f, 1.0f),
-                           "Shortcuts: a (add), r (remove), t (toggle), s "
-                           "(save), l (load), q (quit)");
-        ImGui::TextColored(
-            ImVec4(0.5f, 0.5f, 0.5f, 1.0f),
-            "In list: Up/Down to select, Enter to toggle, Delete to remove");
+                           "Shortcuts: a (add), r (remove), t (toggle), d "
+                           "(due), +/- (priority), p (by priority), f "
+                           "(filter), / (find), F (find in lists), b "
+                           "(board), A (archive), H (history), N (list), [ ] "
+                           "(lists), s (save), l (load), M (allocations), T "
+                           "(timings), q (quit)");
+        if (show_board) {
+            ImGui::TextColored(ImVec4(0.5f, 0.5f, 0.5f, 1.0f),
+                               "In board: Left/Right to change column, < > "
+                               "to move between columns");
+        } else {
+            ImGui::TextColored(ImVec4(0.5f, 0.5f, 0.5f, 1.0f),
+                               "In list: Up/Down to select, Enter to toggle, "
+                               "Delete to remove, Shift+Up/Down (K/J) or "
+                               "PgUp/PgDn to move, m/v to mark, Right/Left "
+                               "to open/close subtasks");
+        }
     }
 
     ImGui::End();
 
+    if (!input_was_open && ImGui::IsKeyPressed('M'))
+        show_allocations = !show_allocations;
+    if (show_allocations)
+        renderAllocations();
+    if (!input_was_open && ImGui::IsKeyPressed('T'))
+        show_timings = !show_timings;
+    if (show_timings)
+        renderFrameTimings();
+
     ImGui::PopStyleColor(); // Pop NavHighlight style
     ImGui::PopStyleVar();   // Pop FrameBorderSize style
 }
 
-int main()
+// The UI drawn into an off-screen screen instead of the terminal, for the
+// headless modes
+class OffscreenUI
+{
+public:
+    OffscreenUI()
+    {
+        IMGUI_CHECKVERSION();
+        ImGui::CreateContext();
+        ImTui_ImplText_Init();
+        ImGuiIO& io    = ImGui::GetIO();
+        io.IniFilename = nullptr; // Nothing to keep between runs
+        io.DisplaySize = ImVec2(120, 40);
+    }
+    ~OffscreenUI()
+    {
+        ImTui_ImplText_Shutdown();
+        ImGui::DestroyContext();
+    }
+
+    OffscreenUI(const OffscreenUI&)            = delete;
+    OffscreenUI& operator=(const OffscreenUI&) = delete;
+
+    // One frame, with nothing pressed
+    void draw(const AppState& state)
+    {
+        {
+            AllocPhaseScope phase{AllocPhase::Input};
+            ImTui_ImplText_NewFrame();
+        }
+        {
+            AllocPhaseScope phase{AllocPhase::Render};
+            ImGui::NewFrame();
+            renderUI(state, dispatch_);
+            ImGui::Render();
+        }
+        AllocPhaseScope phase{AllocPhase::Draw};
+        ImTui_ImplText_RenderDrawData(ImGui::GetDrawData(), &screen_);
+    }
+
+private:
+    ImTui::TScreen screen_;
+    const Dispatch dispatch_ = [](Action) {};
+};
+
+// Headless frames of the UI over a synthetic list: no terminal and no input,
+// drawn into an off-screen screen. Reports the time per frame; with
+// allocation tracking built in, fails (returns 1) if any frame after the
+// first few allocates, which an idle UI shouldn't.
+int runFrameBench(int items, int frames)
+{
+    spdlog::set_level(spdlog::level::off);
+
+    AppState state;
+    const std::int64_t now = nowSeconds();
+    auto apply             = [&state](Action action) {
+        state = reducer(std::move(state), action).first;
+    };
+    for (int i = 0; i < items; ++i) {
+        apply(SetInputTextAction{"Task " + std::to_string(i) +
+                                 (i % 3 ? " #home" : " @oncall #infra")});
+        apply(AddTodoAction{});
+        if (i % 5 == 0)
+            apply(SetPriorityAction{1 + i % 3});
+        if (i % 7 == 0)
+            apply(SetDueAction{now + i * 60});
+        if (i % 4 == 0)
+            apply(ToggleSelectedTodoAction{now});
+    }
+    apply(SelectTodoAction{0});
+
+    OffscreenUI ui;
+    // Enough for ImGui's buffers and the statics of renderUI to settle
+    constexpr int warm_up = 10;
+    int allocating        = 0;
+    auto start            = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < warm_up + frames; ++frame) {
+        if (frame == warm_up)
+            start = std::chrono::steady_clock::now();
+        alloc_frame_begin();
+        ui.draw(state);
+        alloc_frame_end();
+
+        const AllocReport& report = last_alloc_frame();
+        if (frame < warm_up || report.total().allocations == 0)
+            continue;
+        if (allocating++ == 0) {
+            std::cout << "Frame " << frame - warm_up << " allocated:";
+            for (int p = 0; p < alloc_phase_count; ++p) {
+                if (report.phases[p].allocations > 0)
+                    std::cout << " " << report.phases[p].allocations << " ("
+                              << report.phases[p].bytes << " bytes) in "
+                              << alloc_phase_name(static_cast<AllocPhase>(p));
+            }
+            std::cout << std::endl;
+        }
+    }
+    auto elapsed = std::chrono::duration<double, std::micro>(
+        std::chrono::steady_clock::now() - start);
+
+    std::cout << frames << " frames of " << items << " items: "
+              << elapsed.count() / frames << " us per frame" << std::endl;
+    if (!alloc_tracking_enabled) {
+        std::cout << "Allocations not checked, configure with "
+                     "-DTUI_TODO_ALLOC_TRACKING=ON"
+                  << std::endl;
+        return 0;
+    }
+    if (allocating > 0) {
+        std::cout << "FAIL: " << allocating << " of " << frames
+                  << " steady frames allocated" << std::endl;
+        return 1;
+    }
+    std::cout << "OK: no steady frame allocated" << std::endl;
+    return 0;
+}
+
+// Percentiles of `samples` (nanoseconds), and how many fall in buckets of
+// doubling width: under 1 us, under 2 us, under 4 us and so on.
+void printLatencies(const char* what, std::vector<std::int64_t> samples)
+{
+    if (samples.empty())
+        return;
+    std::sort(samples.begin(), samples.end());
+    auto at = [&](double quantile) {
+        auto i = static_cast<std::size_t>(quantile * samples.size());
+        return samples[std::min(i, samples.size() - 1)] / 1000.0;
+    };
+    std::cout << std::fixed << std::setprecision(1) << what
+              << " latency (us): p50 " << at(0.5) << ", p90 " << at(0.9)
+              << ", p99 " << at(0.99) << ", max " << samples.back() / 1000.0
+              << std::endl;
+
+    std::vector<std::size_t> buckets;
+    for (auto ns : samples) {
+        std::size_t bucket = 0;
+        while ((std::int64_t{1000} << bucket) <= ns)
+            ++bucket;
+        if (bucket >= buckets.size())
+            buckets.resize(bucket + 1);
+        ++buckets[bucket];
+    }
+    const std::size_t most = *std::max_element(buckets.begin(), buckets.end());
+    for (std::size_t bucket = 0; bucket < buckets.size(); ++bucket) {
+        std::string limit = "< " + std::to_string(1 << bucket) + " us";
+        std::cout << std::setw(12) << limit << " "
+                  << std::string(40 * buckets[bucket] / most, '#') << " "
+                  << buckets[bucket] << std::endl;
+    }
+}
+
+// Feeds a recorded session to the reducer again, as fast as it goes or at
+// the pace it was recorded, and reports how long reducing each action (and,
+// with `render`, drawing the frame after it) took. Effects don't run: what
+// they dispatched was recorded along with the rest.
+int runReplay(const std::filesystem::path& path, bool realtime, bool render)
 {
+    spdlog::set_level(spdlog::level::warn);
+    auto log = read_action_log(path);
+    if (!log)
+        return 1;
+
+    std::optional<OffscreenUI> ui;
+    if (render)
+        ui.emplace();
+    std::vector<std::int64_t> reduce_ns;
+    std::vector<std::int64_t> frame_ns;
+    reduce_ns.reserve(log->actions.size());
+
+    using Clock = std::chrono::steady_clock;
+    auto ns     = [](Clock::duration d) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+    };
+
+    AppState state   = std::move(log->initial_state);
+    const auto start = Clock::now();
+    auto due         = start;
+    for (const auto& recorded : log->actions) {
+        if (realtime) {
+            due += std::chrono::microseconds(recorded.delay_us);
+            std::this_thread::sleep_until(due);
+        }
+        auto before  = Clock::now();
+        state        = reducer(std::move(state), recorded.action).first;
+        auto reduced = Clock::now();
+        reduce_ns.push_back(ns(reduced - before));
+        if (ui) {
+            ui->draw(state);
+            frame_ns.push_back(ns(Clock::now() - reduced));
+        }
+    }
+    const double seconds  = ns(Clock::now() - start) / 1e9;
+    std::int64_t reducing = 0;
+    for (auto t : reduce_ns)
+        reducing += t;
+
+    std::cout << log->actions.size() << " actions replayed in " << seconds
+              << " s, " << log->actions.size() / (reducing / 1e9)
+              << " actions/s reducing" << std::endl;
+    printLatencies("reduce", std::move(reduce_ns));
+    printLatencies("frame", std::move(frame_ns));
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    // --- Command line ---
+    bool threaded_reducer = false;
+    bool frame_bench      = false;
+    bool replay_realtime  = false;
+    bool replay_render    = false;
+    std::filesystem::path trace_path; // Chrome trace of the last frames
+    std::filesystem::path record_path;
+    std::filesystem::path replay_path;
+    std::size_t list_cache    = 1000000; // Items of lists kept in memory
+    std::int64_t archive_days = 30; // Done items older go to the archive
+    auto encoding             = Persistence::Encoding::Json;
+    bool shared               = false; // With other instances, see Replica
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg == "--threaded-reducer") {
+            threaded_reducer = true;
+        } else if (arg == "--frame-bench") {
+            frame_bench = true;
+        } else if (arg == "--profile-trace" && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else if (arg == "--record" && i + 1 < argc) {
+            record_path = argv[++i];
+        } else if (arg == "--replay" && i + 1 < argc) {
+            replay_path = argv[++i];
+        } else if (arg == "--replay-realtime") {
+            replay_realtime = true;
+        } else if (arg == "--replay-render") {
+            replay_render = true;
+        } else if (arg == "--list-cache" && i + 1 < argc) {
+            list_cache = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--archive-after" && i + 1 < argc) {
+            archive_days = std::strtoll(argv[++i], nullptr, 10);
+        } else if (arg == "--compress") {
+            encoding = Persistence::Encoding::Compressed;
+        } else if (arg == "--shared") {
+            shared = true;
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            std::cerr << "Usage: " << argv[0]
+                      << " [--threaded-reducer] [--frame-bench]"
+                         " [--profile-trace FILE] [--record FILE]"
+                         " [--replay FILE [--replay-realtime]"
+                         " [--replay-render]] [--list-cache ITEMS]"
+                         " [--archive-after DAYS] [--compress] [--shared]"
+                      << std::endl;
+            return 1;
+        }
+    }
+    if (frame_bench)
+        return runFrameBench(10000, 300);
+    if (!replay_path.empty())
+        return runReplay(replay_path, replay_realtime, replay_render);
+
     // --- Determine Paths FIRST ---
     std::filesystem::path data_path;
     std::filesystem::path log_file_path;
@@ -271,24 +2073,68 @@ int main()
     }
 
     spdlog::info("Application starting");
+    start_tracing_from_env();
+    trace_thread_name("ui");
 
-    // --- Persistence Path ---
+    // --- Workspace ---
+    // The default list, todos.json, and the others next to it
     spdlog::info("Data file path: {}", data_path.string());
-    initialize_persistence_path(data_path);
+    Workspace workspace{data_path.parent_path(),
+                        list_cache,
+                        archive_days * 24 * 60 * 60,
+                        encoding,
+                        shared};
+    initialize_workspace(&workspace);
 
     // --- Initial State ---
-    auto initial_state_opt = Persistence::load_state(data_path);
-    AppState initial_state;
-    if (initial_state_opt) {
-        initial_state                = *initial_state_opt;
-        initial_state.status_message = "State loaded.";
-        spdlog::info("Loaded initial state from disk");
-    } else {
-        initial_state                = AppState{};
-        initial_state.status_message = "Ready (new list).";
-        spdlog::info("No saved state found or error loading, starting fresh.");
-    }
+    AppState initial_state       = workspace.open_active();
     initial_state.exit_requested = false;
+    spdlog::info("Opened list {}: {}",
+                 initial_state.list_name,
+                 initial_state.status_message);
+    auto pool_stats              = memory_pool().stats();
+    spdlog::info("Memory pool: {} KiB reserved, {} KiB used, {:.1f}% "
+                 "fragmentation",
+                 pool_stats.reserved / 1024,
+                 pool_stats.used / 1024,
+                 pool_stats.fragmentation() * 100);
+
+    // --- Session recording ---
+    std::optional<ActionRecorder> recorder;
+    if (!record_path.empty()) {
+        recorder.emplace(record_path, initial_state);
+        if (recorder->ok()) {
+            global_action_recorder = &*recorder;
+            spdlog::info("Recording actions to {}", record_path.string());
+        } else {
+            spdlog::error("Could not record to {}", record_path.string());
+            recorder.reset();
+        }
+    }
+
+    // --- Reminders ---
+    // Due dates of the loaded state are scheduled up front; past ones fire
+    // on the first tick.
+    TimingWheel reminder_wheel{nowSeconds()};
+    initialize_reminders(&reminder_wheel);
+    for (const auto& reminder : initial_state.due_index.entries())
+        reminder_wheel.schedule(reminder);
+
+    // --- Live reload ---
+    // Lists changed on disk by other programs are read on the watcher's
+    // thread and taken between frames, merged with the edits made here on
+    // a second one; shared, edits are merged instead
+    std::optional<ListWatcher> list_watcher;
+    if (!shared)
+        initialize_list_watcher(&list_watcher.emplace(workspace));
+
+    // --- Completions ---
+    // Seeded with what's already in the lists; AddTodoAction adds the rest
+    CompletionTrie completion_trie;
+    record_completions(completion_trie, initial_state.todos);
+    for (const auto& column : initial_state.columns)
+        record_completions(completion_trie, column.items);
+    initialize_completions(&completion_trie);
 
     // --- ImTUI Setup ---
     IMGUI_CHECKVERSION();
@@ -298,40 +2144,131 @@ int main()
     ImGuiIO& io = ImGui::GetIO();
     // io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
 
-    // --- Lager Store Setup ---
-    auto store = lager::make_store<Action>(initial_state,
-                                           lager::with_manual_event_loop{},
-                                           lager::with_reducer(reducer));
-
-    // --- Store watcher for handling exit ---
-    bool should_exit = false;
-    lager::watch(store, [&should_exit](AppState const& state) {
-        if (state.exit_requested) {
-            spdlog::info("Exit requested flag detected, stopping loop.");
-            should_exit = true;
-        }
-    });
-
     // --- Main loop ---
     spdlog::info("Starting UI loop");
     const int renderDelayMs = 33; // ~30 FPS
 
-    while (!should_exit) {
+    FrameProfiler& profiler = frameProfiler();
+    using Zone              = FrameProfiler::Zone;
+
+    auto draw_frame = [&](const AppState& state, const Dispatch& dispatch) {
         // Start the Dear ImGui frame
-        ImTui_ImplNcurses_NewFrame();
-        ImTui_ImplText_NewFrame();
-        ImGui::NewFrame();
+        {
+            AllocPhaseScope phase{AllocPhase::Input};
+            Zone zone{profiler, FramePhase::Input};
+            ImTui_ImplNcurses_NewFrame();
+            ImTui_ImplText_NewFrame();
+        }
 
         // Render our UI
-        renderUI(store);
+        {
+            AllocPhaseScope phase{AllocPhase::Render};
+            {
+                Zone zone{profiler, FramePhase::NewFrame};
+                ImGui::NewFrame();
+            }
+            Zone zone{profiler, FramePhase::RenderUI};
+            renderUI(state, dispatch);
+            ImGui::Render();
+        }
 
         // Rendering
-        ImGui::Render();
-        ImTui_ImplText_RenderDrawData(ImGui::GetDrawData(), screen);
+        AllocPhaseScope phase{AllocPhase::Draw};
+        {
+            Zone zone{profiler, FramePhase::RenderDrawData};
+            ImTui_ImplText_RenderDrawData(ImGui::GetDrawData(), screen);
+        }
+        Zone zone{profiler, FramePhase::DrawScreen};
         ImTui_ImplNcurses_DrawScreen();
+    };
+
+    // Advancing the wheel only touches what expires, so this runs every frame
+    std::vector<Reminder> fired;
+    auto fire_reminders = [&](const Dispatch& dispatch) {
+        AllocPhaseScope phase{AllocPhase::Input};
+        Zone zone{profiler, FramePhase::Input};
+        reminder_wheel.advance(nowSeconds(), fired);
+        for (auto& reminder : fired)
+            dispatch(ReminderDueAction{std::move(reminder)});
+        fired.clear();
+    };
 
-        // Sleep to reduce CPU usage
-        std::this_thread::sleep_for(std::chrono::milliseconds(renderDelayMs));
+    if (threaded_reducer) {
+        // --- Reducer on its own thread ---
+        // The render thread only ever reads published snapshots, so a slow
+        // reducer step can no longer stall drawing.
+        spdlog::info("Running reducer on a dedicated thread");
+        ReducerThread reducer_thread{initial_state};
+        const Dispatch dispatch = [&reducer_thread](Action action) {
+            trace_instant(action_names[action.index()], "dispatch");
+            reducer_thread.dispatch(std::move(action));
+        };
+        dispatch(ArchiveDoneAction{nowSeconds()});
+
+        while (true) {
+            const AppState& state = reducer_thread.latest();
+            if (state.exit_requested) {
+                spdlog::info("Exit requested flag detected, stopping loop.");
+                break;
+            }
+            alloc_frame_begin();
+            profiler.begin_frame();
+            {
+                TraceScope traced{"frame", "frame"};
+                fire_reminders(dispatch);
+                if (list_watcher)
+                    list_watcher->poll(dispatch);
+                draw_frame(state, dispatch);
+            }
+            profiler.end_frame();
+            alloc_frame_end();
+
+            // Sleep to reduce CPU usage
+            std::this_thread::sleep_for(
+                std::chrono::milliseconds(renderDelayMs));
+        }
+    } else {
+        // --- Lager Store Setup ---
+        auto store = lager::make_store<Action>(initial_state,
+                                               lager::with_manual_event_loop{},
+                                               lager::with_reducer(reducer));
+        const Dispatch dispatch = [&store](Action action) {
+            trace_instant(action_names[action.index()], "dispatch");
+            store.dispatch(std::move(action));
+        };
+        dispatch(ArchiveDoneAction{nowSeconds()});
+
+        // --- Store watcher for handling exit ---
+        bool should_exit = false;
+        lager::watch(store, [&should_exit](AppState const& state) {
+            if (state.exit_requested) {
+                spdlog::info("Exit requested flag detected, stopping loop.");
+                should_exit = true;
+            }
+        });
+
+        while (!should_exit) {
+            alloc_frame_begin();
+            profiler.begin_frame();
+            {
+                TraceScope traced{"frame", "frame"};
+                fire_reminders(dispatch);
+                if (list_watcher)
+                    list_watcher->poll(dispatch);
+                // The store's value is replaced by every dispatch, which
+                // the frame makes while it still reads from the state
+                // (board columns and subtask lists are references into
+                // it). A copy shares everything and keeps it alive.
+                const AppState snapshot = store.get();
+                draw_frame(snapshot, dispatch);
+            }
+            profiler.end_frame();
+            alloc_frame_end();
+
+            // Sleep to reduce CPU usage
+            std::this_thread::sleep_for(
+                std::chrono::milliseconds(renderDelayMs));
+        }
     }
 
     // --- Cleanup ---
@@ -339,6 +2276,15 @@ int main()
     ImTui_ImplNcurses_Shutdown();
     ImGui::DestroyContext();
 
+    if (!trace_path.empty()) {
+        if (profiler.write_chrome_trace(trace_path))
+            spdlog::info("Wrote frame trace to {}", trace_path.string());
+        else
+            spdlog::error("Could not write frame trace to {}",
+                          trace_path.string());
+    }
+
+    stop_tracing();
     spdlog::info("Application finished cleanly");
     spdlog::shutdown();
     return 0;
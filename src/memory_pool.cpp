@@ -0,0 +1,94 @@
+#include "memory_pool.hpp"
+
+#include "alloc_tracking.hpp"
+
+#include <new>
+
+MemoryPool::MemoryPool()
+{
+    std::size_t index = 0;
+    for (std::size_t size = 16; size <= 128; size += 16)
+        classes_[index++].block_size = size;
+    for (std::size_t base = 128; base < max_pooled; base *= 2) {
+        for (std::size_t step = 1; step <= 4; ++step)
+            classes_[index++].block_size = base + base / 4 * step;
+    }
+
+    std::size_t size_class = 0;
+    for (std::size_t i = 0; i < class_of_.size(); ++i) {
+        while (classes_[size_class].block_size < i * 16)
+            ++size_class;
+        class_of_[i] = static_cast<std::uint8_t>(size_class);
+    }
+}
+
+void* MemoryPool::allocate(std::size_t size)
+{
+    if (size > max_pooled) {
+        large_.fetch_add(size, std::memory_order_relaxed);
+        return ::operator new(size);
+    }
+    // What's bigger went through operator new, which counts itself
+    if constexpr (alloc_tracking_enabled)
+        alloc_count(true, size);
+    auto& pool = classes_[class_of_[(size + 15) / 16]];
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    ++pool.allocations;
+    ++pool.live;
+    pool.requested += size;
+
+    if (pool.free) {
+        ++pool.free_list_hits;
+        FreeBlock* block = pool.free;
+        pool.free        = block->next;
+        return block;
+    }
+    if (pool.carved == pool.slab_end) {
+        // Not value-initialized, there's no need to touch it all now
+        pool.slabs.emplace_back(new char[slab_size]);
+        pool.carved   = pool.slabs.back().get();
+        pool.slab_end = pool.carved + slab_size / pool.block_size *
+                                          pool.block_size;
+    }
+    void* block = pool.carved;
+    pool.carved += pool.block_size;
+    return block;
+}
+
+void MemoryPool::deallocate(void* data, std::size_t size)
+{
+    if (size > max_pooled) {
+        large_.fetch_sub(size, std::memory_order_relaxed);
+        ::operator delete(data);
+        return;
+    }
+    if constexpr (alloc_tracking_enabled)
+        alloc_count(false, 0);
+    auto& pool = classes_[class_of_[(size + 15) / 16]];
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    --pool.live;
+    pool.requested -= size;
+    pool.free = new (data) FreeBlock{pool.free};
+}
+
+MemoryPool::Stats MemoryPool::stats() const
+{
+    Stats stats;
+    for (auto& pool : classes_) {
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        stats.reserved += pool.slabs.size() * slab_size;
+        stats.used += pool.live * pool.block_size;
+        stats.requested += pool.requested;
+        stats.allocations += pool.allocations;
+        stats.free_list_hits += pool.free_list_hits;
+        stats.slab_allocations += pool.slabs.size();
+    }
+    stats.large = large_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+MemoryPool& memory_pool()
+{
+    static auto* pool = new MemoryPool;
+    return *pool;
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <immer/memory_policy.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Size-class pool for the many small, similarly sized blocks the lists are
+// made of (immer nodes, interned texts, subtask nodes). Each class carves
+// 64 KiB slabs into equal blocks and keeps the freed ones on a free list, so
+// after a list has been loaded once, loading or deleting another is mostly
+// pushing and popping free lists instead of going through malloc, and the
+// blocks of a list stay packed together in a few slabs.
+//
+// Slabs are kept for reuse, never returned. Blocks over max_pooled bytes go
+// straight to operator new. Thread-safe, with a lock per size class.
+class MemoryPool
+{
+public:
+    static constexpr std::size_t max_pooled = 4096;
+    static constexpr std::size_t slab_size  = 64 * 1024;
+
+    MemoryPool();
+    MemoryPool(const MemoryPool&)            = delete;
+    MemoryPool& operator=(const MemoryPool&) = delete;
+
+    void* allocate(std::size_t size);
+    // `size` must be what the block was allocated with
+    void deallocate(void* data, std::size_t size);
+
+    struct Stats
+    {
+        std::size_t reserved         = 0; // Slab memory
+        std::size_t used             = 0; // Of which in blocks handed out
+        std::size_t requested        = 0; // Of which actually asked for
+        std::size_t large            = 0; // Live blocks too big to pool
+        std::size_t allocations      = 0; // Pooled, since the start
+        std::size_t free_list_hits   = 0; // Of which reused a freed block
+        std::size_t slab_allocations = 0;
+
+        // Share of the slabs not in use: freed blocks waiting for reuse,
+        // and what hasn't been carved yet
+        double fragmentation() const
+        {
+            return reserved ? 1.0 - double(used) / double(reserved) : 0.0;
+        }
+        // Share of the used blocks lost to rounding up to the size class
+        double rounding() const
+        {
+            return used ? 1.0 - double(requested) / double(used) : 0.0;
+        }
+    };
+    Stats stats() const;
+
+private:
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    struct SizeClass
+    {
+        mutable std::mutex mutex;
+        std::size_t block_size = 0;
+        FreeBlock* free        = nullptr;
+        char* carved           = nullptr; // Next uncarved block of the slab
+        char* slab_end         = nullptr;
+        std::vector<std::unique_ptr<char[]>> slabs;
+        std::size_t live           = 0; // Blocks handed out
+        std::size_t requested      = 0;
+        std::size_t allocations    = 0;
+        std::size_t free_list_hits = 0;
+    };
+
+    // 16 byte steps up to 128, then four classes per doubling
+    static constexpr std::size_t class_count = 28;
+
+    std::array<SizeClass, class_count> classes_;
+    std::array<std::uint8_t, max_pooled / 16 + 1> class_of_; // By 16 bytes
+    std::atomic<std::size_t> large_{0};
+};
+
+// The pool everything below allocates from. Never destroyed: containers
+// held by other statics may free into it at exit.
+MemoryPool& memory_pool();
+
+// immer heap on top of memory_pool().
+struct pool_heap
+{
+    template <typename... Tags>
+    static void* allocate(std::size_t size, Tags...)
+    {
+        return memory_pool().allocate(size);
+    }
+
+    template <typename... Tags>
+    static void deallocate(std::size_t size, void* data, Tags...)
+    {
+        memory_pool().deallocate(data, size);
+    }
+};
+
+// Like immer's default policy, with nodes coming from the pool.
+using pool_memory_policy = immer::memory_policy<immer::heap_policy<pool_heap>,
+                                                immer::default_refcount_policy,
+                                                immer::default_lock_policy>;
+
+// Standard allocator on top of memory_pool(), e.g. for std::allocate_shared.
+template <typename T>
+struct PoolAllocator
+{
+    using value_type = T;
+
+    PoolAllocator() = default;
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>&)
+    {
+    }
+
+    T* allocate(std::size_t n)
+    {
+        return static_cast<T*>(memory_pool().allocate(n * sizeof(T)));
+    }
+    void deallocate(T* data, std::size_t n)
+    {
+        memory_pool().deallocate(data, n * sizeof(T));
+    }
+
+    template <typename U>
+    bool operator==(const PoolAllocator<U>&) const
+    {
+        return true;
+    }
+};
@@ -1,32 +1,129 @@
 #include "persistence.hpp"
+#include "lz.hpp"
 #include "state.hpp" // Needs TodoItem definition for JSON
+#include "thread_pool.hpp"
 #include <fstream>
 #include <iostream> // For error reporting (can replace with logger later)
 #include <nlohmann/json.hpp> // JSON library
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #ifdef _WIN32
 #include <shlobj.h> // For SHGetFolderPath
 #include <windows.h>
 #else // Linux, macOS
+#include <cerrno>
 #include <cstdlib>
+#include <fcntl.h>
 #include <pwd.h>
+#include <sys/file.h>
 #include <sys/types.h>
 #include <unistd.h>
 #endif
 
 // --- JSON Serialization Helpers ---
 
+namespace {
+
+// Each distinct text is written once, to the file's "strings", and items
+// refer to it by position. The table is set up while an AppState is being
+// written or read, for the item converters to find.
+struct StringTable
+{
+    std::vector<InternedString> strings;
+    std::unordered_map<InternedString, std::size_t> positions; // Writing
+};
+
+thread_local StringTable* current_strings = nullptr;
+
+struct UsingStrings
+{
+    explicit UsingStrings(StringTable& table)
+        : previous(std::exchange(current_strings, &table))
+    {
+    }
+    ~UsingStrings() { current_strings = previous; }
+
+    StringTable* previous;
+};
+
+// Compresses and decompresses the blocks of a file
+ThreadPool& codec_pool()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+} // namespace
+
 // How to serialize/deserialize a single TodoItem
 // Place this *before* it's used by AppState's functions
 void to_json(nlohmann::json& j, const TodoItem& item)
 {
-    j = nlohmann::json{{"text", item.text}, {"done", item.done}};
+    j = nlohmann::json{{"id", item.id}, {"done", item.done}};
+    if (current_strings) {
+        auto& table       = *current_strings;
+        auto [at, is_new] = table.positions.emplace(item.text,
+                                                    table.strings.size());
+        if (is_new)
+            table.strings.push_back(item.text);
+        j["text"] = at->second;
+    } else {
+        j["text"] = std::string(item.text);
+    }
+    if (item.due != 0)
+        j["due"] = item.due;
+    if (item.priority != 0)
+        j["priority"] = item.priority;
+    if (item.done_at != 0)
+        j["done_at"] = item.done_at;
+    const auto& children = subtask_items(item);
+    if (!children.empty()) {
+        j["children"] =
+            std::vector<TodoItem>(children.begin(), children.end());
+    }
 }
 
 void from_json(const nlohmann::json& j, TodoItem& item)
 {
-    j.at("text").get_to(item.text);
+    // Files from before the strings table have the text inline
+    const auto& text = j.at("text");
+    if (text.is_number_unsigned() && current_strings)
+        item.text = current_strings->strings.at(text.get<std::size_t>());
+    else
+        item.text = text.get<std::string>();
     j.at("done").get_to(item.done);
+    // Older files have none of these; ids are assigned after loading
+    item.id       = j.value("id", std::uint64_t{0});
+    item.due      = j.value("due", std::int64_t{0});
+    item.priority = j.value("priority", 0);
+    item.done_at  = j.value("done_at", std::int64_t{0});
+    item.tags     = parse_tags(item.text); // Not stored, they're in the text
+    if (j.contains("children") && j["children"].is_array()) {
+        std::vector<TodoItem> children_vec =
+            j.at("children").get<std::vector<TodoItem>>();
+        TodoList children(children_vec.begin(), children_vec.end());
+        // Counts are computed once here, edits keep them up to date
+        Progress progress = list_progress(children);
+        item = with_subtasks(std::move(item), std::move(children), progress);
+    }
+}
+
+// Board columns other than the main list
+void to_json(nlohmann::json& j, const BoardColumn& column)
+{
+    std::vector<TodoItem> items_vec(column.items.begin(), column.items.end());
+    j = nlohmann::json{{"name", column.name}, {"todos", items_vec}};
+}
+
+void from_json(const nlohmann::json& j, BoardColumn& column)
+{
+    j.at("name").get_to(column.name);
+    std::vector<TodoItem> items_vec =
+        j.at("todos").get<std::vector<TodoItem>>();
+    column.items = TodoList(items_vec.begin(), items_vec.end());
+    column.selected_index = column.items.empty() ? -1 : 0;
 }
 
 // How to serialize/deserialize AppState (specifically its todos)
@@ -34,28 +131,53 @@ void to_json(nlohmann::json& j, const AppState& state)
 {
     // Convert immer::flex_vector to std::vector for serialization
     std::vector<TodoItem> todos_vec(state.todos.begin(), state.todos.end());
-    j = nlohmann::json{{"todos", todos_vec}}; // Only save todos
+    std::vector<BoardColumn> columns_vec(state.columns.begin(),
+                                         state.columns.end());
+    StringTable strings;
+    UsingStrings using_strings{strings};
+    j = nlohmann::json{{"todos", todos_vec}, {"columns", columns_vec}};
+    std::vector<std::string> texts;
+    texts.reserve(strings.strings.size());
+    for (const auto& text : strings.strings)
+        texts.emplace_back(text);
+    j["strings"] = std::move(texts);
 }
 
 void from_json(const nlohmann::json& j, AppState& state)
 {
+    StringTable strings;
+    UsingStrings using_strings{strings};
+    if (j.contains("strings") && j["strings"].is_array()) {
+        for (const auto& text : j["strings"])
+            strings.strings.emplace_back(text.get<std::string>());
+    }
     // Check if "todos" key exists and is an array
     if (j.contains("todos") && j["todos"].is_array()) {
         // Deserialize into a std::vector first
         std::vector<TodoItem> todos_vec =
             j.at("todos").get<std::vector<TodoItem>>();
         // Convert std::vector to immer::flex_vector
-        state.todos =
-            immer::flex_vector<TodoItem>(todos_vec.begin(), todos_vec.end());
+        state.todos = TodoList(todos_vec.begin(), todos_vec.end());
     } else {
         // Use spdlog eventually (warning)
         std::cerr << "Warning: State file format invalid or missing 'todos'. "
                      "Loading empty list."
                   << std::endl;
-        state.todos = immer::flex_vector<TodoItem>{}; // Ensure it's empty
+        state.todos = TodoList{}; // Ensure it's empty
+    }
+    // Files written before the board existed have no "columns"
+    if (j.contains("columns") && j["columns"].is_array()) {
+        std::vector<BoardColumn> columns_vec =
+            j.at("columns").get<std::vector<BoardColumn>>();
+        state.columns = immer::vector<BoardColumn>(columns_vec.begin(),
+                                                   columns_vec.end());
+    } else {
+        state.columns = default_board_columns();
     }
+    index_loaded_state(state);
     // Reset other fields to default or sensible values upon loading
     state.current_input  = "";
+    state.active_column  = 0;
     state.selected_index = state.todos.empty() ? -1 : 0;
     state.status_message = "State loaded."; // Updated status
     state.exit_requested = false;
@@ -133,20 +255,25 @@ std::filesystem::path get_default_data_path()
     return data_dir / filename;
 }
 
-bool save_state(const std::filesystem::path& path, const AppState& state)
+bool save_state(const std::filesystem::path& path,
+                const AppState& state,
+                Encoding encoding)
 {
     try {
         nlohmann::json j = state; // Use the defined to_json function
 
-        std::ofstream ofs(path);
+        std::ofstream ofs(path, std::ios::binary);
         if (!ofs) {
             // Use spdlog eventually
             std::cerr << "Error opening file for writing: " << path
                       << std::endl;
             return false;
         }
-        ofs << j.dump(4); // Pretty print with 4 spaces
-        return true;
+        std::string text = j.dump(4); // Pretty print with 4 spaces
+        if (encoding == Encoding::Compressed)
+            text = Lz::compress_frame(text, codec_pool());
+        ofs.write(text.data(), static_cast<std::streamsize>(text.size()));
+        return static_cast<bool>(ofs.flush());
     } catch (const nlohmann::json::exception& e) {
         // Use spdlog eventually
         std::cerr << "JSON serialization error: " << e.what() << std::endl;
@@ -169,7 +296,7 @@ std::optional<AppState> load_state(const std::filesystem::path& path)
     }
 
     try {
-        std::ifstream ifs(path);
+        std::ifstream ifs(path, std::ios::binary);
         if (!ifs) {
             // Use spdlog eventually
             std::cerr << "Error opening file for reading: " << path
@@ -177,8 +304,21 @@ std::optional<AppState> load_state(const std::filesystem::path& path)
             return std::nullopt;
         }
 
-        nlohmann::json j;
-        ifs >> j;
+        // Read whole, parsing from memory is faster than from the stream
+        std::string text(std::filesystem::file_size(path), '\0');
+        ifs.read(text.data(), static_cast<std::streamsize>(text.size()));
+        text.resize(static_cast<std::size_t>(ifs.gcount()));
+        if (Lz::is_frame(text)) {
+            auto unpacked = Lz::decompress_frame(text, codec_pool());
+            if (!unpacked) {
+                std::cerr << "Compressed state file is corrupt: " << path
+                          << std::endl;
+                return std::nullopt;
+            }
+            text = std::move(*unpacked);
+        }
+
+        nlohmann::json j = nlohmann::json::parse(text);
 
         // Use the defined from_json function
         AppState loaded_state = j.get<AppState>();
@@ -203,4 +343,67 @@ std::optional<AppState> load_state(const std::filesystem::path& path)
     }
 }
 
+std::vector<std::uint8_t> encode_state(const AppState& state)
+{
+    return nlohmann::json::to_cbor(nlohmann::json(state));
+}
+
+std::optional<AppState> decode_state(std::string_view bytes)
+{
+    try {
+        return nlohmann::json::from_cbor(bytes.begin(), bytes.end())
+            .get<AppState>();
+    } catch (const nlohmann::json::exception& e) {
+        std::cerr << "Embedded state error: " << e.what() << std::endl;
+        return std::nullopt;
+    }
+}
+
+FileLock::FileLock(const std::filesystem::path& path, bool wait)
+{
+#ifdef _WIN32
+    HANDLE handle = CreateFileW(path.c_str(),
+                                GENERIC_READ | GENERIC_WRITE,
+                                FILE_SHARE_READ | FILE_SHARE_WRITE |
+                                    FILE_SHARE_DELETE,
+                                nullptr,
+                                OPEN_ALWAYS,
+                                FILE_ATTRIBUTE_NORMAL,
+                                nullptr);
+    if (handle == INVALID_HANDLE_VALUE)
+        return;
+    handle_               = handle;
+    OVERLAPPED overlapped = {};
+    DWORD flags           = LOCKFILE_EXCLUSIVE_LOCK;
+    if (!wait)
+        flags |= LOCKFILE_FAIL_IMMEDIATELY;
+    locked_ = LockFileEx(handle, flags, 0, MAXDWORD, MAXDWORD, &overlapped);
+#else
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd_ < 0)
+        return;
+    int result;
+    while ((result = ::flock(fd_, wait ? LOCK_EX : LOCK_EX | LOCK_NB)) < 0 &&
+           errno == EINTR) {
+    }
+    locked_ = result == 0;
+#endif
+}
+
+FileLock::~FileLock()
+{
+#ifdef _WIN32
+    if (!handle_)
+        return;
+    if (locked_) {
+        OVERLAPPED overlapped = {};
+        UnlockFileEx(handle_, 0, MAXDWORD, MAXDWORD, &overlapped);
+    }
+    CloseHandle(handle_);
+#else
+    if (fd_ >= 0)
+        ::close(fd_); // Releases the lock
+#endif
+}
+
 } // namespace Persistence
@@ -1,14 +1,60 @@
 #pragma once
 
+#include <cstdint>
 #include <filesystem> // Requires C++17
 #include <optional>
 #include <string>
+#include <string_view>
+#include <vector>
 
 struct AppState;
 
 // Function declarations
 namespace Persistence {
+
+// How save_state writes a file. Compressed is the same JSON as an LZ frame
+// (see lz.hpp), several times smaller; load_state reads either.
+enum class Encoding
+{
+    Json,
+    Compressed,
+};
+
 std::filesystem::path get_default_data_path();
-bool save_state(const std::filesystem::path& path, const AppState& state);
+bool save_state(const std::filesystem::path& path,
+                const AppState& state,
+                Encoding encoding = Encoding::Json);
 std::optional<AppState> load_state(const std::filesystem::path& path);
+
+// A state in the file's format, as CBOR instead of text, for embedding it in
+// other files (action logs).
+std::vector<std::uint8_t> encode_state(const AppState& state);
+std::optional<AppState> decode_state(std::string_view bytes);
+
+// Exclusive lock on the file `path` (created if missing), held until
+// destroyed, so that instances sharing a directory (--shared) take turns at
+// the files they all append to. Advisory: it only keeps out others taking
+// it too. A file of its own next to the locked one, since Windows' locks
+// would also keep out the writes of the lock holder through other handles.
+class FileLock
+{
+public:
+    // Waits for whoever holds it, unless not `wait`: then it is only
+    // locked() if no one did
+    explicit FileLock(const std::filesystem::path& path, bool wait = true);
+    ~FileLock();
+
+    FileLock(const FileLock&)            = delete;
+    FileLock& operator=(const FileLock&) = delete;
+
+    bool locked() const { return locked_; }
+
+private:
+#ifdef _WIN32
+    void* handle_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+    bool locked_ = false;
+};
 } // namespace Persistence
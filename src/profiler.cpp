@@ -0,0 +1,107 @@
+#include "profiler.hpp"
+
+#include <fstream>
+#include <nlohmann/json.hpp>
+
+const char* frame_phase_name(FramePhase phase)
+{
+    switch (phase) {
+    case FramePhase::Input:
+        return "input";
+    case FramePhase::NewFrame:
+        return "new_frame";
+    case FramePhase::RenderUI:
+        return "render_ui";
+    case FramePhase::RenderDrawData:
+        return "render_draw_data";
+    case FramePhase::DrawScreen:
+        return "draw_screen";
+    }
+    return "?";
+}
+
+FrameProfiler::FrameProfiler() : origin_(std::chrono::steady_clock::now()) {}
+
+std::int64_t FrameProfiler::now_ns() const
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now() - origin_)
+        .count();
+}
+
+void FrameProfiler::begin_frame()
+{
+    frames_[current_]          = FrameTiming{};
+    frames_[current_].start_ns = now_ns();
+}
+
+void FrameProfiler::end_frame()
+{
+    auto& frame    = frames_[current_];
+    frame.total_ns = now_ns() - frame.start_ns;
+    current_       = (current_ + 1) % capacity;
+    if (count_ < capacity)
+        ++count_;
+}
+
+FrameProfiler::Zone::Zone(FrameProfiler& profiler, FramePhase phase)
+    : profiler_(profiler), phase_(phase), start_ns_(profiler.now_ns())
+{
+}
+
+FrameProfiler::Zone::~Zone()
+{
+    auto& frame = profiler_.frames_[profiler_.current_];
+    auto p      = static_cast<int>(phase_);
+    if (frame.phase_start_ns[p] < 0)
+        frame.phase_start_ns[p] = start_ns_;
+    frame.phase_ns[p] += profiler_.now_ns() - start_ns_;
+}
+
+const FrameTiming& FrameProfiler::frame(std::size_t i) const
+{
+    // The oldest frame is the one the next frame will overwrite
+    std::size_t oldest = count_ < capacity ? 0 : current_;
+    return frames_[(oldest + i) % capacity];
+}
+
+int FrameProfiler::worst() const
+{
+    int worst = -1;
+    for (std::size_t i = 0; i < count_; ++i) {
+        if (worst < 0 || frame(i).total_ns > frame(worst).total_ns)
+            worst = static_cast<int>(i);
+    }
+    return worst;
+}
+
+bool FrameProfiler::write_chrome_trace(const std::filesystem::path& path) const
+{
+    // Complete events ("ph": "X"), in microseconds: a frame, and its phases
+    // nested inside it
+    auto event = [](const char* name, std::int64_t start, std::int64_t dur) {
+        return nlohmann::json{{"name", name},
+                              {"ph", "X"},
+                              {"ts", start / 1000.0},
+                              {"dur", dur / 1000.0},
+                              {"pid", 1},
+                              {"tid", 1}};
+    };
+    auto events = nlohmann::json::array();
+    for (std::size_t i = 0; i < count_; ++i) {
+        const FrameTiming& timing = frame(i);
+        events.push_back(event("frame", timing.start_ns, timing.total_ns));
+        for (int p = 0; p < frame_phase_count; ++p) {
+            if (timing.phase_start_ns[p] >= 0)
+                events.push_back(
+                    event(frame_phase_name(static_cast<FramePhase>(p)),
+                          timing.phase_start_ns[p],
+                          timing.phase_ns[p]));
+        }
+    }
+
+    std::ofstream out(path);
+    out << nlohmann::json{{"traceEvents", std::move(events)},
+                          {"displayTimeUnit", "ms"}};
+    return static_cast<bool>(out);
+}
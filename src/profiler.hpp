@@ -0,0 +1,80 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+// What a frame of the UI loop spends its time on
+enum class FramePhase
+{
+    Input,          // Polling the terminal, firing reminders
+    NewFrame,       // ImGui::NewFrame
+    RenderUI,       // renderUI and ImGui::Render
+    RenderDrawData, // Rasterizing the draw lists into the screen
+    DrawScreen,     // Writing the screen to the terminal
+};
+constexpr int frame_phase_count = 5;
+
+const char* frame_phase_name(FramePhase phase);
+
+// Times in nanoseconds since the profiler was created
+struct FrameTiming
+{
+    std::int64_t start_ns = 0;
+    std::int64_t total_ns = 0; // From begin_frame() to end_frame()
+    // Of the first zone of each phase, -1 if the phase didn't run
+    std::array<std::int64_t, frame_phase_count> phase_start_ns{
+        -1, -1, -1, -1, -1};
+    std::array<std::int64_t, frame_phase_count> phase_ns{}; // All its zones
+};
+
+// Times the phases of the most recent frames, kept in a ring buffer, for the
+// timings overlay (T) and a Chrome trace of them written on exit. For the UI
+// thread only; recording a zone is two clock reads and nothing is allocated.
+class FrameProfiler
+{
+public:
+    static constexpr std::size_t capacity = 512; // About 17 s at 30 fps
+
+    FrameProfiler();
+
+    void begin_frame();
+    void end_frame();
+
+    // Adds the time until it goes out of scope to `phase` of the frame
+    class Zone
+    {
+    public:
+        Zone(FrameProfiler& profiler, FramePhase phase);
+        ~Zone();
+
+        Zone(const Zone&)            = delete;
+        Zone& operator=(const Zone&) = delete;
+
+    private:
+        FrameProfiler& profiler_;
+        FramePhase phase_;
+        std::int64_t start_ns_;
+    };
+
+    // Finished frames, oldest first
+    std::size_t size() const { return count_; }
+    const FrameTiming& frame(std::size_t i) const;
+
+    // Position of the slowest finished frame, or -1 if there is none
+    int worst() const;
+
+    // The finished frames as Chrome trace events, for chrome://tracing or
+    // Perfetto. False if the file can't be written.
+    bool write_chrome_trace(const std::filesystem::path& path) const;
+
+private:
+    std::int64_t now_ns() const;
+
+    std::chrono::steady_clock::time_point origin_;
+    std::array<FrameTiming, capacity> frames_{};
+    std::size_t current_ = 0; // Slot of the frame being recorded
+    std::size_t count_   = 0;
+};
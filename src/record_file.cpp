@@ -0,0 +1,132 @@
+#include "record_file.hpp"
+#include "lz.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <fstream>
+#include <vector>
+
+namespace RecordFile {
+
+void put(std::string& out, std::uint64_t value, int bytes)
+{
+    for (int i = 0; i < bytes; ++i)
+        out += static_cast<char>(value >> (8 * i));
+}
+
+std::uint64_t get(const char* in, int bytes)
+{
+    std::uint64_t value = 0;
+    for (int i = 0; i < bytes; ++i)
+        value |= std::uint64_t{static_cast<unsigned char>(in[i])} << (8 * i);
+    return value;
+}
+
+Ending scan(const std::filesystem::path& path,
+            const Format& format,
+            std::uint64_t& end,
+            const std::function<void(const Record&, const char*)>& fn)
+{
+    std::error_code error;
+    const std::uint64_t file_size = std::filesystem::file_size(path, error);
+    if (error || file_size <= end)
+        return Ending::Complete;
+    std::ifstream in(path, std::ios::binary);
+    std::vector<char> header(format.header_size);
+    while (end < file_size) {
+        if (end + format.header_size > file_size)
+            return Ending::CutShort;
+        std::string_view magic(header.data(), format.magic.size());
+        if (!in.seekg(static_cast<std::streamoff>(end)) ||
+            !in.read(header.data(),
+                     static_cast<std::streamsize>(header.size())) ||
+            (magic != format.magic &&
+             (format.other_magic.empty() || magic != format.other_magic))) {
+            spdlog::warn("{} is damaged at byte {}", path.string(), end);
+            return Ending::Damaged;
+        }
+        Record record;
+        record.offset      = end;
+        record.packed_size = static_cast<std::uint32_t>(
+            get(header.data() + format.sizes_at, 4));
+        record.size = static_cast<std::uint32_t>(
+            get(header.data() + format.sizes_at + 4, 4));
+        const std::uint64_t next =
+            end + format.header_size + record.packed_size;
+        if (next > file_size)
+            return Ending::CutShort;
+        fn(record, header.data());
+        end = next;
+    }
+    return Ending::Complete;
+}
+
+std::optional<std::string> read(const std::filesystem::path& path,
+                                const Format& format,
+                                const Record& record)
+{
+    std::ifstream in(path, std::ios::binary);
+    std::string packed(record.packed_size, '\0');
+    if (!in.seekg(static_cast<std::streamoff>(record.offset +
+                                              format.header_size)) ||
+        !in.read(packed.data(), record.packed_size)) {
+        spdlog::error("Could not read a record of {}", path.string());
+        return std::nullopt;
+    }
+    auto bytes = Lz::decompress(packed, record.size);
+    if (!bytes)
+        spdlog::error("A record of {} is corrupt", path.string());
+    return bytes;
+}
+
+Record frame(std::string& records,
+             std::uint64_t offset,
+             const Format& format,
+             std::string_view magic,
+             std::string_view fields,
+             std::string_view payload)
+{
+    const std::string packed = Lz::compress(payload);
+    const std::size_t before = format.sizes_at - magic.size();
+    Record record;
+    record.offset      = offset + records.size();
+    record.packed_size = static_cast<std::uint32_t>(packed.size());
+    record.size        = static_cast<std::uint32_t>(payload.size());
+    records += magic;
+    records += fields.substr(0, before);
+    put(records, packed.size(), 4);
+    put(records, payload.size(), 4);
+    records += fields.substr(before);
+    records += packed;
+    return record;
+}
+
+bool append(const std::filesystem::path& path,
+            std::uint64_t end,
+            Ending ending,
+            std::string_view records)
+{
+    if (ending == Ending::Damaged) {
+        spdlog::error("Not appending to {}, it is damaged at byte {}",
+                      path.string(),
+                      end);
+        return false;
+    }
+    std::error_code error;
+    if (std::filesystem::exists(path, error) &&
+        std::filesystem::file_size(path, error) != end) {
+        spdlog::warn("Dropping an unfinished record of {}", path.string());
+        std::filesystem::resize_file(path, end, error);
+        if (error)
+            return false;
+    }
+
+    std::ofstream out(path, std::ios::binary | std::ios::app);
+    out.write(records.data(), static_cast<std::streamsize>(records.size()));
+    out.flush();
+    if (!out)
+        spdlog::error("Could not append to {}", path.string());
+    return static_cast<bool>(out);
+}
+
+} // namespace RecordFile
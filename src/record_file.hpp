@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Files that are only ever appended to, a record at a time: the archive,
+// the history and the ops of each replica. A record is a header followed by
+// its payload, compressed with the LZ codec. The header starts with an
+// 8-byte magic, and holds the size of the payload packed and unpacked (u32
+// each) somewhere after it; what else it holds is up to the file. Integers
+// are little-endian.
+//
+// A crash while appending leaves a record cut short at the end of the file,
+// which would hide whatever is appended after it, so it is dropped before
+// the next append. A header that isn't one further in is damage: nothing is
+// appended to such a file, since truncating there would lose the good
+// records after it, and appending past it would bury the new ones with
+// them.
+namespace RecordFile {
+
+// The lowest `bytes` bytes of `value`, little-endian
+void put(std::string& out, std::uint64_t value, int bytes);
+std::uint64_t get(const char* in, int bytes);
+
+struct Format
+{
+    std::string_view magic;
+    std::string_view other_magic; // Of a second kind of record, if any
+    std::size_t header_size = 0;  // Magic included
+    std::size_t sizes_at    = 0;  // Of the payload's sizes in the header
+};
+
+struct Record
+{
+    std::uint64_t offset      = 0; // Of its header
+    std::uint32_t packed_size = 0;
+    std::uint32_t size        = 0; // Of the payload unpacked
+};
+
+// How the records of a file end: at its end, with one cut short by it, or
+// with a header that isn't one
+enum class Ending
+{
+    Complete,
+    CutShort,
+    Damaged,
+};
+
+// Calls fn(record, header) for each whole record from `end` on, and moves
+// `end` past it. Stops at the end of the file or the first record that
+// isn't whole. Scanning a file that doesn't exist finds nothing.
+Ending scan(const std::filesystem::path& path,
+            const Format& format,
+            std::uint64_t& end,
+            const std::function<void(const Record&, const char*)>& fn);
+
+// The payload of a record, unpacked; nullopt if it can't be read or is
+// corrupt
+std::optional<std::string> read(const std::filesystem::path& path,
+                                const Format& format,
+                                const Record& record);
+
+// Adds a record to `records`, which are to be appended at `offset`:
+// `magic`, then `fields`, the rest of its header with the payload's sizes
+// left out, then the payload. Returns where it will be.
+Record frame(std::string& records,
+             std::uint64_t offset,
+             const Format& format,
+             std::string_view magic,
+             std::string_view fields,
+             std::string_view payload);
+
+// Appends `records` to a file whose whole records end at `end`, as scanned
+// with `ending`. What comes after `end` is dropped first, unless the file
+// is damaged, and then nothing is appended.
+bool append(const std::filesystem::path& path,
+            std::uint64_t end,
+            Ending ending,
+            std::string_view records);
+
+} // namespace RecordFile
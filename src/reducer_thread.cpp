@@ -0,0 +1,89 @@
+#include "reducer_thread.hpp"
+
+#include <lager/event_loop/manual.hpp>
+#include <lager/store.hpp>
+
+#include <spdlog/spdlog.h>
+
+ReducerThread::ReducerThread(AppState initial_state)
+{
+    // Every slot starts out with the initial state so the consumer always
+    // has something to draw, even before the first batch is reduced.
+    auto initial = std::make_shared<const AppState>(initial_state);
+    for (auto& slot : slots_)
+        slot = initial;
+
+    thread_ = std::thread(
+        [this, state = std::move(initial_state)]() mutable {
+            run(std::move(state));
+        });
+}
+
+ReducerThread::~ReducerThread()
+{
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        stopping_ = true;
+    }
+    queue_cv_.notify_one();
+    if (thread_.joinable())
+        thread_.join();
+}
+
+void ReducerThread::dispatch(Action action)
+{
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        queue_.push_back(std::move(action));
+    }
+    queue_cv_.notify_one();
+}
+
+const AppState& ReducerThread::latest()
+{
+    if (middle_.load(std::memory_order_relaxed) & fresh_bit) {
+        auto previous = middle_.exchange(front_, std::memory_order_acq_rel);
+        front_        = previous & ~fresh_bit;
+    }
+    return *slots_[front_];
+}
+
+void ReducerThread::publish(const AppState& state)
+{
+    slots_[back_] = std::make_shared<const AppState>(state);
+    auto previous =
+        middle_.exchange(back_ | fresh_bit, std::memory_order_acq_rel);
+    back_ = previous & ~fresh_bit;
+    // Drop the stale snapshot here rather than on the render thread, so big
+    // states are released off the frame path.
+    slots_[back_].reset();
+}
+
+void ReducerThread::run(AppState initial_state)
+{
+    spdlog::info("Reducer thread started");
+    trace_thread_name("reducer");
+    auto store = lager::make_store<Action>(std::move(initial_state),
+                                           lager::with_manual_event_loop{},
+                                           lager::with_reducer(reducer));
+
+    std::vector<Action> batch;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            queue_cv_.wait(lock,
+                           [this] { return stopping_ || !queue_.empty(); });
+            if (queue_.empty() && stopping_)
+                break;
+            batch.swap(queue_);
+        }
+
+        // Reduce everything queued so far and publish only the final state;
+        // intermediate states of a burst are never seen by the renderer.
+        for (auto& action : batch)
+            store.dispatch(std::move(action));
+        batch.clear();
+        publish(store.get());
+    }
+    spdlog::info("Reducer thread finished");
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "state.hpp" // AppState, Action
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs the reducer (and its effects) on a dedicated thread.
+//
+// Actions are queued from the render thread and reduced in batches. After
+// each batch the resulting AppState is published through a triple buffer of
+// immutable snapshots: publishing and acquiring are a single atomic exchange
+// each, so neither side ever waits for the other. Since AppState is a value
+// built on persistent containers, handing a snapshot to another thread is
+// safe without any copying or locking of the state itself.
+class ReducerThread
+{
+public:
+    explicit ReducerThread(AppState initial_state);
+    ~ReducerThread(); // Drains pending actions, then joins
+
+    ReducerThread(const ReducerThread&)            = delete;
+    ReducerThread& operator=(const ReducerThread&) = delete;
+
+    // Thread-safe. The action is reduced asynchronously.
+    void dispatch(Action action);
+
+    // Latest published state. Must only be called from a single consumer
+    // (the render thread); the reference stays valid until the next call.
+    const AppState& latest();
+
+private:
+    using Snapshot = std::shared_ptr<const AppState>;
+
+    void run(AppState initial_state);
+    void publish(const AppState& state);
+
+    // Triple buffer: the producer owns `back_`, the consumer owns `front_`
+    // and `middle_` holds the slot index exchanged between them, with
+    // `fresh_bit` set when it carries a snapshot the consumer hasn't seen.
+    static constexpr unsigned fresh_bit = 4;
+    std::array<Snapshot, 3> slots_;
+    unsigned back_  = 0;
+    unsigned front_ = 1;
+    std::atomic<unsigned> middle_{2};
+
+    std::mutex queue_mutex_;
+    std::condition_variable queue_cv_;
+    std::vector<Action> queue_;
+    bool stopping_ = false;
+
+    std::thread thread_;
+};
@@ -0,0 +1,663 @@
+#include "replica.hpp"
+#include "hash.hpp"
+#include "list_diff.hpp"
+#include "list_ops.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+
+namespace {
+
+constexpr RecordFile::Format format = {"TODOROP1", {}, 28, 16};
+constexpr std::size_t op_size       = 25;
+constexpr int id_bits               = 64 - Replica::replica_bits;
+constexpr std::uint64_t replica_mask =
+    (std::uint64_t{1} << Replica::replica_bits) - 1;
+// Bytes of ops there must be at least before they are folded into a base
+constexpr std::uint64_t compact_after = 1 << 20;
+
+std::uint64_t max_id_of(const TodoList& items, std::uint32_t replica)
+{
+    std::uint64_t max_id = 0;
+    for (const auto& item : items) {
+        if (item.id >> id_bits == replica)
+            max_id = std::max(max_id, item.id);
+        max_id = std::max(max_id, max_id_of(subtask_items(item), replica));
+    }
+    return max_id;
+}
+
+} // namespace
+
+namespace Replica {
+
+std::string replica_name(std::uint32_t replica)
+{
+    char name[16];
+    std::snprintf(name, sizeof(name), "%06x", replica);
+    return name;
+}
+
+std::uint32_t new_replica_id()
+{
+    std::random_device random;
+    std::uint32_t id = 0;
+    while (id == 0)
+        id = static_cast<std::uint32_t>(random() & replica_mask);
+    return id;
+}
+
+std::uint64_t next_id(const AppState& state, std::uint32_t replica)
+{
+    std::uint64_t max_id = max_id_of(state.todos, replica);
+    for (const auto& column : state.columns)
+        max_id = std::max(max_id, max_id_of(column.items, replica));
+    return std::max(max_id + 1, (std::uint64_t{replica} << id_bits) + 1);
+}
+
+std::string encode(const Batch& batch)
+{
+    std::string payload;
+    payload.reserve(batch.ops.size() * op_size);
+    for (const Op& op : batch.ops) {
+        RecordFile::put(payload, static_cast<std::uint64_t>(op.kind), 1);
+        RecordFile::put(payload, op.stamp, 8);
+        RecordFile::put(payload, op.item, 8);
+        RecordFile::put(payload, op.after, 8);
+    }
+    AppState values;
+    values.todos   = TodoList(batch.values.begin(), batch.values.end());
+    values.columns = {};
+    auto bytes     = Persistence::encode_state(values);
+    payload.append(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    return payload;
+}
+
+std::optional<Batch> decode(std::string_view payload, std::size_t ops)
+{
+    if (payload.size() < ops * op_size)
+        return std::nullopt;
+    Batch batch;
+    batch.ops.reserve(ops);
+    std::size_t sets = 0;
+    for (std::size_t i = 0; i < ops; ++i) {
+        const char* at = payload.data() + i * op_size;
+        Op op;
+        op.kind  = static_cast<Op::Kind>(RecordFile::get(at, 1));
+        op.stamp = RecordFile::get(at + 1, 8);
+        op.item  = RecordFile::get(at + 9, 8);
+        op.after = RecordFile::get(at + 17, 8);
+        if (op.kind > Op::Kind::Remove)
+            return std::nullopt;
+        sets += op.kind == Op::Kind::Set;
+        batch.ops.push_back(op);
+    }
+    auto values = Persistence::decode_state(payload.substr(ops * op_size));
+    if (!values || values->todos.size() != sets)
+        return std::nullopt;
+    batch.values.assign(values->todos.begin(), values->todos.end());
+    return batch;
+}
+
+// --- Document ---
+
+Document::Document(std::uint32_t replica, const TodoList& base)
+    : replica_(replica)
+    , list_(base)
+    , clock_(base.size())
+    , base_size_(base.size())
+{
+    // A treap of the base in one pass, as a Cartesian tree: each slot takes
+    // as its left subtree the slots of lower priority on the right spine
+    slots_.reserve(base.size());
+    items_.reserve(base.size());
+    std::vector<std::uint32_t> spine;
+    for (const auto& item : base) {
+        const auto slot = static_cast<std::uint32_t>(slots_.size());
+        slots_.push_back({});
+        slots_[slot].stamp = Stamp{slot + 1} << replica_bits;
+        slots_[slot].item  = item.id;
+        slots_[slot].shown = 1;
+        items_[item.id]    = Item{0, slots_[slot].stamp, slot, true};
+
+        std::uint32_t below = none;
+        while (!spine.empty() && priority(spine.back()) < priority(slot)) {
+            below = spine.back();
+            spine.pop_back();
+        }
+        slots_[slot].left = below;
+        if (below != none)
+            slots_[below].parent = slot;
+        if (!spine.empty()) {
+            slots_[spine.back()].right = slot;
+            slots_[slot].parent        = spine.back();
+        }
+        spine.push_back(slot);
+    }
+    root_ = spine.empty() ? none : spine.front();
+    recount(root_);
+}
+
+Batch Document::update(const TodoList& from, const TodoList& to)
+{
+    Batch batch;
+    auto emit = [&](Op op, const TodoItem* value) {
+        apply(op, value);
+        batch.ops.push_back(op);
+        if (value)
+            batch.values.push_back(*value);
+    };
+    auto known = [&](std::uint64_t id) {
+        auto found = items_.find(id);
+        return found != items_.end() && found->second.slot != none;
+    };
+    // The slot of the closest item before `to[index]` that has one, where
+    // the item goes after
+    auto slot_before = [&](std::size_t index) -> Stamp {
+        while (index-- > 0) {
+            auto found = items_.find(to[index].id);
+            if (found != items_.end() && found->second.slot != none)
+                return slots_[found->second.slot].stamp;
+        }
+        return 0;
+    };
+
+    // In the order of `to`, so an item's predecessor has its slot already.
+    // An item edited in place keeps its slot unless it swapped places with
+    // another one edited next to it.
+    const ListDiff diff     = diff_lists(from, to);
+    std::size_t kept_before = 0; // One past the last item that kept its slot
+    for (const ListEdit& edit : diff.edits) {
+        if (edit.change == ListChange::Removed) {
+            const std::uint64_t id = from[edit.before].id;
+            if (known(id))
+                emit({Op::Kind::Remove, tick(), id}, nullptr);
+            continue;
+        }
+        const TodoItem& item = to[edit.after];
+        const bool was_known = known(item.id);
+        if (edit.change != ListChange::Moved || !was_known ||
+            !(from[edit.before] == item))
+            emit({Op::Kind::Set, tick(), item.id}, &item);
+        if (edit.change == ListChange::Changed && was_known &&
+            edit.before >= kept_before) {
+            kept_before = edit.before + 1;
+        } else {
+            const Stamp after = slot_before(edit.after);
+            emit({Op::Kind::Place, tick(), item.id, after}, nullptr);
+        }
+    }
+    return batch;
+}
+
+void Document::apply(const Batch& batch)
+{
+    std::size_t value = 0;
+    for (const Op& op : batch.ops) {
+        const TodoItem* set = nullptr;
+        if (op.kind == Op::Kind::Set) {
+            if (value == batch.values.size())
+                break;
+            set = &batch.values[value++];
+        }
+        apply(op, set);
+    }
+}
+
+void Document::apply(const Op& op, const TodoItem* value)
+{
+    clock_     = std::max(clock_, op.stamp >> replica_bits);
+    Item& item = items_[op.item];
+    switch (op.kind) {
+    case Op::Kind::Set: {
+        if (item.has_value && op.stamp <= item.value)
+            return;
+        TodoItem set = *value;
+        set.id       = op.item;
+        item.value   = op.stamp;
+        if (placed(item) && slots_[item.slot].shown) {
+            list_ = list_.set(rank(item.slot), std::move(set));
+        } else {
+            parked_[op.item] = std::move(set);
+            if (placed(item))
+                show(item.slot);
+        }
+        item.has_value = true;
+        return;
+    }
+    case Op::Kind::Remove:
+        if (op.stamp <= item.position)
+            return;
+        if (placed(item) && slots_[item.slot].shown)
+            hide(item.slot);
+        item.position = op.stamp;
+        return;
+    case Op::Kind::Place:
+        break;
+    }
+
+    if (slot_of(op.stamp) != none)
+        return; // Applied already
+    std::uint32_t at = first();
+    if (op.after != 0) {
+        const std::uint32_t after = slot_of(op.after);
+        if (after == none) {
+            waiting_[op.after].push_back(op);
+            return;
+        }
+        at = next(after);
+    }
+    // Past the slots inserted after the same one later, and theirs
+    while (at != none && slots_[at].stamp > op.stamp)
+        at = next(at);
+    const auto slot = static_cast<std::uint32_t>(slots_.size());
+    slots_.push_back({});
+    slots_[slot].stamp = op.stamp;
+    slots_[slot].item  = op.item;
+    stamps_.emplace(op.stamp, slot);
+    insert_before(slot, at);
+    if (op.stamp > item.position) {
+        if (placed(item) && slots_[item.slot].shown)
+            hide(item.slot);
+        item.position = op.stamp;
+        item.slot     = slot;
+        if (item.has_value)
+            show(slot);
+    }
+
+    if (auto found = waiting_.find(op.stamp); found != waiting_.end()) {
+        std::vector<Op> released = std::move(found->second);
+        waiting_.erase(found);
+        for (const Op& waited : released)
+            apply(waited, nullptr);
+    }
+}
+
+std::uint32_t Document::slot_of(Stamp stamp) const
+{
+    if ((stamp & replica_mask) == 0) {
+        const std::uint64_t index = stamp >> replica_bits;
+        return index >= 1 && index <= base_size_
+                   ? static_cast<std::uint32_t>(index - 1)
+                   : none;
+    }
+    auto found = stamps_.find(stamp);
+    return found == stamps_.end() ? none : found->second;
+}
+
+bool Document::placed(const Item& item) const
+{
+    return item.slot != none && slots_[item.slot].stamp == item.position;
+}
+
+Document::Stats Document::stats() const
+{
+    // A node of an unordered_map is its value and a pointer, and each
+    // bucket another
+    auto map_bytes = [](const auto& map, std::size_t value) {
+        return map.size() * (value + sizeof(void*)) +
+               map.bucket_count() * sizeof(void*);
+    };
+    Stats stats;
+    stats.slots   = slots_.size();
+    stats.removed = parked_.size();
+    for (const auto& [slot, ops] : waiting_)
+        stats.waiting += ops.size();
+    stats.metadata_bytes =
+        slots_.capacity() * sizeof(Slot) +
+        map_bytes(stamps_, sizeof(std::pair<Stamp, std::uint32_t>)) +
+        map_bytes(items_, sizeof(std::pair<std::uint64_t, Item>)) +
+        map_bytes(parked_, sizeof(std::pair<std::uint64_t, TodoItem>)) +
+        map_bytes(waiting_, sizeof(std::pair<Stamp, std::vector<Op>>)) +
+        stats.waiting * sizeof(Op);
+    return stats;
+}
+
+// --- The treap ---
+
+std::uint32_t Document::count(std::uint32_t slot) const
+{
+    return slot == none ? 0 : slots_[slot].count;
+}
+
+std::uint32_t Document::recount(std::uint32_t slot)
+{
+    if (slot == none)
+        return 0;
+    recount(slots_[slot].left);
+    recount(slots_[slot].right);
+    pull(slot);
+    return slots_[slot].count;
+}
+
+void Document::pull(std::uint32_t slot)
+{
+    slots_[slot].count = count(slots_[slot].left) +
+                         count(slots_[slot].right) + slots_[slot].shown;
+}
+
+std::uint64_t Document::priority(std::uint32_t slot) const
+{
+    return Hash::mix(slots_[slot].stamp);
+}
+
+std::uint32_t Document::first() const
+{
+    std::uint32_t slot = root_;
+    while (slot != none && slots_[slot].left != none)
+        slot = slots_[slot].left;
+    return slot;
+}
+
+std::uint32_t Document::next(std::uint32_t slot) const
+{
+    if (slots_[slot].right != none) {
+        slot = slots_[slot].right;
+        while (slots_[slot].left != none)
+            slot = slots_[slot].left;
+        return slot;
+    }
+    for (;;) {
+        const std::uint32_t parent = slots_[slot].parent;
+        if (parent == none || slots_[parent].left == slot)
+            return parent;
+        slot = parent;
+    }
+}
+
+std::size_t Document::rank(std::uint32_t slot) const
+{
+    std::size_t before = count(slots_[slot].left);
+    for (std::uint32_t parent = slots_[slot].parent; parent != none;
+         slot = parent, parent = slots_[slot].parent) {
+        if (slots_[parent].right == slot)
+            before += count(slots_[parent].left) + slots_[parent].shown;
+    }
+    return before;
+}
+
+// `slot` is new and shows nothing yet, so no count changes until it is
+// rotated up to where its priority puts it
+void Document::insert_before(std::uint32_t slot, std::uint32_t at)
+{
+    if (root_ == none) {
+        root_ = slot;
+        return;
+    }
+    std::uint32_t parent = at;
+    bool left            = true;
+    if (at == none || slots_[at].left != none) {
+        parent = at == none ? root_ : slots_[at].left;
+        while (slots_[parent].right != none)
+            parent = slots_[parent].right;
+        left = false;
+    }
+    (left ? slots_[parent].left : slots_[parent].right) = slot;
+    slots_[slot].parent = parent;
+    while (slots_[slot].parent != none &&
+           priority(slot) > priority(slots_[slot].parent))
+        rotate_up(slot);
+}
+
+void Document::rotate_up(std::uint32_t slot)
+{
+    const std::uint32_t parent = slots_[slot].parent;
+    const std::uint32_t above  = slots_[parent].parent;
+    if (slots_[parent].left == slot) {
+        const std::uint32_t moved = slots_[slot].right;
+        slots_[parent].left       = moved;
+        if (moved != none)
+            slots_[moved].parent = parent;
+        slots_[slot].right = parent;
+    } else {
+        const std::uint32_t moved = slots_[slot].left;
+        slots_[parent].right      = moved;
+        if (moved != none)
+            slots_[moved].parent = parent;
+        slots_[slot].left = parent;
+    }
+    slots_[parent].parent = slot;
+    slots_[slot].parent   = above;
+    if (above == none)
+        root_ = slot;
+    else if (slots_[above].left == parent)
+        slots_[above].left = slot;
+    else
+        slots_[above].right = slot;
+    pull(parent);
+    pull(slot);
+}
+
+void Document::show(std::uint32_t slot)
+{
+    auto parked = parked_.find(slots_[slot].item);
+    if (parked == parked_.end())
+        return;
+    set_shown(slot, true);
+    list_ = ListOps::insert_at(list_, rank(slot), std::move(parked->second));
+    parked_.erase(parked);
+}
+
+void Document::hide(std::uint32_t slot)
+{
+    const std::size_t at = rank(slot);
+    parked_[slots_[slot].item] = list_[at];
+    list_                      = ListOps::erase_range(list_, at, at + 1);
+    set_shown(slot, false);
+}
+
+void Document::set_shown(std::uint32_t slot, bool shown)
+{
+    if (slots_[slot].shown == shown)
+        return;
+    slots_[slot].shown = shown;
+    for (; slot != none; slot = slots_[slot].parent)
+        slots_[slot].count = slots_[slot].count + (shown ? 1 : -1);
+}
+
+// --- Shared ---
+
+Shared::Shared(std::filesystem::path directory,
+               std::uint32_t replica,
+               Persistence::Encoding encoding)
+    : directory_(std::move(directory))
+    , replica_(replica)
+    , name_(replica_name(replica))
+    , encoding_(encoding)
+{
+}
+
+std::optional<TodoList> Shared::sync(const TodoList& from, const TodoList& to)
+{
+    // Replicas take turns, so that none appends to a generation while
+    // another compacts it away
+    std::error_code error;
+    std::filesystem::create_directories(directory_, error);
+    Persistence::FileLock lock(directory_ / "lock");
+    if (!lock.locked()) {
+        spdlog::error("Could not lock {}", directory_.string());
+        return std::nullopt;
+    }
+    if (document_ && latest_generation() != generation_) {
+        // Compacted by another replica: the slots are the new base's now
+        document_.reset();
+        read_.clear();
+    }
+    if (!document_ && !open(from))
+        return std::nullopt;
+    merge();
+    Batch batch = document_->update(from, to);
+    if (!batch.ops.empty() && !append(batch)) {
+        // No one else will see these ops: start over from the files
+        spdlog::error("Could not append to {}", directory_.string());
+        document_.reset();
+        read_.clear();
+        return std::nullopt;
+    }
+
+    std::uint64_t ops = 0;
+    for (const auto& [file, read] : read_)
+        ops += read.end;
+    if (ops > compact_after && ops > base_size_)
+        compact();
+    return document_->items();
+}
+
+std::string Shared::base_name(std::uint64_t generation)
+{
+    return generation == 0 ? "base.json"
+                           : "base." + std::to_string(generation) + ".json";
+}
+
+std::string Shared::ops_stem(const std::string& replica,
+                             std::uint64_t generation)
+{
+    return generation == 0 ? replica
+                           : replica + "." + std::to_string(generation);
+}
+
+std::uint64_t Shared::latest_generation() const
+{
+    std::uint64_t latest = 0;
+    std::error_code error;
+    for (const auto& entry :
+         std::filesystem::directory_iterator(directory_, error)) {
+        const std::string name = entry.path().filename().string();
+        if (name.size() > 10 && name.compare(0, 5, "base.") == 0 &&
+            name.compare(name.size() - 5, 5, ".json") == 0) {
+            const std::string number = name.substr(5, name.size() - 10);
+            if (number.size() < 20 &&
+                number.find_first_not_of("0123456789") == std::string::npos)
+                latest = std::max(latest, std::stoull(number));
+        }
+    }
+    return latest;
+}
+
+bool Shared::open(const TodoList& base)
+{
+    generation_          = latest_generation();
+    const auto base_path = directory_ / base_name(generation_);
+    std::error_code error;
+    if (!std::filesystem::exists(base_path, error) &&
+        !write_base(base_path, base))
+        return false;
+    auto loaded = Persistence::load_state(base_path);
+    if (!loaded) {
+        spdlog::error("Could not read {}", base_path.string());
+        return false;
+    }
+    base_size_ = std::filesystem::file_size(base_path, error);
+    document_.emplace(replica_, loaded->todos);
+    spdlog::info("Replica {} of {}, from a base of {} items",
+                 name_,
+                 directory_.string(),
+                 loaded->todos.size());
+    return true;
+}
+
+bool Shared::write_base(const std::filesystem::path& path,
+                        const TodoList& items) const
+{
+    // Whole or not at all: readers take whichever base is there
+    auto temporary = path;
+    temporary += "." + name_ + ".tmp";
+    AppState state;
+    state.todos   = items;
+    state.columns = {};
+    std::error_code error;
+    const bool saved = Persistence::save_state(temporary, state, encoding_);
+    if (saved)
+        std::filesystem::rename(temporary, path, error);
+    if (!saved || error) {
+        spdlog::error("Could not write {}", path.string());
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    return true;
+}
+
+void Shared::compact()
+{
+    const std::uint64_t next = generation_ + 1;
+    const auto base_path     = directory_ / base_name(next);
+    if (!write_base(base_path, document_->items()))
+        return; // Stays as it is, and is tried again next time
+
+    // The new base has everything: what came before it goes
+    std::error_code error;
+    std::vector<std::filesystem::path> stale;
+    for (const auto& entry :
+         std::filesystem::directory_iterator(directory_, error)) {
+        const auto& path = entry.path();
+        if (path.extension() == ".ops" ||
+            (path.extension() == ".json" && path != base_path))
+            stale.push_back(path);
+    }
+    for (const auto& path : stale)
+        std::filesystem::remove(path, error);
+
+    spdlog::info("Compacted the ops of {} into a new base",
+                 directory_.string());
+    const TodoList items = document_->items();
+    generation_          = next;
+    base_size_           = std::filesystem::file_size(base_path, error);
+    document_.emplace(replica_, items);
+    read_.clear();
+}
+
+void Shared::merge()
+{
+    std::error_code error;
+    for (const auto& entry :
+         std::filesystem::directory_iterator(directory_, error)) {
+        const auto& path = entry.path();
+        if (path.extension() != ".ops")
+            continue;
+        // "<replica>.ops", or "<replica>.<generation>.ops" past the first
+        const std::string stem = path.stem().string();
+        const auto dot         = stem.find('.');
+        if (stem != ops_stem(stem.substr(0, dot), generation_))
+            continue;
+        Progress& read = read_[stem];
+        if (read.ending == RecordFile::Ending::Damaged)
+            continue;
+        read.ending = RecordFile::scan(
+            path,
+            format,
+            read.end,
+            [&](const RecordFile::Record& record, const char* header) {
+                const auto ops = RecordFile::get(header + 24, 4);
+                auto payload   = RecordFile::read(path, format, record);
+                auto batch = payload ? decode(*payload, ops) : std::nullopt;
+                if (!batch)
+                    spdlog::warn("A record of {} is corrupt", path.string());
+                else
+                    document_->apply(*batch);
+            });
+    }
+}
+
+bool Shared::append(const Batch& batch)
+{
+    const std::string stem = ops_stem(name_, generation_);
+    const auto path        = directory_ / (stem + ".ops");
+    Progress& own          = read_[stem];
+
+    std::string fields;
+    RecordFile::put(fields, batch.ops.back().stamp, 8);
+    RecordFile::put(fields, batch.ops.size(), 4);
+    std::string record;
+    RecordFile::frame(
+        record, own.end, format, format.magic, fields, encode(batch));
+    if (!RecordFile::append(path, own.end, own.ending, record))
+        return false;
+    own.end += record.size(); // Applied already
+    own.ending = RecordFile::Ending::Complete;
+    return true;
+}
+
+} // namespace Replica
@@ -0,0 +1,231 @@
+#pragma once
+
+#include "persistence.hpp" // Persistence::Encoding
+#include "record_file.hpp" // RecordFile::Ending
+#include "state.hpp"       // AppState, TodoItem, TodoList
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// One list edited by several instances of the app at once, each edit merged
+// with the others' rather than the last save winning. Each instance is a
+// replica of the list, and its edits are ops on a sequence CRDT (RGA, the
+// replicated growable array):
+//
+// - Items sit in slots, positions in the sequence. A slot is inserted after
+//   another one, or at the start, and stays there for good; moving an item
+//   places it in a new slot. Slots inserted after the same one are ordered
+//   newest first, so that every replica orders them the same, whatever order
+//   it learns of them in.
+// - What an item holds (its text, done, due date...) is set as a whole, and
+//   the latest set wins. So does the latest of placing and removing it.
+//
+// Every op has a stamp: a Lamport clock in the high 40 bits and the replica
+// in the low 24, which orders all ops and names the slots. Ops already
+// applied are ignored, so replicas that have seen the same ops have the same
+// list whatever order they saw them in. Applying an op takes O(log n), so
+// taking in the others' ops costs what they changed. Finding this replica's
+// own ops diffs its list before and after (see diff_lists), which reads the
+// items up to the first and from the last edit. Starting a replica reads the
+// base and replays every op since, which is what compaction (see Shared)
+// keeps in check.
+//
+// Item ids have to be unique across replicas: the ids a replica gives new
+// items start with its own id (see next_id). Subtasks go with their item;
+// board columns are not shared.
+namespace Replica {
+
+using Stamp = std::uint64_t;
+
+constexpr int replica_bits = 24;
+
+// A new id, at random; never 0, the base list's. An instance keeps its id
+// from one run to the next (see Workspace), so that it doesn't start a new
+// ops file every time.
+std::uint32_t new_replica_id();
+
+// Six hex digits, as the replica's files are named
+std::string replica_name(std::uint32_t replica);
+
+// The first id `replica` can give to a new item of `state`
+std::uint64_t next_id(const AppState& state, std::uint32_t replica);
+
+struct Op
+{
+    enum class Kind : std::uint8_t
+    {
+        Set,   // The item holds the next of Batch::values
+        Place, // The item goes in a new slot, `stamp`, after `after`
+        Remove,
+    };
+    Kind kind          = Kind::Set;
+    Stamp stamp        = 0;
+    std::uint64_t item = 0;
+    Stamp after        = 0; // 0 for the start of the list
+};
+
+// Ops of one replica, in the order it applied them
+struct Batch
+{
+    std::vector<Op> ops;
+    std::vector<TodoItem> values; // Of the Set ops, in order
+};
+
+// A batch as the payload of a record (see Shared), before compression;
+// decoding needs to be told how many ops there are
+std::string encode(const Batch& batch);
+std::optional<Batch> decode(std::string_view payload, std::size_t ops);
+
+// The list as one replica has it, and the slots behind it. The slots are a
+// treap in list order, each subtree counting the items it shows, so that
+// finding where a slot's item is in the list is O(log n). Not thread-safe.
+class Document
+{
+public:
+    // Every replica starts from the same `base`; its items get slots of
+    // replica 0, one after the other
+    Document(std::uint32_t replica, const TodoList& base);
+
+    const TodoList& items() const { return list_; }
+
+    // The ops that make `to` of `from`, this replica's list before it was
+    // edited, found by diffing them (see diff_lists), and applied
+    Batch update(const TodoList& from, const TodoList& to);
+
+    // Applies the ops of another replica. A slot inserted after a slot not
+    // known yet waits for it.
+    void apply(const Batch& batch);
+
+    struct Stats
+    {
+        std::size_t slots          = 0; // Including those moved out of
+        std::size_t removed        = 0; // Items kept for a later place
+        std::size_t waiting        = 0; // Ops
+        std::size_t metadata_bytes = 0; // Besides the list, roughly
+    };
+    Stats stats() const;
+
+private:
+    static constexpr std::uint32_t none = UINT32_MAX;
+
+    struct Slot
+    {
+        Stamp stamp          = 0;
+        std::uint64_t item   = 0;
+        std::uint32_t left   = none;
+        std::uint32_t right  = none;
+        std::uint32_t parent = none;
+        std::uint32_t shown : 1  = 0; // Holds its item
+        std::uint32_t count : 31 = 0; // Slots shown in its subtree
+    };
+
+    struct Item
+    {
+        Stamp value        = 0;    // Of the set it holds
+        Stamp position     = 0;    // Of the place or remove in effect
+        std::uint32_t slot = none; // Where it was last placed
+        bool has_value     = false;
+    };
+
+    Stamp tick() { return (++clock_ << replica_bits) | replica_; }
+    void apply(const Op& op, const TodoItem* value);
+    std::uint32_t slot_of(Stamp stamp) const;
+    bool placed(const Item& item) const;
+
+    // The treap
+    std::uint32_t count(std::uint32_t slot) const;
+    std::uint32_t recount(std::uint32_t slot);
+    void pull(std::uint32_t slot); // Its count, from its children's
+    std::uint64_t priority(std::uint32_t slot) const;
+    std::uint32_t first() const;
+    std::uint32_t next(std::uint32_t slot) const;
+    std::size_t rank(std::uint32_t slot) const; // Shown slots before it
+    void insert_before(std::uint32_t slot, std::uint32_t at);
+    void rotate_up(std::uint32_t slot);
+    void show(std::uint32_t slot);
+    void hide(std::uint32_t slot);
+    void set_shown(std::uint32_t slot, bool shown);
+
+    std::uint32_t replica_;
+    TodoList list_;
+    std::uint64_t clock_;
+    std::size_t base_size_;
+    std::vector<Slot> slots_;
+    std::uint32_t root_ = none;
+    std::unordered_map<Stamp, std::uint32_t> stamps_; // Past the base
+    std::unordered_map<std::uint64_t, Item> items_;
+    std::unordered_map<std::uint64_t, TodoItem> parked_; // Not shown
+    std::unordered_map<Stamp, std::vector<Op>> waiting_; // For a slot
+};
+
+// The replicas of a list sharing a directory, "<name>.replicas": the list
+// all of them started from, "base.json", and the ops of each, in
+// "<replica>.ops", which only that replica appends to. A replica learns of
+// the others' edits by reading what was appended to their files since it
+// last looked. Replicas take turns at syncing, holding "lock".
+//
+// Once the ops add up to more than the base, and to at least a MiB, the
+// replica that synced last folds them into a new base, of the next
+// generation: "base.<n>.json", with ops in "<replica>.<n>.ops". A base is
+// written aside and renamed into place, so the newest base there is is
+// always whole; the ops of older generations are ignored, then removed.
+// The other replicas notice the new base at their next sync and start over
+// from it.
+//
+// A record of ops (see RecordFile) is a header, "TODOROP1", the stamp of
+// its last op (u64), the size of the payload packed and unpacked (u32) and
+// how many ops it has (u32), all little-endian, followed by the payload
+// compressed with the LZ codec: the ops (kind as u8, stamp, item and after
+// as u64) and then the values set, in the list file's format (as CBOR).
+class Shared
+{
+public:
+    Shared(std::filesystem::path directory,
+           std::uint32_t replica,
+           Persistence::Encoding encoding);
+
+    // Merges this replica's edits, from `from` to `to`, with the others',
+    // and returns the merged list. The first call makes `from` the base if
+    // there is none yet. Nullopt if the directory can't be read or the ops
+    // written.
+    std::optional<TodoList> sync(const TodoList& from, const TodoList& to);
+
+private:
+    static std::string base_name(std::uint64_t generation);
+    // Of a replica's ops file
+    static std::string ops_stem(const std::string& replica,
+                                std::uint64_t generation);
+
+    // How far a replica's file has been read
+    struct Progress
+    {
+        std::uint64_t end         = 0;
+        RecordFile::Ending ending = RecordFile::Ending::Complete;
+    };
+
+    std::uint64_t latest_generation() const; // Of the bases there are
+    bool open(const TodoList& base);
+    bool write_base(const std::filesystem::path& path,
+                    const TodoList& items) const;
+    void merge();
+    bool append(const Batch& batch);
+    void compact();
+
+    std::filesystem::path directory_;
+    std::uint32_t replica_;
+    std::string name_; // Of this replica's files
+    Persistence::Encoding encoding_;
+    std::optional<Document> document_;
+    std::uint64_t generation_ = 0; // Of the base the document started from
+    std::uint64_t base_size_  = 0; // In bytes
+    // Of the files of that generation, this one's included
+    std::unordered_map<std::string, Progress> read_;
+};
+
+} // namespace Replica
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "list_ops.hpp"
+
+#include <immer/flex_vector.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+// Persistent ordered index: a flex_vector kept sorted by `Less`. The
+// RRB-tree's size tables make it an order-statistics tree, so both "find
+// the position of a key" and "get the i-th smallest entry" are logarithmic,
+// and inserting or erasing is a binary search plus an O(log n) splice.
+template <typename T, typename Less = std::less<T>>
+class SortedIndex
+{
+public:
+    using entries_t = immer::flex_vector<T>;
+
+    SortedIndex() = default;
+
+    // O(n log n), for building an index from scratch (e.g. when loading)
+    static SortedIndex from_unsorted(std::vector<T> values)
+    {
+        std::sort(values.begin(), values.end(), Less{});
+        SortedIndex index;
+        index.entries_ = entries_t(values.begin(), values.end());
+        return index;
+    }
+
+    const entries_t& entries() const { return entries_; }
+    std::size_t size() const { return entries_.size(); }
+    bool empty() const { return entries_.empty(); }
+
+    // i-th smallest entry
+    const T& operator[](std::size_t i) const { return entries_[i]; }
+
+    // Position of the first entry not less than `key`
+    std::size_t lower_bound(const T& key) const
+    {
+        std::size_t lo = 0, hi = entries_.size();
+        while (lo < hi) {
+            auto mid = lo + (hi - lo) / 2;
+            if (Less{}(entries_[mid], key))
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return lo;
+    }
+
+    bool contains(const T& key) const
+    {
+        auto i = lower_bound(key);
+        return i < entries_.size() && !Less{}(key, entries_[i]);
+    }
+
+    SortedIndex insert(T value) const
+    {
+        SortedIndex result;
+        result.entries_ =
+            ListOps::insert_at(entries_, lower_bound(value), std::move(value));
+        return result;
+    }
+
+    SortedIndex erase(const T& key) const
+    {
+        auto i = lower_bound(key);
+        if (i >= entries_.size() || Less{}(key, entries_[i]))
+            return *this;
+        SortedIndex result;
+        result.entries_ = ListOps::erase_range(entries_, i, i + 1);
+        return result;
+    }
+
+    bool operator==(const SortedIndex& other) const
+    {
+        return entries_ == other.entries_;
+    }
+
+private:
+    entries_t entries_;
+};
@@ -1,11 +1,20 @@
 #pragma once
 
-#include <filesystem> // Needed by effects
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <functional>
+#include <iterator>
 #include <immer/flex_vector.hpp>
+#include <immer/vector.hpp>
 #include <lager/context.hpp>
 #include <lager/effect.hpp>
+#include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_set>
 #include <utility>
 #include <variant>
 #include <vector>
@@ -14,27 +23,530 @@
 #include <spdlog/spdlog.h>
 
 // Forward declarations
-#include "persistence.hpp" // For Persistence::save_state/load_state
+#include "alloc_tracking.hpp"  // AllocPhaseScope
+#include "completions.hpp"     // CompletionTrie
+#include "interned_string.hpp" // InternedString
+#include "interval_set.hpp"    // IntervalSet
+#include "list_ops.hpp"        // ListOps::erase_range/insert_at
+#include "memory_pool.hpp"     // pool_memory_policy, PoolAllocator
+#include "sorted_index.hpp"    // SortedIndex
+#include "tags.hpp"            // TagMask, parse_tags
+#include "timing_wheel.hpp"    // Reminder, TimingWheel
+#include "trace.hpp"           // TraceScope
 
 // --- Data Structures ---
+// Completion counts of a subtree, shown as "done/total".
+struct Progress
+{
+    int done  = 0;
+    int total = 0;
+
+    Progress operator+(Progress other) const
+    {
+        return {done + other.done, total + other.total};
+    }
+    Progress operator-(Progress other) const
+    {
+        return {done - other.done, total - other.total};
+    }
+    bool operator==(const Progress&) const = default;
+};
+
+struct SubtaskNode; // Defined below, once TodoItem is complete
+
+// Children of a todo item. Plain todos have no node (and allocate nothing);
+// the node caches the progress of the whole subtree, so showing "k/n done"
+// never traverses it.
+struct Subtasks
+{
+    std::shared_ptr<const SubtaskNode> node;
+
+    bool operator==(const Subtasks& other) const;
+};
+
 struct TodoItem
 {
-    std::string text;
-    bool done                              = false;
+    InternedString text; // Shared by every item with the same text
+    bool done = false;
+    Subtasks subtasks;
+    std::uint64_t id = 0;     // Stable identity, see AppState::next_id
+    std::int64_t due = 0;     // Seconds since the epoch, 0 for none
+    int priority     = 0;     // 0 (none) to max_priority
+    TagMask tags;             // Parsed from the text
+    std::int64_t done_at = 0; // When it was marked done, 0 if not or unknown
     bool operator==(const TodoItem&) const = default;
 };
 
+// Nodes come from the memory pool: lists are built and dropped in bulk (on
+// load, on removing a subtree) and that way mostly recycle each other's
+// blocks.
+using TodoList = immer::flex_vector<TodoItem, pool_memory_policy>;
+
+constexpr int max_priority = 3;
+
+struct SubtaskNode
+{
+    TodoList items;
+    Progress progress; // Over all descendants
+};
+
+inline bool Subtasks::operator==(const Subtasks& other) const
+{
+    return node == other.node ||
+           (node && other.node && node->items == other.node->items);
+}
+
+// --- Subtask Helpers ---
+inline const TodoList& subtask_items(const TodoItem& item)
+{
+    static const TodoList no_items;
+    return item.subtasks.node ? item.subtasks.node->items : no_items;
+}
+
+inline Progress subtask_progress(const TodoItem& item)
+{
+    return item.subtasks.node ? item.subtasks.node->progress : Progress{};
+}
+
+// What an item contributes to the progress of its parent: itself and its
+// whole subtree.
+inline Progress progress_of(const TodoItem& item)
+{
+    return subtask_progress(item) + Progress{item.done ? 1 : 0, 1};
+}
+
+// Counts from scratch, O(size of the list). Only used when building lists
+// (e.g. loading); edits adjust the cached counts by a delta instead.
+inline Progress list_progress(const TodoList& items)
+{
+    Progress progress;
+    for (const auto& item : items)
+        progress = progress + progress_of(item);
+    return progress;
+}
+
+inline TodoItem
+with_subtasks(TodoItem item, TodoList items, Progress progress)
+{
+    item.subtasks.node =
+        items.empty() ? nullptr
+                      : std::allocate_shared<const SubtaskNode>(
+                            PoolAllocator<SubtaskNode>{},
+                            SubtaskNode{std::move(items), progress});
+    return item;
+}
+
+// --- Due Date Helpers ---
+// The due index holds a Reminder for every item that has a due date and is
+// not done yet, in every column and at every subtask level, ordered by due
+// time. It is updated along with each edit instead of being recomputed.
+using DueIndex = SortedIndex<Reminder>;
+
+inline std::optional<Reminder> reminder_of(const TodoItem& item)
+{
+    if (item.due == 0 || item.done)
+        return std::nullopt;
+    return Reminder{item.due, item.id, std::string(item.text)};
+}
+
+// Replaces the entry of `before` with the one of `after`, O(log n).
+inline DueIndex
+reindex_due(DueIndex index, const TodoItem& before, const TodoItem& after)
+{
+    auto old_entry = reminder_of(before);
+    auto new_entry = reminder_of(after);
+    if (old_entry == new_entry)
+        return index;
+    if (old_entry)
+        index = index.erase(*old_entry);
+    if (new_entry)
+        index = index.insert(*new_entry);
+    return index;
+}
+
+// Drops the entries of a removed item and of all its subtasks.
+inline DueIndex unindex_subtree(DueIndex index, const TodoItem& item)
+{
+    if (auto entry = reminder_of(item))
+        index = index.erase(*entry);
+    for (const auto& child : subtask_items(item))
+        index = unindex_subtree(std::move(index), child);
+    return index;
+}
+
+inline void collect_reminders(const TodoList& items,
+                              std::vector<Reminder>& reminders)
+{
+    for (const auto& item : items) {
+        if (auto entry = reminder_of(item))
+            reminders.push_back(std::move(*entry));
+        collect_reminders(subtask_items(item), reminders);
+    }
+}
+
+inline std::uint64_t max_item_id(const TodoList& items)
+{
+    std::uint64_t max_id = 0;
+    for (const auto& item : items)
+        max_id = std::max({max_id, item.id, max_item_id(subtask_items(item))});
+    return max_id;
+}
+
+// Gives every item without an id (e.g. from files saved before ids existed)
+// a fresh one.
+inline TodoList assign_missing_ids(const TodoList& items,
+                                   std::uint64_t& next_id)
+{
+    auto result = TodoList{}.transient();
+    for (auto item : items) {
+        if (item.id == 0)
+            item.id = next_id++;
+        if (item.subtasks.node) {
+            item = with_subtasks(
+                item,
+                assign_missing_ids(subtask_items(item), next_id),
+                subtask_progress(item));
+        }
+        result.push_back(std::move(item));
+    }
+    return result.persistent();
+}
+
+// --- Priority View ---
+// The main list ordered by priority, kept next to it so that the sorted view
+// is never re-sorted: each edit of a top-level item swaps its entry in
+// O(log n), and row i of the view is entries()[i], also O(log n). Entries
+// carry a copy of the item (cheap, it shares text and subtasks) so drawing
+// the view needs no lookups.
+struct PriorityEntry
+{
+    int priority     = 0;
+    std::uint64_t id = 0;
+    TodoItem item;
+
+    // Highest priority first, then in the order they were added
+    bool operator<(const PriorityEntry& other) const
+    {
+        return std::tie(other.priority, id) < std::tie(priority, other.id);
+    }
+    bool operator==(const PriorityEntry&) const = default;
+};
+
+using PriorityView = SortedIndex<PriorityEntry>;
+
+inline PriorityEntry priority_entry(const TodoItem& item)
+{
+    return {item.priority, item.id, item};
+}
+
+// A named kanban column. The classic list (AppState::todos) is always the
+// first column of the board, these are the ones that follow it.
+struct BoardColumn
+{
+    std::string name;
+    TodoList items;
+    int selected_index = -1;
+
+    bool operator==(const BoardColumn&) const = default;
+};
+
+inline immer::vector<BoardColumn> default_board_columns()
+{
+    return {BoardColumn{"In Progress"}, BoardColumn{"Done"}};
+}
+
+// A list of the workspace (see workspace.hpp) as shown on its tab. The counts
+// are those of its file, so lists that aren't open need not be loaded.
+struct ListInfo
+{
+    std::string name;
+    int items = -1; // Unknown until the list is opened or saved
+    int done  = 0;
+
+    bool operator==(const ListInfo&) const = default;
+};
+
+// Names are file names too: letters, digits, '-' and '_'
+inline bool valid_list_name(std::string_view name)
+{
+    return !name.empty() && name.size() <= 32 &&
+           std::all_of(name.begin(), name.end(), [](char c) {
+               return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                      (c >= '0' && c <= '9') || c == '-' || c == '_';
+           });
+}
+
 struct AppState
 {
-    immer::flex_vector<TodoItem> todos;
+    TodoList todos;
+    immer::vector<BoardColumn> columns = default_board_columns();
+    int active_column          = 0; // 0 is `todos`, c > 0 is columns[c - 1]
+    immer::vector<int> path;   // Parents of the open subtask list, if any
+    int nested_selected_index  = -1; // Selection in the open subtask list
     std::string current_input  = "";
     int selected_index         = -1;
+    IntervalSet marked;        // Multi-selection in the current list
+    int mark_anchor            = -1; // Start of a range being marked
     std::string status_message = "Ready";
     bool exit_requested        = false; // Flag for clean exit
+    std::uint64_t next_id      = 1; // Id of the next item added
+    DueIndex due_index;        // Pending due dates, see reminder_of
+    PriorityView priority_view; // Top level of `todos` by priority
+    std::string list_name = "todos"; // Which list of the workspace this is
+    immer::vector<ListInfo> lists;   // All of them, for the tabs
+    TodoList synced; // `todos` as last merged with other instances (--shared)
 
     bool operator==(const AppState&) const = default;
 };
 
+// --- Board Helpers ---
+// Columns are addressed by index: 0 is the main list, the rest are
+// AppState::columns. Item actions (add, toggle, remove...) apply to the
+// active column.
+inline int column_count(const AppState& state)
+{
+    return 1 + static_cast<int>(state.columns.size());
+}
+
+inline bool is_valid_column(const AppState& state, int column)
+{
+    return column >= 0 && column < column_count(state);
+}
+
+inline std::string column_name(const AppState& state, int column)
+{
+    return column == 0 ? "Todo" : state.columns[column - 1].name;
+}
+
+inline const TodoList& column_items(const AppState& state, int column)
+{
+    return column == 0 ? state.todos : state.columns[column - 1].items;
+}
+
+inline int column_selection(const AppState& state, int column)
+{
+    return column == 0 ? state.selected_index
+                       : state.columns[column - 1].selected_index;
+}
+
+// Replaces the items of a column, keeping its selection within bounds.
+inline void
+set_column(AppState& state, int column, TodoList items, int selected)
+{
+    if (items.empty())
+        selected = -1;
+    else if (selected >= static_cast<int>(items.size()))
+        selected = static_cast<int>(items.size()) - 1;
+    if (column == 0) {
+        state.todos          = std::move(items);
+        state.selected_index = selected;
+    } else {
+        state.columns =
+            state.columns.update(column - 1, [&](BoardColumn col) {
+                col.items          = std::move(items);
+                col.selected_index = selected;
+                return col;
+            });
+    }
+}
+
+// Derives ids and the due index for a freshly loaded state, O(n log n).
+inline void index_loaded_state(AppState& state)
+{
+    std::uint64_t max_id = max_item_id(state.todos);
+    for (const auto& column : state.columns)
+        max_id = std::max(max_id, max_item_id(column.items));
+    state.next_id = max_id + 1;
+
+    state.todos = assign_missing_ids(state.todos, state.next_id);
+    for (std::size_t i = 0; i < state.columns.size(); ++i) {
+        state.columns = state.columns.update(i, [&](BoardColumn column) {
+            column.items = assign_missing_ids(column.items, state.next_id);
+            return column;
+        });
+    }
+
+    std::vector<Reminder> reminders;
+    collect_reminders(state.todos, reminders);
+    for (const auto& column : state.columns)
+        collect_reminders(column.items, reminders);
+    state.due_index = DueIndex::from_unsorted(std::move(reminders));
+
+    std::vector<PriorityEntry> entries;
+    entries.reserve(state.todos.size());
+    for (const auto& item : state.todos)
+        entries.push_back(priority_entry(item));
+    state.priority_view = PriorityView::from_unsorted(std::move(entries));
+    state.synced        = state.todos;
+}
+
+// Swaps the priority view entry of a top-level item of `column` for a new
+// version of it. An item was added when `before` is null and removed when
+// `after` is.
+inline void reindex_priority(AppState& state,
+                             int column,
+                             const TodoItem* before,
+                             const TodoItem* after)
+{
+    if (column != 0)
+        return;
+    auto& view = state.priority_view;
+    if (before)
+        view = view.erase(priority_entry(*before));
+    if (after)
+        view = view.insert(priority_entry(*after));
+}
+
+// --- Subtask Navigation ---
+// The current list is the one item actions (add, toggle, remove...) apply
+// to: the active column, or the subtasks reached from it through `path`.
+inline const TodoList& current_list(const AppState& state)
+{
+    const TodoList* list = &column_items(state, state.active_column);
+    for (int index : state.path)
+        list = &subtask_items((*list)[index]);
+    return *list;
+}
+
+inline int current_selection(const AppState& state)
+{
+    return state.path.empty() ? column_selection(state, state.active_column)
+                              : state.nested_selected_index;
+}
+
+inline void set_current_selection(AppState& state, int selected)
+{
+    if (state.path.empty())
+        set_column(state, state.active_column, current_list(state), selected);
+    else
+        state.nested_selected_index = selected;
+}
+
+// Replaces the current list. `delta` is how much the progress of the list
+// changed: only the parents along `path` are rebuilt, each adjusting its
+// cached progress by it, so this is O(depth * log n).
+inline void set_current_list(AppState& state,
+                             TodoList items,
+                             int selected,
+                             Progress delta = {})
+{
+    if (state.path.empty()) {
+        set_column(state, state.active_column, std::move(items), selected);
+        return;
+    }
+
+    if (items.empty())
+        selected = -1;
+    else if (selected >= static_cast<int>(items.size()))
+        selected = static_cast<int>(items.size()) - 1;
+    state.nested_selected_index = selected;
+
+    std::vector<const TodoList*> parents;
+    parents.push_back(&column_items(state, state.active_column));
+    for (int index : state.path.take(state.path.size() - 1))
+        parents.push_back(&subtask_items((*parents.back())[index]));
+
+    TodoList list = std::move(items);
+    for (auto level = parents.size(); level-- > 0;) {
+        const TodoList& parent = *parents[level];
+        int index              = state.path[level];
+        const TodoItem& owner  = parent[index];
+        TodoItem updated       = with_subtasks(
+            owner, std::move(list), subtask_progress(owner) + delta);
+        if (level == 0)
+            reindex_priority(state, state.active_column, &owner, &updated);
+        list = parent.set(index, std::move(updated));
+    }
+    set_column(state,
+               state.active_column,
+               std::move(list),
+               column_selection(state, state.active_column));
+}
+
+// Keeps the priority view in step with an edit of the current list. Nested
+// lists are covered by set_current_list, which updates their top-level
+// ancestor.
+inline void reindex_current(AppState& state,
+                            const TodoItem* before,
+                            const TodoItem* after)
+{
+    if (state.path.empty())
+        reindex_priority(state, state.active_column, before, after);
+}
+
+// --- Multi-selection Helpers ---
+// Marked items of the current list, including the range being extended
+// from mark_anchor to the cursor.
+inline IntervalSet effective_marks(const AppState& state)
+{
+    int cursor = current_selection(state);
+    if (state.mark_anchor < 0 || cursor < 0)
+        return state.marked;
+    return state.marked.insert(std::min(state.mark_anchor, cursor),
+                               std::max(state.mark_anchor, cursor) + 1);
+}
+
+// Marks refer to positions, so they are dropped whenever items shift.
+inline void clear_marks(AppState& state)
+{
+    state.marked      = {};
+    state.mark_anchor = -1;
+}
+
+// --- Jumping to Items ---
+// Finds the item `id` in `items` or below, leaving in `path` the positions
+// of its ancestors and returning its position in its own list, -1 if absent.
+inline int
+find_item(const TodoList& items, std::uint64_t id, std::vector<int>& path)
+{
+    int position = 0;
+    for (const auto& item : items) {
+        if (item.id == id)
+            return position;
+        ++position;
+    }
+    position = 0;
+    for (const auto& item : items) {
+        if (item.subtasks.node) {
+            path.push_back(position);
+            int found = find_item(subtask_items(item), id, path);
+            if (found >= 0)
+                return found;
+            path.pop_back();
+        }
+        ++position;
+    }
+    return -1;
+}
+
+// Makes the list holding the item `id`, in whatever column and at whatever
+// level, the current one and selects the item there. Linear in the size of
+// the board, for jumping to an item from outside the current list.
+inline bool open_item(AppState& state, std::uint64_t id)
+{
+    for (int column = 0; column < column_count(state); ++column) {
+        std::vector<int> path;
+        int index = find_item(column_items(state, column), id, path);
+        if (index < 0)
+            continue;
+        if (column != state.active_column ||
+            !std::equal(path.begin(),
+                        path.end(),
+                        state.path.begin(),
+                        state.path.end()))
+            clear_marks(state);
+        state.active_column = column;
+        state.path          = {};
+        if (!path.empty()) {
+            set_current_selection(state, path.front());
+            state.path = immer::vector<int>(path.begin(), path.end());
+        }
+        set_current_selection(state, index);
+        return true;
+    }
+    return false;
+}
+
 // --- Actions --- (Same as before)
 struct SetInputTextAction
 {
@@ -44,12 +556,94 @@ struct AddTodoAction
 {};
 struct RemoveSelectedTodoAction
 {};
+// Toggles come with the time, as done items remember when they were done
 struct ToggleSelectedTodoAction
-{};
+{
+    std::int64_t now = 0; // Seconds since the epoch
+};
 struct SelectTodoAction
 {
     int index;
 };
+// Selects an item of the current list by id, e.g. from the priority view.
+// O(log n) when `at` is where the item is (callers that know keep an index
+// of positions, see main.cpp), linear in its position otherwise. An item
+// in another column or in subtasks is opened there, see open_item.
+struct SelectTodoByIdAction
+{
+    std::uint64_t id;
+    int at = -1; // Where the item is expected to be, if known
+};
+// Drill into the subtasks of the selected item, and back out again
+struct OpenSubtasksAction
+{};
+struct CloseSubtasksAction
+{};
+struct FocusColumnAction
+{
+    int column;
+};
+// Reorders the active list. `to` is the position the item (or the first item
+// of the range [begin, end)) ends up at.
+struct MoveTodoAction
+{
+    int from;
+    int to;
+};
+struct MoveRangeAction
+{
+    int begin;
+    int end;
+    int to;
+};
+// Multi-selection: marks are kept as an interval set over the active column
+// and bulk actions apply to all of them in a single reducer step.
+struct MarkTodoAction
+{
+    int index; // Toggles the mark
+};
+struct SetMarkAnchorAction
+{
+    int index; // -1 cancels the range
+};
+struct MarkRangeAction
+{
+    int begin;
+    int end;
+};
+struct ClearMarksAction
+{};
+struct ToggleMarkedAction
+{
+    std::int64_t now = 0;
+};
+struct RemoveMarkedAction
+{};
+// Moves one item within or between columns; `to_index` is the position the
+// item ends up at in the destination column.
+struct MoveColumnItemAction
+{
+    int from_column;
+    int index;
+    int to_column;
+    int to_index;
+};
+// Sets the due date of the selected item; 0 clears it
+struct SetDueAction
+{
+    std::int64_t due;
+};
+// Sets the priority of the selected item, clamped to [0, max_priority]
+struct SetPriorityAction
+{
+    int priority;
+};
+// Sent when the timing wheel fires. The reminder may be stale (the item was
+// done, removed or rescheduled since), the reducer checks the due index.
+struct ReminderDueAction
+{
+    Reminder reminder;
+};
 struct RequestSaveAction
 {};
 struct RequestLoadAction
@@ -59,6 +653,70 @@ struct LoadCompleteAction
     std::optional<AppState> loaded_state;
     std::string message;
 }; // Optional state
+// Switches to another list of the workspace, creating it if it's new
+struct OpenListAction
+{
+    std::string name;
+    std::uint64_t select_id = 0; // Item to select once it's open, if any
+};
+// The list `name` was opened (unless loading it failed), `lists` is the
+// workspace as it now is
+struct ListOpenedAction
+{
+    std::string name;
+    immer::vector<ListInfo> lists;
+    std::optional<AppState> loaded_state;
+    std::string message;
+    std::uint64_t select_id = 0;
+};
+// Moves the done items of the main list that are old enough (see
+// Workspace::archive) to the list's archive. Done items with no time of
+// completion (from older files) are counted as done `now`.
+struct ArchiveDoneAction
+{
+    std::int64_t now = 0;
+};
+// The items `ids` of the list `list` were written to its archive, and can go
+struct ArchivedAction
+{
+    std::string list;
+    std::vector<std::uint64_t> ids;
+};
+// The list `list` was saved as `saved` and merged with what other instances
+// sharing it did (see Workspace::save), which made it `merged`; `reminders`
+// are the due dates their edits brought in
+struct ListMergedAction
+{
+    std::string list;
+    std::optional<AppState> saved;
+    std::optional<AppState> merged;
+    std::vector<Reminder> reminders;
+};
+// The file of the list `list` was changed by another program (see
+// ListWatcher): it was `before` as last loaded or saved and is now `after`,
+// whose edits brought in `reminders`. Edits made here since `before` are
+// kept: the change is merged with them off the UI thread, see
+// merge_change_effect.
+struct ListChangedOnDiskAction
+{
+    std::string list;
+    std::optional<AppState> before;
+    std::optional<AppState> after;
+    std::vector<Reminder> reminders;
+};
+// The change of the list `list` on disk from `before` to `after` was merged
+// with the edits made here up to `edited` (see merge_changed_lists), which
+// made `merged`; `reminders` are the due dates the merge brought in. Merged
+// again if the list was edited meanwhile.
+struct ChangeMergedAction
+{
+    std::string list;
+    std::optional<AppState> before;
+    std::optional<AppState> after;
+    std::optional<AppState> edited;
+    std::optional<AppState> merged;
+    std::vector<Reminder> reminders;
+};
 struct SetStatusAction
 {
     std::string message;
@@ -67,91 +725,254 @@ struct QuitAction
 {};
 
 // SetInputTextAction, AddTodoAction, RemoveSelectedTodoAction,
-// ToggleSelectedTodoAction, SelectTodoAction, RequestSaveAction,
-// RequestLoadAction, LoadCompleteAction, SetStatusAction, QuitAction
+// ToggleSelectedTodoAction, SelectTodoAction, SelectTodoByIdAction,
+// MoveTodoAction, MoveRangeAction, MarkTodoAction, SetMarkAnchorAction,
+// MarkRangeAction, ClearMarksAction, ToggleMarkedAction, RemoveMarkedAction,
+// OpenSubtasksAction, CloseSubtasksAction, FocusColumnAction,
+// MoveColumnItemAction, SetDueAction, SetPriorityAction, ReminderDueAction,
+// RequestSaveAction, RequestLoadAction, LoadCompleteAction, OpenListAction,
+// ListOpenedAction, ArchiveDoneAction, ArchivedAction, ListMergedAction,
+// ListChangedOnDiskAction, ChangeMergedAction, SetStatusAction, QuitAction
 using Action = std::variant<SetInputTextAction,
                             AddTodoAction,
                             RemoveSelectedTodoAction,
                             ToggleSelectedTodoAction,
                             SelectTodoAction,
+                            SelectTodoByIdAction,
+                            MoveTodoAction,
+                            MoveRangeAction,
+                            MarkTodoAction,
+                            SetMarkAnchorAction,
+                            MarkRangeAction,
+                            ClearMarksAction,
+                            ToggleMarkedAction,
+                            RemoveMarkedAction,
+                            OpenSubtasksAction,
+                            CloseSubtasksAction,
+                            FocusColumnAction,
+                            MoveColumnItemAction,
+                            SetDueAction,
+                            SetPriorityAction,
+                            ReminderDueAction,
                             RequestSaveAction,
                             RequestLoadAction,
                             LoadCompleteAction,
+                            OpenListAction,
+                            ListOpenedAction,
+                            ArchiveDoneAction,
+                            ArchivedAction,
+                            ListMergedAction,
+                            ListChangedOnDiskAction,
+                            ChangeMergedAction,
                             SetStatusAction,
                             QuitAction>;
 
+// Names of the actions, by index in Action, for reports
+inline constexpr const char* action_names[] = {
+    "SetInputText",       "AddTodo",        "RemoveSelectedTodo",
+    "ToggleSelectedTodo", "SelectTodo",     "SelectTodoById",
+    "MoveTodo",           "MoveRange",      "MarkTodo",
+    "SetMarkAnchor",      "MarkRange",      "ClearMarks",
+    "ToggleMarked",       "RemoveMarked",   "OpenSubtasks",
+    "CloseSubtasks",      "FocusColumn",    "MoveColumnItem",
+    "SetDue",             "SetPriority",    "ReminderDue",
+    "RequestSave",        "RequestLoad",    "LoadComplete",
+    "OpenList",           "ListOpened",     "ArchiveDone",
+    "Archived",           "ListMerged",     "ListChangedOnDisk",
+    "ChangeMerged",       "SetStatus",      "Quit",
+};
+static_assert(std::size(action_names) == std::variant_size_v<Action>);
+
 // --- Effect Type Alias ---
 using AppEffect = lager::effect<Action>;
 
+// How the UI sends actions, independent of whether they are reduced by a
+// lager store on the same thread or by a ReducerThread.
+using Dispatch = std::function<void(Action)>;
+
+// While a session is being recorded (--record), every action is logged
+// before it is reduced, those dispatched by effects included. Owned by main.
+class ActionRecorder;
+inline ActionRecorder* global_action_recorder = nullptr;
+void record_action(ActionRecorder& recorder, const Action& action);
+
 // --- Reducer --- (Same signature and logic as before)
 inline std::pair<AppState, AppEffect>
 reducer(AppState current_state,
         const Action& action); // Implementation below or in .cpp
 
 // --- Effect Implementations ---
-// Now use spdlog directly. Need data_path.
 
-// We need a way for effects to know the data_path. Let's make it a static
-// variable within this translation unit, initialized from main.
-namespace { // Anonymous namespace to limit scope
-inline std::filesystem::path global_data_path;
+// The lists are files of a workspace, owned by main. Saving, loading and
+// switching lists go through it, so these effects are defined with it in
+// workspace.cpp. Note: effects run from several translation units (e.g. the
+// reducer thread) and must all see the same workspace.
+class Workspace;
+inline Workspace* global_workspace = nullptr;
+
+inline void initialize_workspace(Workspace* workspace)
+{
+    global_workspace = workspace;
+}
+
+// Saves the list `state` is
+AppEffect save_effect(AppState state_to_save);
+// Reads the list `name` back from its file
+AppEffect load_effect(std::string name);
+// Leaves the list `leaving` is (saving it if it changed) for the list `name`
+AppEffect
+open_list_effect(AppState leaving, std::string name, std::uint64_t select_id);
+// Appends the done items of `state` old enough at `now` to its archive
+AppEffect archive_effect(AppState state, std::int64_t now);
+// The change to the list `name` on disk, which made it `on_disk`, was taken
+// (see ListChangedOnDiskAction): that is what leaving it compares with now
+AppEffect took_change_effect(std::string name, AppState on_disk);
+// `state` with the edits someone else made to its lists on disk, from
+// `before` to `after`, merged into them: the edits made here since `before`
+// are kept, and win where both edited the same item. The due dates the
+// merge brought in go to `reminders`. O(n) to set up, plus what changed.
+AppState merge_changed_lists(const AppState& state,
+                             const AppState& before,
+                             const AppState& after,
+                             std::vector<Reminder>& reminders);
+
+// Changes on disk are read by a ListWatcher owned by main, when the lists
+// aren't shared; it also merges them with the edits made here, on a thread
+// of its own.
+class ListWatcher;
+inline ListWatcher* global_list_watcher = nullptr;
+
+inline void initialize_list_watcher(ListWatcher* watcher)
+{
+    global_list_watcher = watcher;
 }
 
-inline void initialize_persistence_path(const std::filesystem::path& path)
+// Merges `change` with the edits of `edited` (see merge_changed_lists) and
+// dispatches the result as a ChangeMergedAction. Off the UI thread but for
+// the watcher's absence; defined with it in list_watcher.cpp.
+AppEffect merge_change_effect(AppState edited, ListChangedOnDiskAction change);
+
+// Reminders are scheduled on a timing wheel owned by main, which also
+// advances it and turns what fires into ReminderDueActions.
+inline TimingWheel* global_reminders = nullptr;
+
+inline void initialize_reminders(TimingWheel* wheel)
 {
-    global_data_path = path;
-    spdlog::debug("Persistence path initialized: {}",
-                  global_data_path.string());
+    global_reminders = wheel;
 }
 
-inline AppEffect save_effect(AppState state_to_save)
+inline AppEffect schedule_reminders_effect(std::vector<Reminder> reminders)
 {
-    return [state_to_save](lager::context<Action> ctx) {
-        if (global_data_path.empty()) {
-            spdlog::error("Save effect failed: Data path not initialized!");
-            ctx.dispatch(SetStatusAction{"ERROR: Save path not configured."});
+    return [reminders](lager::context<Action>) {
+        if (!global_reminders) {
+            spdlog::warn("Reminders not initialized, {} not scheduled",
+                         reminders.size());
             return;
         }
-        spdlog::debug("Executing save effect to {}", global_data_path.string());
-        bool success = Persistence::save_state(global_data_path, state_to_save);
-        std::string msg =
-            success ? "State saved successfully." : "ERROR saving state!";
-        if (success)
-            spdlog::info("Save successful.");
-        else
-            spdlog::error("Save failed.");
-        ctx.dispatch(SetStatusAction{msg});
+        for (const auto& reminder : reminders)
+            global_reminders->schedule(reminder);
     };
 }
 
-inline AppEffect load_effect()
+// Texts of added todos feed the input's completions, owned by main.
+inline CompletionTrie* global_completions = nullptr;
+
+inline void initialize_completions(CompletionTrie* trie)
 {
-    return [](lager::context<Action> ctx) {
-        if (global_data_path.empty()) {
-            spdlog::error("Load effect failed: Data path not initialized!");
-            ctx.dispatch(LoadCompleteAction{
-                std::nullopt, "ERROR: Load path not configured."});
-            return;
-        }
-        spdlog::debug("Executing load effect from {}",
-                      global_data_path.string());
-        auto loaded_state_opt = Persistence::load_state(global_data_path);
-        std::string msg;
-        if (loaded_state_opt) {
-            msg = "State loaded successfully.";
-            spdlog::info("Load successful.");
-        } else {
-            msg = "ERROR loading state or file not found.";
-            spdlog::warn("Load failed or file not found.");
-        }
-        ctx.dispatch(LoadCompleteAction{loaded_state_opt, msg});
+    global_completions = trie;
+}
+
+// Every text in `items`, subtasks included; seeds the completions at startup
+inline void record_completions(CompletionTrie& trie, const TodoList& items)
+{
+    for (const auto& item : items) {
+        trie.insert(item.text);
+        record_completions(trie, subtask_items(item));
+    }
+}
+
+inline AppEffect record_completion_effect(std::string text)
+{
+    return [text](lager::context<Action>) {
+        if (global_completions)
+            global_completions->insert(text);
     };
 }
 
+// Replaces the lists of `state` with those of `loaded`, as loaded from a
+// file, and schedules its reminders
+inline AppEffect take_loaded_lists(AppState& state, const AppState& loaded)
+{
+    state.todos          = loaded.todos;
+    state.columns        = loaded.columns;
+    state.next_id        = loaded.next_id;
+    state.due_index      = loaded.due_index;
+    state.priority_view  = loaded.priority_view;
+    state.synced         = loaded.todos;
+    state.active_column  = 0;
+    state.path           = {};
+    state.selected_index = state.todos.empty() ? -1 : 0;
+    clear_marks(state);
+    const auto& pending = state.due_index.entries();
+    return schedule_reminders_effect(
+        std::vector<Reminder>(pending.begin(), pending.end()));
+}
+
+// Takes the lists of `changed`, a newer version of those of `state` that
+// someone else made, with its indexes. The selection stays on the same item
+// if it is still there.
+inline void take_changed_lists(AppState& state, const AppState& changed)
+{
+    const TodoList& todos = changed.todos;
+    int selected          = state.selected_index;
+    if (selected >= 0 && selected < static_cast<int>(state.todos.size())) {
+        const std::uint64_t id = state.todos[selected].id;
+        if (selected >= static_cast<int>(todos.size()) ||
+            todos[selected].id != id) {
+            int index = 0;
+            for (const auto& item : todos) {
+                if (item.id == id) {
+                    selected = index;
+                    break;
+                }
+                ++index;
+            }
+        }
+    }
+    if (!(state.columns == changed.columns)) {
+        state.columns = changed.columns;
+        state.path    = {};
+        if (!is_valid_column(state, state.active_column))
+            state.active_column = 0;
+    }
+    if (state.active_column == 0)
+        state.path = {};
+    state.next_id       = std::max(state.next_id, changed.next_id);
+    state.due_index     = changed.due_index;
+    state.priority_view = changed.priority_view;
+    state.synced        = changed.synced;
+    set_column(state, 0, todos, selected);
+    clear_marks(state);
+}
+
 // --- Reducer Implementation ---
 inline std::pair<AppState, AppEffect> reducer(AppState current_state,
                                               const Action& action)
 {
+    AllocPhaseScope reducing{AllocPhase::Reduce,
+                             static_cast<int>(action.index())};
+    TraceScope traced{action_names[action.index()], "reduce"};
+    // Only what was dispatched is recorded, not the actions an action is
+    // reduced to in turn (a MoveTodo is a MoveRange)
+    static thread_local int depth = 0;
+    if (global_action_recorder && depth == 0)
+        record_action(*global_action_recorder, action);
+    struct Nesting
+    {
+        Nesting() { ++depth; }
+        ~Nesting() { --depth; }
+    } nesting;
+
     // Use lager::match for action handling
     return lager::match(action)(
         // Each lambda handles one action type
@@ -162,46 +983,64 @@ inline std::pair<AppState, AppEffect> reducer(AppState current_state,
         },
         [&](AddTodoAction) -> std::pair<AppState, AppEffect> {
             AppState next_state = current_state;
+            AppEffect effect    = lager::noop;
             if (!next_state.current_input.empty()) {
-                next_state.todos = next_state.todos.push_back(
-                    {next_state.current_input, false});
+                effect = record_completion_effect(next_state.current_input);
+                TodoItem item{next_state.current_input, false};
+                item.id        = next_state.next_id++;
+                item.tags      = parse_tags(item.text);
+                reindex_current(next_state, nullptr, &item);
+                Progress delta = progress_of(item);
+                auto items =
+                    current_list(next_state).push_back(std::move(item));
+                int added = static_cast<int>(items.size()) - 1;
+                set_current_list(next_state, std::move(items), added, delta);
                 next_state.current_input  = "";
-                next_state.selected_index = next_state.todos.size() - 1;
                 next_state.status_message = "Todo added.";
             } else {
                 next_state.status_message = "Input is empty.";
             }
-            return {std::move(next_state), lager::noop};
+            return {std::move(next_state), effect};
         },
         [&](RemoveSelectedTodoAction) -> std::pair<AppState, AppEffect> {
             AppState next_state = current_state;
-            if (next_state.selected_index >= 0 &&
-                next_state.selected_index < next_state.todos.size()) {
-                size_t index_to_remove =
-                    static_cast<size_t>(next_state.selected_index);
-                next_state.todos = next_state.todos.erase(index_to_remove);
-                if (next_state.todos.empty()) {
-                    next_state.selected_index = -1;
-                } else if (next_state.selected_index >=
-                           next_state.todos.size()) {
-                    next_state.selected_index = next_state.todos.size() - 1;
-                }
+            const auto& items   = current_list(next_state);
+            int selected        = current_selection(next_state);
+            if (selected >= 0 && selected < items.size()) {
+                size_t index_to_remove = static_cast<size_t>(selected);
+                Progress delta = Progress{} - progress_of(items[selected]);
+                next_state.due_index =
+                    unindex_subtree(next_state.due_index, items[selected]);
+                reindex_current(next_state, &items[selected], nullptr);
+                set_current_list(next_state,
+                                 items.erase(index_to_remove),
+                                 selected,
+                                 delta);
+                clear_marks(next_state);
                 next_state.status_message = "Todo removed.";
             } else {
                 next_state.status_message = "No item selected to remove.";
             }
             return {std::move(next_state), lager::noop};
         },
-        [&](ToggleSelectedTodoAction) -> std::pair<AppState, AppEffect> {
+        [&](ToggleSelectedTodoAction act) -> std::pair<AppState, AppEffect> {
             AppState next_state = current_state;
-            if (next_state.selected_index >= 0 &&
-                next_state.selected_index < next_state.todos.size()) {
-                size_t index_to_toggle =
-                    static_cast<size_t>(next_state.selected_index);
-                TodoItem updated_item = next_state.todos[index_to_toggle];
-                updated_item.done     = !updated_item.done;
-                next_state.todos =
-                    next_state.todos.set(index_to_toggle, updated_item);
+            const auto& items   = current_list(next_state);
+            int selected        = current_selection(next_state);
+            if (selected >= 0 && selected < items.size()) {
+                size_t index_to_toggle = static_cast<size_t>(selected);
+                TodoItem updated_item  = items[index_to_toggle];
+                updated_item.done      = !updated_item.done;
+                updated_item.done_at   = updated_item.done ? act.now : 0;
+                Progress delta{updated_item.done ? 1 : -1, 0};
+                next_state.due_index = reindex_due(
+                    next_state.due_index, items[index_to_toggle], updated_item);
+                reindex_current(
+                    next_state, &items[index_to_toggle], &updated_item);
+                set_current_list(next_state,
+                                 items.set(index_to_toggle, updated_item),
+                                 selected,
+                                 delta);
                 next_state.status_message = "Todo toggled.";
             } else {
                 next_state.status_message = "No item selected to toggle.";
@@ -210,8 +1049,308 @@ inline std::pair<AppState, AppEffect> reducer(AppState current_state,
         },
         [&](SelectTodoAction act) -> std::pair<AppState, AppEffect> {
             AppState next_state = current_state;
-            if (act.index >= -1 && act.index < next_state.todos.size()) {
-                next_state.selected_index = act.index;
+            const auto& items   = current_list(next_state);
+            if (act.index >= -1 && act.index < items.size()) {
+                set_current_selection(next_state, act.index);
+            }
+            return {std::move(next_state), lager::noop};
+        },
+        [&](SelectTodoByIdAction act) -> std::pair<AppState, AppEffect> {
+            AppState next_state = current_state;
+            const auto& items   = current_list(next_state);
+            if (act.at >= 0 && act.at < static_cast<int>(items.size()) &&
+                items[act.at].id == act.id) {
+                set_current_selection(next_state, act.at);
+                return {std::move(next_state), lager::noop};
+            }
+            auto found = std::find_if(
+                items.begin(), items.end(), [&](const TodoItem& item) {
+                    return item.id == act.id;
+                });
+            if (found != items.end()) {
+                set_current_selection(
+                    next_state, static_cast<int>(found - items.begin()));
+            } else if (open_item(next_state, act.id)) {
+                next_state.status_message =
+                    "Found in " +
+                    column_name(next_state, next_state.active_column) +
+                    (next_state.path.empty() ? "." : ", in subtasks.");
+            }
+            return {std::move(next_state), lager::noop};
+        },
+        [&](MoveTodoAction act) -> std::pair<AppState, AppEffect> {
+            return reducer(current_state,
+                           MoveRangeAction{act.from, act.from + 1, act.to});
+        },
+        [&](MoveRangeAction act) -> std::pair<AppState, AppEffect> {
+            AppState next_state = current_state;
+            const auto& items   = current_list(next_state);
+            int size            = static_cast<int>(items.size());
+            if (act.begin < 0 || act.begin >= act.end || act.end > size) {
+                next_state.status_message = "Nothing to move.";
+                return {std::move(next_state), lager::noop};
+            }
+            int to = std::clamp(act.to, 0, size - (act.end - act.begin));
+            // The selection travels with the moved items, or shifts over
+            // them when it sits between the block and its target, and the
+            // marks follow when they are exactly the moved block
+            int length   = act.end - act.begin;
+            int selected = current_selection(next_state);
+            if (selected >= act.begin && selected < act.end) {
+                selected += to - act.begin;
+            } else if (selected >= 0) {
+                int rest = selected < act.begin ? selected : selected - length;
+                selected = rest < to ? rest : rest + length;
+            }
+            bool marks_follow =
+                effective_marks(next_state).intervals() ==
+                IntervalSet::intervals_t{Interval{act.begin, act.end}};
+            set_current_list(next_state,
+                             ListOps::move_range(items, act.begin, act.end, to),
+                             selected);
+            clear_marks(next_state);
+            if (marks_follow) {
+                next_state.marked = next_state.marked.insert(
+                    to, to + length);
+            }
+            next_state.status_message = "Todo moved.";
+            return {std::move(next_state), lager::noop};
+        },
+        [&](MarkTodoAction act) -> std::pair<AppState, AppEffect> {
+            AppState next_state = current_state;
+            const auto& items   = current_list(next_state);
+            if (act.index >= 0 && act.index < items.size()) {
+                next_state.marked = next_state.marked.toggle(act.index);
+            }
+            return {std::move(next_state), lager::noop};
+        },
+        [&](SetMarkAnchorAction act) -> std::pair<AppState, AppEffect> {
+            AppState next_state = current_state;
+            const auto& items   = current_list(next_state);
+            if (act.index >= -1 && act.index < items.size()) {
+                next_state.mark_anchor = act.index;
+            }
+            return {std::move(next_state), lager::noop};
+        },
+        [&](MarkRangeAction act) -> std::pair<AppState, AppEffect> {
+            AppState next_state = current_state;
+            const auto& items   = current_list(next_state);
+            int end = std::min(act.end, static_cast<int>(items.size()));
+            next_state.marked =
+                next_state.marked.insert(std::max(act.begin, 0), end);
+            next_state.mark_anchor    = -1;
+            next_state.status_message =
+                std::to_string(next_state.marked.count()) + " marked.";
+            return {std::move(next_state), lager::noop};
+        },
+        [&](ClearMarksAction) -> std::pair<AppState, AppEffect> {
+            AppState next_state = current_state;
+            clear_marks(next_state);
+            return {std::move(next_state), lager::noop};
+        },
+        [&](ToggleMarkedAction act) -> std::pair<AppState, AppEffect> {
+            AppState next_state = current_state;
+            const auto& items   = current_list(next_state);
+            auto marks          = effective_marks(next_state).erase(
+                static_cast<int>(items.size()), INT_MAX);
+            if (marks.empty()) {
+                next_state.status_message = "Nothing marked.";
+                return {std::move(next_state), lager::noop};
+            }
+            // Mark everything done, unless it already is: then undo them all
+            int undone = 0;
+            for (const auto& iv : marks.intervals()) {
+                undone += std::count_if(
+                    items.begin() + iv.begin,
+                    items.begin() + iv.end,
+                    [](const TodoItem& t) { return !t.done; });
+            }
+            bool all_done = undone == 0;
+            Progress delta{all_done ? -marks.count() : undone, 0};
+            auto toggled = ListOps::update_ranges(
+                items, marks.intervals(), [&](TodoItem item) {
+                    TodoItem before      = item;
+                    item.done            = !all_done;
+                    item.done_at         = item.done ? act.now : 0;
+                    next_state.due_index =
+                        reindex_due(next_state.due_index, before, item);
+                    reindex_current(next_state, &before, &item);
+                    return item;
+                });
+            set_current_list(next_state,
+                             std::move(toggled),
+                             current_selection(next_state),
+                             delta);
+            next_state.marked         = marks;
+            next_state.mark_anchor    = -1;
+            next_state.status_message = std::to_string(marks.count()) +
+                                        (all_done ? " todos marked undone."
+                                                  : " todos marked done.");
+            return {std::move(next_state), lager::noop};
+        },
+        [&](RemoveMarkedAction) -> std::pair<AppState, AppEffect> {
+            AppState next_state = current_state;
+            const auto& items   = current_list(next_state);
+            auto marks          = effective_marks(next_state).erase(
+                static_cast<int>(items.size()), INT_MAX);
+            if (marks.empty()) {
+                next_state.status_message = "Nothing marked.";
+                return {std::move(next_state), lager::noop};
+            }
+            // The cursor stays on the same item, or the one after it
+            int selected = current_selection(next_state);
+            int shift    = 0;
+            Progress delta;
+            for (const auto& iv : marks.intervals()) {
+                if (iv.begin < selected)
+                    shift += std::min(iv.end, selected) - iv.begin;
+                std::for_each(items.begin() + iv.begin,
+                              items.begin() + iv.end,
+                              [&](const TodoItem& item) {
+                                  delta = delta - progress_of(item);
+                                  next_state.due_index = unindex_subtree(
+                                      next_state.due_index, item);
+                                  reindex_current(next_state, &item, nullptr);
+                              });
+            }
+            set_current_list(next_state,
+                             ListOps::erase_ranges(items, marks.intervals()),
+                             selected - shift,
+                             delta);
+            clear_marks(next_state);
+            next_state.status_message =
+                std::to_string(marks.count()) + " todos removed.";
+            return {std::move(next_state), lager::noop};
+        },
+        [&](OpenSubtasksAction) -> std::pair<AppState, AppEffect> {
+            AppState next_state = current_state;
+            const auto& items   = current_list(next_state);
+            int selected        = current_selection(next_state);
+            if (selected >= 0 && selected < items.size()) {
+                const auto& children = subtask_items(items[selected]);
+                next_state.path      = next_state.path.push_back(selected);
+                next_state.nested_selected_index = children.empty() ? -1 : 0;
+                clear_marks(next_state);
+                next_state.status_message =
+                    "Subtasks of: " + std::string(items[selected].text);
+            } else {
+                next_state.status_message = "No item selected to open.";
+            }
+            return {std::move(next_state), lager::noop};
+        },
+        [&](CloseSubtasksAction) -> std::pair<AppState, AppEffect> {
+            AppState next_state = current_state;
+            if (!next_state.path.empty()) {
+                // Go back up with the parent we came from selected
+                int parent      = next_state.path.back();
+                next_state.path =
+                    next_state.path.take(next_state.path.size() - 1);
+                set_current_selection(next_state, parent);
+                clear_marks(next_state);
+                next_state.status_message = next_state.path.empty()
+                                                ? "Back to the top level."
+                                                : "Back to the parent task.";
+            }
+            return {std::move(next_state), lager::noop};
+        },
+        [&](FocusColumnAction act) -> std::pair<AppState, AppEffect> {
+            AppState next_state = current_state;
+            if (is_valid_column(next_state, act.column) &&
+                act.column != next_state.active_column) {
+                next_state.active_column = act.column;
+                next_state.path          = {};
+                clear_marks(next_state);
+            }
+            return {std::move(next_state), lager::noop};
+        },
+        [&](MoveColumnItemAction act) -> std::pair<AppState, AppEffect> {
+            AppState next_state = current_state;
+            if (!next_state.path.empty()) {
+                // Only whole top-level items move between columns
+                next_state.status_message = "Leave the subtasks first.";
+                return {std::move(next_state), lager::noop};
+            }
+            if (!is_valid_column(next_state, act.from_column) ||
+                !is_valid_column(next_state, act.to_column) ||
+                act.index < 0 ||
+                act.index >= column_items(next_state, act.from_column).size()) {
+                next_state.status_message = "Nothing to move.";
+                return {std::move(next_state), lager::noop};
+            }
+            // Slice the item out and splice it into place, both O(log n).
+            const auto& from = column_items(next_state, act.from_column);
+            TodoItem item    = from[act.index];
+            reindex_priority(next_state, act.from_column, &item, nullptr);
+            reindex_priority(next_state, act.to_column, nullptr, &item);
+            auto source =
+                ListOps::erase_range(from, act.index, act.index + 1);
+            set_column(next_state,
+                       act.from_column,
+                       source,
+                       column_selection(next_state, act.from_column));
+            clear_marks(next_state);
+
+            const auto& to = column_items(next_state, act.to_column);
+            int to_index =
+                std::clamp(act.to_index, 0, static_cast<int>(to.size()));
+            set_column(next_state,
+                       act.to_column,
+                       ListOps::insert_at(to, to_index, std::move(item)),
+                       to_index);
+            next_state.active_column = act.to_column;
+            next_state.status_message =
+                act.from_column == act.to_column
+                    ? "Todo moved."
+                    : "Todo moved to " +
+                          column_name(next_state, act.to_column) + ".";
+            return {std::move(next_state), lager::noop};
+        },
+        [&](SetDueAction act) -> std::pair<AppState, AppEffect> {
+            AppState next_state = current_state;
+            const auto& items   = current_list(next_state);
+            int selected        = current_selection(next_state);
+            if (selected < 0 || selected >= items.size()) {
+                next_state.status_message = "No item selected.";
+                return {std::move(next_state), lager::noop};
+            }
+            TodoItem updated_item = items[selected];
+            updated_item.due      = std::max<std::int64_t>(act.due, 0);
+            next_state.due_index  = reindex_due(
+                next_state.due_index, items[selected], updated_item);
+            reindex_current(next_state, &items[selected], &updated_item);
+            auto reminder = reminder_of(updated_item);
+            set_current_list(
+                next_state, items.set(selected, updated_item), selected);
+            next_state.status_message =
+                updated_item.due ? "Due date set." : "Due date cleared.";
+            // The old wheel entry, if any, is left to fire and be ignored
+            AppEffect effect = lager::noop;
+            if (reminder)
+                effect = schedule_reminders_effect({std::move(*reminder)});
+            return {std::move(next_state), effect};
+        },
+        [&](SetPriorityAction act) -> std::pair<AppState, AppEffect> {
+            AppState next_state = current_state;
+            const auto& items   = current_list(next_state);
+            int selected        = current_selection(next_state);
+            if (selected < 0 || selected >= items.size()) {
+                next_state.status_message = "No item selected.";
+                return {std::move(next_state), lager::noop};
+            }
+            TodoItem updated_item = items[selected];
+            updated_item.priority = std::clamp(act.priority, 0, max_priority);
+            reindex_current(next_state, &items[selected], &updated_item);
+            set_current_list(
+                next_state, items.set(selected, updated_item), selected);
+            next_state.status_message =
+                "Priority set to " + std::to_string(updated_item.priority) +
+                ".";
+            return {std::move(next_state), lager::noop};
+        },
+        [&](ReminderDueAction act) -> std::pair<AppState, AppEffect> {
+            AppState next_state = current_state;
+            if (next_state.due_index.contains(act.reminder)) {
+                next_state.status_message = "Due: " + act.reminder.text;
             }
             return {std::move(next_state), lager::noop};
         },
@@ -225,16 +1364,168 @@ inline std::pair<AppState, AppEffect> reducer(AppState current_state,
         [&](RequestLoadAction) -> std::pair<AppState, AppEffect> {
             AppState next_state       = current_state;
             next_state.status_message = "Loading...";
-            return {std::move(next_state), load_effect()};
+            return {std::move(next_state),
+                    load_effect(current_state.list_name)};
         },
         [&](LoadCompleteAction act) -> std::pair<AppState, AppEffect> {
             AppState next_state = current_state;
+            AppEffect effect    = lager::noop;
+            if (act.loaded_state)
+                effect = take_loaded_lists(next_state, *act.loaded_state);
+            next_state.status_message = act.message;
+            return {std::move(next_state), effect};
+        },
+        [&](OpenListAction act) -> std::pair<AppState, AppEffect> {
+            AppState next_state = current_state;
+            if (!valid_list_name(act.name)) {
+                next_state.status_message =
+                    "List names are letters, digits, '-' and '_'.";
+                return {std::move(next_state), lager::noop};
+            }
+            if (act.name == current_state.list_name)
+                return reducer(current_state,
+                               SelectTodoByIdAction{act.select_id});
+            next_state.status_message = "Opening " + act.name + "...";
+            return {std::move(next_state),
+                    open_list_effect(
+                        current_state, std::move(act.name), act.select_id)};
+        },
+        [&](ListOpenedAction act) -> std::pair<AppState, AppEffect> {
+            AppState next_state = current_state;
+            AppEffect effect    = lager::noop;
             if (act.loaded_state) {
-                next_state.todos          = act.loaded_state->todos;
-                next_state.selected_index = next_state.todos.empty() ? -1 : 0;
+                effect = take_loaded_lists(next_state, *act.loaded_state);
+                next_state.list_name     = act.name;
+                next_state.current_input = "";
+                if (act.select_id != 0)
+                    next_state = reducer(std::move(next_state),
+                                         SelectTodoByIdAction{act.select_id})
+                                     .first;
             }
+            next_state.lists          = act.lists;
             next_state.status_message = act.message;
-            return {std::move(next_state), lager::noop};
+            return {std::move(next_state), effect};
+        },
+        [&](ArchiveDoneAction act) -> std::pair<AppState, AppEffect> {
+            AppState next_state = current_state;
+            TodoList todos      = next_state.todos;
+            std::size_t index   = 0;
+            for (const auto& item : next_state.todos) {
+                if (item.done && item.done_at == 0) {
+                    TodoItem stamped = item;
+                    stamped.done_at  = act.now;
+                    reindex_priority(next_state, 0, &item, &stamped);
+                    todos = todos.set(index, std::move(stamped));
+                }
+                ++index;
+            }
+            next_state.todos = std::move(todos);
+            return {next_state, archive_effect(next_state, act.now)};
+        },
+        [&](ArchivedAction act) -> std::pair<AppState, AppEffect> {
+            AppState next_state = current_state;
+            if (act.list != next_state.list_name)
+                return {std::move(next_state), lager::noop};
+            // One pass over the main list; the selection stays on the same
+            // item, or the next one left if it was archived
+            std::unordered_set<std::uint64_t> ids(act.ids.begin(),
+                                                  act.ids.end());
+            auto kept            = TodoList{}.transient();
+            int selected         = next_state.selected_index;
+            int index            = 0;
+            std::size_t archived = 0;
+            for (const auto& item : next_state.todos) {
+                if (index++ == next_state.selected_index)
+                    selected = static_cast<int>(kept.size());
+                if (!item.done || !ids.count(item.id)) {
+                    kept.push_back(item);
+                    continue;
+                }
+                next_state.due_index =
+                    unindex_subtree(next_state.due_index, item);
+                reindex_priority(next_state, 0, &item, nullptr);
+                ++archived;
+            }
+            if (archived == 0)
+                return {std::move(next_state), lager::noop};
+            if (next_state.active_column == 0)
+                next_state.path = {};
+            set_column(next_state, 0, kept.persistent(), selected);
+            clear_marks(next_state);
+            next_state.status_message =
+                "Archived " + std::to_string(archived) + " done items.";
+            return {next_state, save_effect(next_state)};
+        },
+        [&](ListMergedAction act) -> std::pair<AppState, AppEffect> {
+            AppState next_state = current_state;
+            if (act.list != next_state.list_name || !act.saved || !act.merged)
+                return {std::move(next_state), lager::noop};
+            // Edited since it was saved: the edits were merged all the same,
+            // and what they made is taken with the next save
+            if (!(next_state.todos == act.saved->todos &&
+                  next_state.columns == act.saved->columns)) {
+                next_state.synced = act.saved->todos;
+                return {std::move(next_state), lager::noop};
+            }
+            next_state.synced = act.merged->todos;
+            if (next_state.todos == act.merged->todos)
+                return {std::move(next_state), lager::noop};
+            take_changed_lists(next_state, *act.merged);
+            next_state.status_message =
+                "Merged the edits of other instances.";
+            return {std::move(next_state),
+                    schedule_reminders_effect(std::move(act.reminders))};
+        },
+        [&](ListChangedOnDiskAction act) -> std::pair<AppState, AppEffect> {
+            AppState next_state = current_state;
+            if (act.list != next_state.list_name || !act.before ||
+                !act.after)
+                return {std::move(next_state), lager::noop};
+            // Edits not saved yet are not dropped for it, the change is
+            // merged with them, which takes a while for a long list
+            if (!(next_state.todos == act.before->todos &&
+                  next_state.columns == act.before->columns))
+                return {next_state,
+                        merge_change_effect(next_state, std::move(act))};
+            take_changed_lists(next_state, *act.after);
+            next_state.status_message = "Reloaded " + act.list + ".";
+            AppEffect effect =
+                [took = took_change_effect(act.list, *act.after),
+                 schedule =
+                     schedule_reminders_effect(std::move(act.reminders))](
+                    lager::context<Action> ctx) {
+                    took(ctx);
+                    schedule(ctx);
+                };
+            return {std::move(next_state), std::move(effect)};
+        },
+        [&](ChangeMergedAction act) -> std::pair<AppState, AppEffect> {
+            AppState next_state = current_state;
+            if (act.list != next_state.list_name || !act.before ||
+                !act.after || !act.edited || !act.merged)
+                return {std::move(next_state), lager::noop};
+            // Edited while it was merged: merged again with the edits
+            if (!(next_state.todos == act.edited->todos &&
+                  next_state.columns == act.edited->columns))
+                return {next_state,
+                        merge_change_effect(
+                            next_state,
+                            ListChangedOnDiskAction{std::move(act.list),
+                                                    std::move(act.before),
+                                                    std::move(act.after),
+                                                    {}})};
+            take_changed_lists(next_state, *act.merged);
+            next_state.status_message = "Merged the changes to " + act.list +
+                                        " on disk with your edits.";
+            AppEffect effect =
+                [took = took_change_effect(act.list, *act.after),
+                 schedule =
+                     schedule_reminders_effect(std::move(act.reminders))](
+                    lager::context<Action> ctx) {
+                    took(ctx);
+                    schedule(ctx);
+                };
+            return {std::move(next_state), std::move(effect)};
         },
         // --- Other ---
         [&](SetStatusAction act) -> std::pair<AppState, AppEffect> {
@@ -0,0 +1,295 @@
+#include "tags.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define TAGS_HAVE_AVX2_KERNEL 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+bool is_sigil(char c) { return c == '@' || c == '#'; }
+
+bool is_tag_char(char c)
+{
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '-' ||
+           c == '_' || c == '/';
+}
+
+// Calls fn(tag) for every tag in `text`, sigil included.
+template <typename Fn>
+void for_each_tag(std::string_view text, Fn&& fn)
+{
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        bool word_start =
+            i == 0 || std::isspace(static_cast<unsigned char>(text[i - 1]));
+        if (!word_start || !is_sigil(text[i]))
+            continue;
+        std::size_t end = i + 1;
+        while (end < text.size() && is_tag_char(text[end]))
+            ++end;
+        if (end > i + 1)
+            fn(text.substr(i, end - i));
+        i = end;
+    }
+}
+
+// Calls fn(term, negated) for every term of a tag query, without its '-'.
+template <typename Fn>
+void for_each_term(std::string_view text, Fn&& fn)
+{
+    std::size_t i = 0;
+    while (i < text.size()) {
+        while (i < text.size() &&
+               std::isspace(static_cast<unsigned char>(text[i])))
+            ++i;
+        std::size_t end = i;
+        while (end < text.size() &&
+               !std::isspace(static_cast<unsigned char>(text[end])))
+            ++end;
+        std::string_view term = text.substr(i, end - i);
+        i                     = end;
+        if (term.empty())
+            continue;
+        bool negated = term[0] == '-';
+        if (negated)
+            term.remove_prefix(1);
+        fn(term, negated);
+    }
+}
+
+// Calls fn(tag) for every tag a term names: its '|'-separated names, with
+// a bare word standing for both "@word" and "#word".
+template <typename Fn>
+void for_each_alternative(std::string_view term, Fn&& fn)
+{
+    while (!term.empty()) {
+        auto bar              = term.find('|');
+        std::string_view name = term.substr(0, bar);
+        term = bar == std::string_view::npos ? std::string_view{}
+                                             : term.substr(bar + 1);
+        if (name.empty())
+            continue;
+        if (is_sigil(name[0])) {
+            fn(name);
+            continue;
+        }
+        for (const char* sigil : {"@", "#"})
+            fn(std::string(sigil) += name);
+    }
+}
+
+bool matches(std::uint64_t lo, std::uint64_t hi, const TagQuery& query)
+{
+    if ((lo & query.all.lo) != query.all.lo ||
+        (hi & query.all.hi) != query.all.hi)
+        return false;
+    if ((lo & query.none.lo) | (hi & query.none.hi))
+        return false;
+    for (const auto& alternatives : query.any) {
+        if (((lo & alternatives.lo) | (hi & alternatives.hi)) == 0)
+            return false;
+    }
+    return true;
+}
+
+void select_range_scalar(const TagColumns& columns,
+                         const TagQuery& query,
+                         std::size_t begin,
+                         std::vector<std::uint32_t>& selection)
+{
+    for (std::size_t i = begin; i < columns.size(); ++i) {
+        if (matches(columns.lo[i], columns.hi[i], query))
+            selection.push_back(static_cast<std::uint32_t>(i));
+    }
+}
+
+#ifdef TAGS_HAVE_AVX2_KERNEL
+// Four items per iteration: each test is an AND plus a 64-bit compare on
+// both words, and the surviving lanes become a 4-bit mask.
+__attribute__((target("avx2"))) void
+select_avx2(const TagColumns& columns,
+            const TagQuery& query,
+            std::vector<std::uint32_t>& selection)
+{
+    const __m256i zero    = _mm256_setzero_si256();
+    const __m256i all_lo  = _mm256_set1_epi64x(std::int64_t(query.all.lo));
+    const __m256i all_hi  = _mm256_set1_epi64x(std::int64_t(query.all.hi));
+    const __m256i none_lo = _mm256_set1_epi64x(std::int64_t(query.none.lo));
+    const __m256i none_hi = _mm256_set1_epi64x(std::int64_t(query.none.hi));
+
+    const std::uint64_t* lo = columns.lo.data();
+    const std::uint64_t* hi = columns.hi.data();
+    const std::size_t n     = columns.size();
+    std::size_t i           = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i l  = _mm256_loadu_si256((const __m256i*)(lo + i));
+        __m256i h  = _mm256_loadu_si256((const __m256i*)(hi + i));
+        __m256i ok = _mm256_and_si256(
+            _mm256_cmpeq_epi64(_mm256_and_si256(l, all_lo), all_lo),
+            _mm256_cmpeq_epi64(_mm256_and_si256(h, all_hi), all_hi));
+        ok = _mm256_and_si256(
+            ok,
+            _mm256_cmpeq_epi64(_mm256_or_si256(_mm256_and_si256(l, none_lo),
+                                               _mm256_and_si256(h, none_hi)),
+                               zero));
+        // Broadcasting inside the loop is a single load, and keeps the
+        // alternatives out of over-aligned containers
+        for (const auto& alternatives : query.any) {
+            __m256i hit = _mm256_or_si256(
+                _mm256_and_si256(
+                    l, _mm256_set1_epi64x(std::int64_t(alternatives.lo))),
+                _mm256_and_si256(
+                    h, _mm256_set1_epi64x(std::int64_t(alternatives.hi))));
+            ok = _mm256_andnot_si256(_mm256_cmpeq_epi64(hit, zero), ok);
+        }
+        unsigned lanes = static_cast<unsigned>(
+            _mm256_movemask_pd(_mm256_castsi256_pd(ok)));
+        while (lanes) {
+            selection.push_back(
+                static_cast<std::uint32_t>(i + __builtin_ctz(lanes)));
+            lanes &= lanes - 1;
+        }
+    }
+    select_range_scalar(columns, query, i, selection);
+}
+#endif
+
+} // namespace
+
+int TagDictionary::intern(std::string_view tag)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = bits_.find(std::string(tag));
+    if (found != bits_.end())
+        return found->second;
+    if (bits_.size() >= overflow_bit) {
+        overflow_.emplace(tag);
+        return overflow_bit;
+    }
+    int bit = static_cast<int>(bits_.size());
+    bits_.emplace(std::string(tag), bit);
+    return bit;
+}
+
+int TagDictionary::find(std::string_view tag) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = bits_.find(std::string(tag));
+    if (found != bits_.end())
+        return found->second;
+    return overflow_.count(std::string(tag)) ? overflow_bit : -1;
+}
+
+std::size_t TagDictionary::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bits_.size() + overflow_.size();
+}
+
+TagDictionary& tag_dictionary()
+{
+    static TagDictionary dictionary;
+    return dictionary;
+}
+
+TagMask parse_tags(std::string_view text)
+{
+    TagMask mask;
+    for_each_tag(text, [&](std::string_view tag) {
+        mask.set(tag_dictionary().intern(tag));
+    });
+    return mask;
+}
+
+TagQuery parse_tag_query(std::string_view text)
+{
+    const auto& dictionary = tag_dictionary();
+    TagQuery query;
+    for_each_term(text, [&](std::string_view term, bool negated) {
+        TagMask alternatives;
+        int count = 0; // Tags named by the term, known or not
+        for_each_alternative(term, [&](std::string_view tag) {
+            ++count;
+            int bit = dictionary.find(tag);
+            if (bit == TagDictionary::overflow_bit) {
+                // Any item with such a tag may match, or may not
+                query.by_text = true;
+                if (negated)
+                    return;
+            }
+            if (bit >= 0)
+                alternatives.set(bit);
+        });
+        if (count == 0)
+            return;
+
+        if (negated)
+            query.none = query.none | alternatives;
+        else if (alternatives.empty())
+            query.never = true;
+        else if (count == 1)
+            query.all = query.all | alternatives;
+        else
+            query.any.push_back(alternatives);
+    });
+    return query;
+}
+
+bool matches_tag_query(std::string_view query, std::string_view text)
+{
+    std::vector<std::string_view> tags;
+    for_each_tag(text, [&](std::string_view tag) { tags.push_back(tag); });
+    bool matched = true;
+    for_each_term(query, [&](std::string_view term, bool negated) {
+        bool named = false, hit = false;
+        for_each_alternative(term, [&](std::string_view tag) {
+            named = true;
+            hit   = hit || std::find(tags.begin(), tags.end(), tag) !=
+                             tags.end();
+        });
+        if (named && hit == negated)
+            matched = false;
+    });
+    return matched;
+}
+
+void select_matching_scalar(const TagColumns& columns,
+                            const TagQuery& query,
+                            std::vector<std::uint32_t>& selection)
+{
+    selection.clear();
+    if (query.never)
+        return;
+    selection.reserve(columns.size());
+    select_range_scalar(columns, query, 0, selection);
+}
+
+bool tag_filter_vectorized()
+{
+#ifdef TAGS_HAVE_AVX2_KERNEL
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    return has_avx2;
+#else
+    return false;
+#endif
+}
+
+void select_matching(const TagColumns& columns,
+                     const TagQuery& query,
+                     std::vector<std::uint32_t>& selection)
+{
+#ifdef TAGS_HAVE_AVX2_KERNEL
+    if (tag_filter_vectorized()) {
+        selection.clear();
+        if (query.never)
+            return;
+        selection.reserve(columns.size());
+        select_avx2(columns, query, selection);
+        return;
+    }
+#endif
+    select_matching_scalar(columns, query, selection);
+}
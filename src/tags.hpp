@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Tags are words in the text of an item starting with '@' or '#', e.g.
+// "Rotate certs @oncall #infra". Each distinct tag gets a bit in the global
+// TagDictionary, and every item caches the set of its tags as a TagMask, so
+// filtering never looks at strings.
+
+// Set of up to TagDictionary::max_tags tags.
+struct TagMask
+{
+    std::uint64_t lo = 0;
+    std::uint64_t hi = 0;
+
+    void set(int bit)
+    {
+        (bit < 64 ? lo : hi) |= std::uint64_t{1} << (bit % 64);
+    }
+    bool empty() const { return (lo | hi) == 0; }
+    TagMask operator|(TagMask other) const
+    {
+        return {lo | other.lo, hi | other.hi};
+    }
+    bool operator==(const TagMask&) const = default;
+};
+
+class TagDictionary
+{
+public:
+    static constexpr int max_tags = 128;
+    // Shared by every tag seen once the others are taken: it only says an
+    // item has some such tag, queries naming them check the text (see
+    // TagQuery::by_text)
+    static constexpr int overflow_bit = max_tags - 1;
+
+    // Bit of `tag`, assigning the next free one if it is new, or
+    // overflow_bit once all are taken.
+    int intern(std::string_view tag);
+    // Bit of `tag`, or -1 if no item has used it yet
+    int find(std::string_view tag) const;
+    // Grows whenever a new tag is seen; compiled queries are stale after it
+    // changes
+    std::size_t size() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, int> bits_;
+    std::unordered_set<std::string> overflow_;
+};
+
+TagDictionary& tag_dictionary();
+
+// Tags of an item's text, interning new ones.
+TagMask parse_tags(std::string_view text);
+
+// A filter such as "@oncall #infra|#db -#later": every term must match, a
+// term matches if any of its '|'-separated tags is present, and a term
+// starting with '-' must not match. A bare word stands for either tag, so
+// "infra" is "@infra|#infra".
+struct TagQuery
+{
+    TagMask all;              // Single tag terms: every one of these
+    std::vector<TagMask> any; // Alternatives: at least one of each
+    TagMask none;             // Negated terms: none of these
+    bool never = false;       // Requires a tag that nobody has
+    // Names tags past the dictionary's bits: the masks only narrow the rows
+    // down, each one left must be checked with matches_tag_query
+    bool by_text = false;
+
+    bool empty() const { return all.empty() && any.empty() && none.empty(); }
+};
+
+// Looks the tags up without interning them.
+TagQuery parse_tag_query(std::string_view text);
+
+// Whether the tags written in `text` satisfy `query`, comparing names rather
+// than bits. Linear in both texts.
+bool matches_tag_query(std::string_view query, std::string_view text);
+
+// Tag masks of a list stored column-wise (all low words, then all high
+// words), the layout the filter kernels stream through.
+struct TagColumns
+{
+    std::vector<std::uint64_t> lo;
+    std::vector<std::uint64_t> hi;
+
+    std::size_t size() const { return lo.size(); }
+
+    template <typename Rows, typename MaskOf>
+    void assign(const Rows& rows, MaskOf&& mask_of)
+    {
+        lo.clear();
+        hi.clear();
+        lo.reserve(rows.size());
+        hi.reserve(rows.size());
+        for (const auto& row : rows) {
+            TagMask mask = mask_of(row);
+            lo.push_back(mask.lo);
+            hi.push_back(mask.hi);
+        }
+    }
+
+    // Replaces the masks of rows [begin, end) with those of `count` rows of
+    // `rows` from `begin` on, keeping the ones before and after: after an
+    // edit only the rows it touched are read again.
+    template <typename Rows, typename MaskOf>
+    void splice(std::size_t begin,
+                std::size_t end,
+                const Rows& rows,
+                std::size_t count,
+                MaskOf&& mask_of)
+    {
+        std::vector<std::uint64_t> new_lo, new_hi;
+        new_lo.reserve(count);
+        new_hi.reserve(count);
+        auto row = rows.begin() + begin;
+        for (std::size_t i = 0; i < count; ++i, ++row) {
+            TagMask mask = mask_of(*row);
+            new_lo.push_back(mask.lo);
+            new_hi.push_back(mask.hi);
+        }
+        lo.erase(lo.begin() + begin, lo.begin() + end);
+        hi.erase(hi.begin() + begin, hi.begin() + end);
+        lo.insert(lo.begin() + begin, new_lo.begin(), new_lo.end());
+        hi.insert(hi.begin() + begin, new_hi.begin(), new_hi.end());
+    }
+};
+
+// Fills `selection` with the positions of the rows matching `query`, in
+// order. Uses AVX2 when the CPU has it.
+void select_matching(const TagColumns& columns,
+                     const TagQuery& query,
+                     std::vector<std::uint32_t>& selection);
+
+// The portable kernel, exposed for benchmarking against the vectorized one.
+void select_matching_scalar(const TagColumns& columns,
+                            const TagQuery& query,
+                            std::vector<std::uint32_t>& selection);
+
+// Whether select_matching runs the AVX2 kernel on this machine
+bool tag_filter_vectorized();
@@ -0,0 +1,92 @@
+#include "thread_pool.hpp"
+#include "trace.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool(unsigned threads)
+{
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    workers_.reserve(threads);
+    for (unsigned i = 0; i < threads; ++i)
+        workers_.emplace_back([this] { run(); });
+    spdlog::debug("Thread pool started with {} workers", threads);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    for (auto& worker : workers_)
+        worker.join();
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(std::move(task));
+    }
+    cv_.notify_one();
+}
+
+void ThreadPool::run_all(std::size_t count,
+                         const std::function<void(std::size_t)>& task)
+{
+    // A helper may only start once the work is all done and `task` is gone;
+    // it then finds nothing left to claim, and the job it holds still lives
+    struct Job
+    {
+        const std::function<void(std::size_t)>* task;
+        std::size_t count;
+        std::atomic<std::size_t> next{0};
+        std::mutex mutex;
+        std::condition_variable finished;
+        std::size_t done = 0;
+    };
+    auto job   = std::make_shared<Job>();
+    job->task  = &task;
+    job->count = count;
+    auto work  = [job] {
+        std::size_t ran = 0;
+        for (std::size_t i; (i = job->next++) < job->count; ++ran)
+            (*job->task)(i);
+        if (ran == 0)
+            return;
+        std::lock_guard<std::mutex> lock(job->mutex);
+        job->done += ran;
+        if (job->done == job->count)
+            job->finished.notify_all();
+    };
+
+    std::size_t helpers = std::min<std::size_t>(size(), count) - (count > 0);
+    for (std::size_t i = 0; i < helpers; ++i)
+        submit(work);
+    work();
+    std::unique_lock<std::mutex> lock(job->mutex);
+    job->finished.wait(lock, [&] { return job->done == job->count; });
+}
+
+void ThreadPool::run()
+{
+    trace_thread_name("pool");
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+            if (tasks_.empty())
+                return; // Stopping, and nothing left to do
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task();
+    }
+}
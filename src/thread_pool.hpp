@@ -0,0 +1,44 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads running queued tasks in FIFO order. Used for
+// work that is split into independent chunks (e.g. scanning a big list), so
+// there is no result plumbing: tasks publish what they find themselves.
+class ThreadPool
+{
+public:
+    // One worker per core by default
+    explicit ThreadPool(unsigned threads = 0);
+    ~ThreadPool(); // Finishes the queued tasks, then joins
+
+    ThreadPool(const ThreadPool&)            = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Thread-safe.
+    void submit(std::function<void()> task);
+
+    // Runs task(0) ... task(count - 1) on the workers and returns once all
+    // of them have run. The calling thread takes its share rather than
+    // waiting, so this works from a task of any pool, this one included.
+    void run_all(std::size_t count,
+                 const std::function<void(std::size_t)>& task);
+
+    unsigned size() const { return static_cast<unsigned>(workers_.size()); }
+
+private:
+    void run();
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::function<void()>> tasks_;
+    bool stopping_ = false;
+
+    std::vector<std::thread> workers_;
+};
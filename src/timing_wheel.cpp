@@ -0,0 +1,103 @@
+#include "timing_wheel.hpp"
+
+#include <iterator>
+#include <utility>
+
+namespace {
+// After a long stall (suspend, clock change) re-placing everything is
+// cheaper than stepping through each missed tick.
+constexpr std::int64_t max_ticks_per_advance = 4096;
+
+void move_append(std::vector<Reminder>& from, std::vector<Reminder>& to)
+{
+    to.insert(to.end(),
+              std::make_move_iterator(from.begin()),
+              std::make_move_iterator(from.end()));
+    from.clear();
+}
+} // namespace
+
+TimingWheel::TimingWheel(std::int64_t now)
+    : now_(now)
+{
+}
+
+void TimingWheel::schedule(Reminder reminder)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    place(std::move(reminder));
+    ++size_;
+}
+
+void TimingWheel::advance(std::int64_t now, std::vector<Reminder>& fired)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto first = fired.size();
+
+    if (now - now_ > max_ticks_per_advance) {
+        Slot all;
+        move_append(overflow_, all);
+        for (auto& level : wheel_)
+            for (auto& slot : level)
+                move_append(slot, all);
+        now_ = now;
+        for (auto& reminder : all)
+            place(std::move(reminder));
+    }
+    while (now_ < now)
+        tick(fired);
+    move_append(ready_, fired);
+
+    size_ -= fired.size() - first;
+}
+
+std::size_t TimingWheel::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return size_;
+}
+
+void TimingWheel::place(Reminder reminder)
+{
+    auto delta = reminder.due - now_;
+    if (delta <= 0) {
+        ready_.push_back(std::move(reminder));
+        return;
+    }
+    for (int level = 0; level < levels; ++level) {
+        auto shift = slot_bits * level;
+        if (delta < (std::int64_t{1} << (shift + slot_bits))) {
+            auto slot = (reminder.due >> shift) & (slots - 1);
+            wheel_[level][slot].push_back(std::move(reminder));
+            return;
+        }
+    }
+    overflow_.push_back(std::move(reminder));
+}
+
+void TimingWheel::tick(std::vector<Reminder>& fired)
+{
+    ++now_;
+    // Coarsest first, so entries cascading out of a higher level into the
+    // slot that is due now at a lower level are picked up in the same tick.
+    auto span_mask = [](int level) {
+        return (std::int64_t{1} << (slot_bits * level)) - 1;
+    };
+    if ((now_ & span_mask(levels)) == 0)
+        cascade(overflow_);
+    for (int level = levels - 1; level > 0; --level) {
+        if ((now_ & span_mask(level)) != 0)
+            continue;
+        auto slot = (now_ >> (slot_bits * level)) & (slots - 1);
+        cascade(wheel_[level][slot]);
+    }
+    move_append(wheel_[0][now_ & (slots - 1)], fired);
+}
+
+void TimingWheel::cascade(Slot& slot)
+{
+    Slot entries;
+    entries.swap(slot);
+    for (auto& reminder : entries)
+        place(std::move(reminder));
+}
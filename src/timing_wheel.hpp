@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// A due date of a todo item, as kept in AppState::due_index and scheduled in
+// the TimingWheel. Ordered (and identified) by time, then item id; the text
+// is only carried along for the notification.
+struct Reminder
+{
+    std::int64_t due = 0; // Seconds since the epoch
+    std::uint64_t id = 0;
+    std::string text;
+
+    bool operator<(const Reminder& other) const
+    {
+        return std::tie(due, id) < std::tie(other.due, other.id);
+    }
+    bool operator==(const Reminder& other) const
+    {
+        return due == other.due && id == other.id;
+    }
+};
+
+// Hierarchical timing wheel with one second resolution. Level 0 has a slot
+// per second of the next minute-ish (64s), and each following level covers
+// 64 times the span of the previous one; reminders further out than the last
+// level wait in an overflow list. Advancing by a tick only looks at the slot
+// for that tick, plus cascading a coarser slot down once every 64^k ticks,
+// so the cost is proportional to the reminders that expire, not to the
+// number scheduled.
+//
+// Cancellation is lazy: entries are never removed, whoever handles a fired
+// reminder checks it is still current. Thread-safe.
+class TimingWheel
+{
+public:
+    explicit TimingWheel(std::int64_t now);
+
+    void schedule(Reminder reminder);
+
+    // Moves the wheel forward to `now`, appending the reminders that became
+    // due to `fired`.
+    void advance(std::int64_t now, std::vector<Reminder>& fired);
+
+    std::size_t size() const;
+
+private:
+    static constexpr int slot_bits = 6;
+    static constexpr int slots     = 1 << slot_bits;
+    static constexpr int levels    = 4;
+
+    using Slot = std::vector<Reminder>;
+
+    void place(Reminder reminder);
+    void tick(std::vector<Reminder>& fired);
+    void cascade(Slot& slot);
+
+    mutable std::mutex mutex_;
+    std::int64_t now_;
+    std::array<std::array<Slot, slots>, levels> wheel_;
+    Slot ready_;    // Already due, fired on the next advance
+    Slot overflow_; // Beyond the last level
+    std::size_t size_ = 0;
+};
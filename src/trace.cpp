@@ -0,0 +1,208 @@
+#include "trace.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+std::atomic<bool> trace_detail::enabled{false};
+
+namespace {
+
+struct Event
+{
+    const char* name;
+    const char* category;
+    std::int64_t start_ns;
+    std::int64_t duration_ns; // Negative for instant events
+};
+
+// Written by its own thread only, drained by the writer
+struct ThreadBuffer
+{
+    static constexpr std::size_t capacity = 8192;
+
+    std::array<Event, capacity> events;
+    std::atomic<std::size_t> head{0}; // Next to record, moved by the thread
+    std::atomic<std::size_t> tail{0}; // Next to write, moved by the writer
+    std::atomic<std::uint64_t> dropped{0};
+    std::atomic<const char*> name{nullptr};
+    const char* written_name = nullptr; // Writer's
+    int tid                  = 0;
+};
+
+struct Recorder
+{
+    std::mutex mutex; // Guards the list of buffers, not what's in them
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    std::FILE* file        = nullptr;
+    bool first             = true;
+    std::int64_t origin_ns = 0;
+    std::thread writer;
+    std::condition_variable wake;
+    bool stopping = false;
+};
+
+// Never destroyed: threads may still record while statics are torn down
+Recorder& recorder()
+{
+    static auto* recorder = new Recorder;
+    return *recorder;
+}
+
+thread_local ThreadBuffer* this_thread_buffer = nullptr;
+
+ThreadBuffer& buffer_of_this_thread()
+{
+    if (!this_thread_buffer) {
+        auto& r = recorder();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.buffers.push_back(std::make_unique<ThreadBuffer>());
+        this_thread_buffer      = r.buffers.back().get();
+        this_thread_buffer->tid = static_cast<int>(r.buffers.size());
+    }
+    return *this_thread_buffer;
+}
+
+void begin_event(Recorder& r)
+{
+    std::fputs(r.first ? "\n" : ",\n", r.file);
+    r.first = false;
+}
+
+// Writes out what the threads recorded since the last time. With the
+// recorder's mutex held.
+void drain(Recorder& r)
+{
+    for (auto& buffer : r.buffers) {
+        const char* name = buffer->name.load(std::memory_order_acquire);
+        if (name && name != buffer->written_name) {
+            begin_event(r);
+            std::fprintf(r.file,
+                         "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                         "\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                         buffer->tid,
+                         name);
+            buffer->written_name = name;
+        }
+
+        auto head = buffer->head.load(std::memory_order_acquire);
+        auto tail = buffer->tail.load(std::memory_order_relaxed);
+        for (; tail != head; ++tail) {
+            const Event& event = buffer->events[tail % ThreadBuffer::capacity];
+            // Microseconds since tracing started
+            double ts = (event.start_ns - r.origin_ns) / 1000.0;
+            begin_event(r);
+            if (event.duration_ns < 0) {
+                std::fprintf(r.file,
+                             "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"i\","
+                             "\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%d}",
+                             event.name,
+                             event.category,
+                             ts,
+                             buffer->tid);
+            } else {
+                std::fprintf(r.file,
+                             "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\","
+                             "\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}",
+                             event.name,
+                             event.category,
+                             ts,
+                             event.duration_ns / 1000.0,
+                             buffer->tid);
+            }
+        }
+        buffer->tail.store(tail, std::memory_order_release);
+    }
+    std::fflush(r.file);
+}
+
+} // namespace
+
+std::int64_t trace_detail::now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+void trace_detail::record(const char* name,
+                          const char* category,
+                          std::int64_t start_ns,
+                          std::int64_t duration_ns)
+{
+    ThreadBuffer& buffer = buffer_of_this_thread();
+    auto head            = buffer.head.load(std::memory_order_relaxed);
+    if (head - buffer.tail.load(std::memory_order_acquire) ==
+        ThreadBuffer::capacity) {
+        buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    buffer.events[head % ThreadBuffer::capacity] = {
+        name, category, start_ns, duration_ns};
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+bool start_tracing_from_env()
+{
+    const char* path = std::getenv("TUI_TODO_TRACE");
+    if (!path || !*path)
+        return false;
+    auto& r = recorder();
+    r.file  = std::fopen(path, "w");
+    if (!r.file) {
+        spdlog::error("Could not open trace file {}", path);
+        return false;
+    }
+    // A trace cut short (a crash) still loads without the closing bracket
+    std::fputs("[", r.file);
+    r.origin_ns = trace_detail::now_ns();
+    r.writer    = std::thread([&r] {
+        std::unique_lock<std::mutex> lock(r.mutex);
+        while (!r.stopping) {
+            r.wake.wait_for(lock, std::chrono::milliseconds(50));
+            drain(r);
+        }
+    });
+    trace_detail::enabled.store(true, std::memory_order_relaxed);
+    spdlog::info("Tracing to {}", path);
+    return true;
+}
+
+void stop_tracing()
+{
+    auto& r = recorder();
+    if (!r.file)
+        return;
+    trace_detail::enabled.store(false, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.stopping = true;
+    }
+    r.wake.notify_one();
+    r.writer.join();
+
+    std::lock_guard<std::mutex> lock(r.mutex);
+    drain(r);
+    std::uint64_t dropped = 0;
+    for (const auto& buffer : r.buffers)
+        dropped += buffer->dropped.load(std::memory_order_relaxed);
+    std::fputs("\n]\n", r.file);
+    std::fclose(r.file);
+    r.file = nullptr;
+    if (dropped > 0)
+        spdlog::warn("Trace dropped {} events, buffers were full", dropped);
+}
+
+void trace_thread_name(const char* name)
+{
+    if (tracing())
+        buffer_of_this_thread().name.store(name, std::memory_order_release);
+}
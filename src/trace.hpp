@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Timeline of what the app does (actions dispatched and reduced, effects,
+// frames) for postmortems, written as Chrome trace events to the file named
+// by the TUI_TODO_TRACE environment variable; open it in chrome://tracing or
+// Perfetto. Without the variable, every trace point costs a load and a
+// branch that is never taken.
+//
+// Each thread records into a buffer of its own, a ring nothing else writes
+// to, so recording takes no lock; a background thread drains the rings to
+// the file. Events that don't fit a full ring are dropped, and counted.
+//
+// Names and categories must be string literals (or otherwise live forever)
+// and need no JSON escaping: only the pointers are recorded.
+
+namespace trace_detail {
+extern std::atomic<bool> enabled;
+std::int64_t now_ns();
+// A complete event, or an instant one with a negative duration
+void record(const char* name,
+            const char* category,
+            std::int64_t start_ns,
+            std::int64_t duration_ns);
+} // namespace trace_detail
+
+inline bool tracing()
+{
+    return trace_detail::enabled.load(std::memory_order_relaxed);
+}
+
+// Starts tracing if TUI_TODO_TRACE is set. Returns whether it did.
+bool start_tracing_from_env();
+// Writes out what is left and closes the file.
+void stop_tracing();
+
+// Names the calling thread in the trace
+void trace_thread_name(const char* name);
+
+// Something that happened at one point in time
+inline void trace_instant(const char* name, const char* category)
+{
+    if (tracing())
+        trace_detail::record(name, category, trace_detail::now_ns(), -1);
+}
+
+// Records the time until it goes out of scope
+class TraceScope
+{
+public:
+    TraceScope(const char* name, const char* category)
+        : name_(name)
+        , category_(category)
+        , start_ns_(tracing() ? trace_detail::now_ns() : -1)
+    {
+    }
+    ~TraceScope()
+    {
+        if (start_ns_ >= 0)
+            trace_detail::record(name_,
+                                 category_,
+                                 start_ns_,
+                                 trace_detail::now_ns() - start_ns_);
+    }
+
+    TraceScope(const TraceScope&)            = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* name_;
+    const char* category_;
+    std::int64_t start_ns_;
+};
@@ -0,0 +1,476 @@
+// Synthetic lists for benchmarks and tests, from a thousand items to tens of
+// millions, written either as a data file (what Persistence::load_state
+// reads) or as a recorded session adding the items one by one (what
+// tui_app --replay reads).
+//
+//   tui_workload --out FILE [--items N] [--seed S] [--threads T]
+//                [--words MEAN] [--duplicates R] [--done R] [--unicode R]
+//                [--tags R] [--priority R] [--due R] [--actions]
+//
+// Counts take k and M suffixes. Ratios are between 0 and 1:
+//   --words       mean number of words in a text (exponentially distributed)
+//   --duplicates  share of items whose text is one of a few shared ones
+//   --done        share of items done (at some time in 2026)
+//   --unicode     share of words that aren't ASCII (accents, CJK, Cyrillic,
+//                 Arabic, emoji)
+//   --tags        share of items with a tag or two
+//   --priority    share of items with a priority
+//   --due         share of items with a due date (in 2026)
+//
+// The items are generated in chunks, in parallel, each from its own seed, so
+// the same options give the same file whatever the number of threads.
+
+#include "action_log.hpp"
+#include "state.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+struct Options
+{
+    std::size_t items  = 100000;
+    std::uint64_t seed = 1;
+    unsigned threads   = 0; // One per core
+    double words       = 6;
+    double duplicates  = 0.3;
+    double done        = 0.3;
+    double unicode     = 0.05;
+    double tags        = 0.2;
+    double priority    = 0.1;
+    double due         = 0.1;
+    bool actions       = false;
+    std::filesystem::path out;
+};
+
+constexpr std::size_t chunk_size = 1 << 16;
+
+// The same sequence on every platform, unlike the std distributions
+struct SplitMix64
+{
+    std::uint64_t state;
+
+    std::uint64_t next()
+    {
+        std::uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+        z               = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z               = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+    // In [0, 1)
+    double uniform() { return (next() >> 11) * 0x1.0p-53; }
+    bool chance(double p) { return uniform() < p; }
+    std::size_t below(std::size_t n) { return next() % n; }
+};
+
+SplitMix64 rng_for(std::uint64_t seed, std::uint64_t stream)
+{
+    SplitMix64 mixer{seed ^ (stream * 0xd1b54a32d192ed03ull)};
+    return {mixer.next()};
+}
+
+constexpr const char* ascii_words[] = {
+    "buy",     "call",     "fix",      "review",  "deploy",   "write",
+    "email",   "plan",     "update",   "clean",   "milk",     "report",
+    "meeting", "invoice",  "server",   "docs",    "backup",   "garden",
+    "car",     "dentist",  "tickets",  "budget",  "draft",    "slides",
+    "tests",   "release",  "bug",      "migrate", "database", "kitchen",
+    "laundry", "groceries", "taxes",   "gift",    "flight",   "hotel",
+    "team",    "sprint",   "design",   "refactor", "cache",   "index",
+    "query",   "latency",  "profile",  "notes",   "book",     "read",
+    "pay",     "rent",     "order",    "parts",   "paint",    "fence",
+    "the",     "for",      "and",      "with",    "before",   "after",
+};
+
+constexpr const char* unicode_words[] = {
+    "café", "naïve", "façade", "Grüße", "über", "niño", "señal", "crème",
+    "日本語", "東京", "会議", "プロジェクト",
+    "Привет", "задача",
+    "مرحبا", "مهمة",
+    "🚀", "✅", "📦",
+};
+
+constexpr const char* tag_words[] = {
+    "#home", "#work", "@oncall", "#infra", "#db", "#later", "@alice", "#errand",
+};
+
+template <std::size_t N>
+const char* pick(SplitMix64& rng, const char* const (&words)[N])
+{
+    return words[rng.below(N)];
+}
+
+std::string make_text(const Options& options, SplitMix64& rng)
+{
+    // Exponential around the mean, at least one word
+    auto count = 1 + static_cast<int>(-std::log(1.0 - rng.uniform()) *
+                                      std::max(0.0, options.words - 1));
+    std::string text;
+    for (int i = 0; i < count; ++i) {
+        if (i > 0)
+            text += ' ';
+        text += rng.chance(options.unicode) ? pick(rng, unicode_words)
+                                            : pick(rng, ascii_words);
+    }
+    if (rng.chance(options.tags)) {
+        text += ' ';
+        text += pick(rng, tag_words);
+        if (rng.chance(0.3)) {
+            text += ' ';
+            text += pick(rng, tag_words);
+        }
+    }
+    return text;
+}
+
+// Texts shared by the duplicate items, about ten items each
+std::size_t shared_text_count(const Options& options)
+{
+    return std::max<std::size_t>(
+        1, static_cast<std::size_t>(options.items * options.duplicates / 10));
+}
+
+std::string shared_text(const Options& options, std::size_t index)
+{
+    auto rng = rng_for(~options.seed, index);
+    return make_text(options, rng);
+}
+
+struct Item
+{
+    std::string text;              // Empty for shared texts
+    std::size_t shared_index = 0;  // If text is empty
+    bool done                = false;
+    int priority             = 0;
+    std::int64_t due         = 0;
+    std::int64_t done_at     = 0;
+};
+
+std::vector<Item> generate_chunk(const Options& options, std::size_t chunk)
+{
+    const std::int64_t year_start = 1767225600; // 2026-01-01 UTC
+    const std::size_t shared      = shared_text_count(options);
+    const std::size_t begin       = chunk * chunk_size;
+    const std::size_t end = std::min(options.items, begin + chunk_size);
+
+    auto rng = rng_for(options.seed, chunk);
+    std::vector<Item> items(end - begin);
+    for (auto& item : items) {
+        if (rng.chance(options.duplicates))
+            item.shared_index = rng.below(shared);
+        else
+            item.text = make_text(options, rng);
+        item.done = rng.chance(options.done);
+        if (item.done)
+            item.done_at = year_start + static_cast<std::int64_t>(
+                                            rng.below(365 * 24 * 60)) * 60;
+        if (rng.chance(options.priority))
+            item.priority = 1 + static_cast<int>(rng.below(max_priority));
+        if (rng.chance(options.due))
+            item.due = year_start + static_cast<std::int64_t>(
+                                        rng.below(365 * 24 * 60)) * 60;
+    }
+    return items;
+}
+
+// Makes `make(chunk)` for every chunk on the pool and hands the results to
+// `consume(chunk, result)` on this thread, in order. Only a few chunks are
+// in flight at a time, so memory doesn't grow with the number of items.
+template <typename Make, typename Consume>
+void ordered_chunks(ThreadPool& pool,
+                    std::size_t chunks,
+                    Make make,
+                    Consume consume)
+{
+    using Result = decltype(make(std::size_t{0}));
+    std::vector<std::optional<Result>> results(chunks);
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::size_t submitted = 0;
+    auto submit           = [&] {
+        std::size_t chunk = submitted++;
+        pool.submit([&, chunk] {
+            Result result = make(chunk);
+            std::lock_guard<std::mutex> lock(mutex);
+            results[chunk] = std::move(result);
+            // Under the lock: once the last result is taken, this function
+            // returns and the condition variable is gone
+            ready.notify_all();
+        });
+    };
+
+    const std::size_t window = 2 * pool.size() + 1;
+    while (submitted < std::min(chunks, window))
+        submit();
+    for (std::size_t chunk = 0; chunk < chunks; ++chunk) {
+        std::optional<Result> result;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready.wait(lock, [&] { return results[chunk].has_value(); });
+            result = std::move(results[chunk]);
+            results[chunk].reset();
+        }
+        if (submitted < chunks)
+            submit();
+        consume(chunk, std::move(*result));
+    }
+}
+
+void append_json_string(std::string& out, std::string_view text)
+{
+    out += '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        } else {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+// A data file: the items in "todos", referring to their texts by position
+// in "strings", the shared texts first. Written in three passes over the
+// chunks (counting the distinct texts, the items, the texts), generating
+// them again each time rather than keeping them.
+bool write_state(const Options& options, ThreadPool& pool, std::FILE* out)
+{
+    const std::size_t chunks = (options.items + chunk_size - 1) / chunk_size;
+    const std::size_t shared = shared_text_count(options);
+
+    // Position of the first distinct text of every chunk
+    std::vector<std::size_t> first_text(chunks + 1, shared);
+    ordered_chunks(
+        pool,
+        chunks,
+        [&](std::size_t chunk) {
+            auto items = generate_chunk(options, chunk);
+            return std::count_if(items.begin(), items.end(), [](auto& item) {
+                return !item.text.empty();
+            });
+        },
+        [&](std::size_t chunk, std::ptrdiff_t distinct) {
+            first_text[chunk + 1] = first_text[chunk] + distinct;
+        });
+
+    std::fputs("{\"todos\":[", out);
+    ordered_chunks(
+        pool,
+        chunks,
+        [&](std::size_t chunk) {
+            std::string json;
+            std::size_t id   = chunk * chunk_size + 1;
+            std::size_t text = first_text[chunk];
+            char buffer[128];
+            for (const auto& item : generate_chunk(options, chunk)) {
+                int length = std::snprintf(
+                    buffer,
+                    sizeof(buffer),
+                    "%s\n{\"id\":%zu,\"done\":%s,\"text\":%zu",
+                    id == 1 ? "" : ",",
+                    id,
+                    item.done ? "true" : "false",
+                    item.text.empty() ? item.shared_index : text++);
+                json.append(buffer, length);
+                if (item.priority != 0)
+                    json += ",\"priority\":" + std::to_string(item.priority);
+                if (item.due != 0)
+                    json += ",\"due\":" + std::to_string(item.due);
+                if (item.done_at != 0)
+                    json += ",\"done_at\":" + std::to_string(item.done_at);
+                json += '}';
+                ++id;
+            }
+            return json;
+        },
+        [&](std::size_t, const std::string& json) {
+            std::fwrite(json.data(), 1, json.size(), out);
+        });
+
+    std::fputs("\n],\"strings\":[", out);
+    std::string json;
+    for (std::size_t i = 0; i < shared; ++i) {
+        json += i == 0 ? "\n" : ",\n";
+        append_json_string(json, shared_text(options, i));
+    }
+    std::fwrite(json.data(), 1, json.size(), out);
+    ordered_chunks(
+        pool,
+        chunks,
+        [&](std::size_t chunk) {
+            std::string json;
+            for (const auto& item : generate_chunk(options, chunk)) {
+                if (!item.text.empty()) {
+                    json += ",\n";
+                    append_json_string(json, item.text);
+                }
+            }
+            return json;
+        },
+        [&](std::size_t, const std::string& json) {
+            std::fwrite(json.data(), 1, json.size(), out);
+        });
+    std::fputs("\n]}\n", out);
+    return !std::ferror(out);
+}
+
+// A session adding the items to an empty list one by one, as typed in:
+// the text, Enter, then the priority, due date and done toggle if any.
+bool write_actions(const Options& options, ThreadPool& pool)
+{
+    ActionRecorder recorder(options.out, AppState{});
+    if (!recorder.ok())
+        return false;
+    const std::size_t chunks = (options.items + chunk_size - 1) / chunk_size;
+    const std::chrono::microseconds typing{300000}; // Between actions
+    const std::chrono::microseconds none{0};
+    ordered_chunks(
+        pool,
+        chunks,
+        [&](std::size_t chunk) { return generate_chunk(options, chunk); },
+        [&](std::size_t, std::vector<Item> items) {
+            for (auto& item : items) {
+                std::string text = item.text.empty()
+                                       ? shared_text(options, item.shared_index)
+                                       : std::move(item.text);
+                recorder.record(SetInputTextAction{std::move(text)}, typing);
+                recorder.record(AddTodoAction{}, none);
+                if (item.priority != 0)
+                    recorder.record(SetPriorityAction{item.priority}, typing);
+                if (item.due != 0)
+                    recorder.record(SetDueAction{item.due}, typing);
+                if (item.done)
+                    recorder.record(ToggleSelectedTodoAction{item.done_at},
+                                    typing);
+            }
+        });
+    return recorder.ok();
+}
+
+// "10000", "10k", "10M"
+std::optional<std::size_t> parse_count(const char* text)
+{
+    char* end  = nullptr;
+    double n   = std::strtod(text, &end);
+    double per = 1;
+    if (*end == 'k' || *end == 'K')
+        per = 1e3;
+    else if (*end == 'm' || *end == 'M')
+        per = 1e6;
+    if (end == text || n < 0 || (per != 1 ? end[1] != '\0' : *end != '\0'))
+        return std::nullopt;
+    return static_cast<std::size_t>(n * per);
+}
+
+std::optional<double> parse_ratio(const char* text)
+{
+    char* end = nullptr;
+    double r  = std::strtod(text, &end);
+    if (end == text || *end != '\0' || r < 0 || r > 1)
+        return std::nullopt;
+    return r;
+}
+
+std::optional<Options> parse_options(int argc, char* argv[])
+{
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg == "--actions") {
+            options.actions = true;
+            continue;
+        }
+        if (i + 1 == argc)
+            return std::nullopt;
+        const char* value = argv[++i];
+        std::optional<double> ratio;
+        std::optional<std::size_t> count;
+        if (arg == "--out") {
+            options.out = value;
+        } else if (arg == "--items" && (count = parse_count(value))) {
+            options.items = *count;
+        } else if (arg == "--seed" && (count = parse_count(value))) {
+            options.seed = *count;
+        } else if (arg == "--threads" && (count = parse_count(value))) {
+            options.threads = static_cast<unsigned>(*count);
+        } else if (arg == "--words" && (count = parse_count(value))) {
+            options.words = static_cast<double>(*count);
+        } else if ((ratio = parse_ratio(value))) {
+            if (arg == "--duplicates")
+                options.duplicates = *ratio;
+            else if (arg == "--done")
+                options.done = *ratio;
+            else if (arg == "--unicode")
+                options.unicode = *ratio;
+            else if (arg == "--tags")
+                options.tags = *ratio;
+            else if (arg == "--priority")
+                options.priority = *ratio;
+            else if (arg == "--due")
+                options.due = *ratio;
+            else
+                return std::nullopt;
+        } else {
+            return std::nullopt;
+        }
+    }
+    if (options.out.empty() || options.items == 0)
+        return std::nullopt;
+    return options;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    auto options = parse_options(argc, argv);
+    if (!options) {
+        std::fprintf(stderr,
+                     "Usage: %s --out FILE [--items N] [--seed S] "
+                     "[--threads T] [--words MEAN] [--duplicates R] "
+                     "[--done R] [--unicode R] [--tags R] [--priority R] "
+                     "[--due R] [--actions]\n",
+                     argv[0]);
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    ThreadPool pool(options->threads);
+    bool written = false;
+    if (options->actions) {
+        written = write_actions(*options, pool);
+    } else if (std::FILE* out = std::fopen(options->out.c_str(), "wb")) {
+        written = write_state(*options, pool, out);
+        written = std::fclose(out) == 0 && written;
+    }
+    if (!written) {
+        std::fprintf(stderr, "Could not write %s\n", options->out.c_str());
+        return 1;
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::printf("%zu items written to %s in %.2f s on %u threads\n",
+                options->items,
+                options->out.c_str(),
+                elapsed.count(),
+                pool.size());
+    return 0;
+}
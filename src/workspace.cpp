@@ -0,0 +1,643 @@
+#include "workspace.hpp"
+#include "archive.hpp"
+#include "list_diff.hpp"
+#include "persistence.hpp"
+
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <utility>
+
+namespace {
+
+constexpr const char* sidecar_name = "lists.meta"; // JSON, but not a list
+
+std::int64_t seconds_since_epoch()
+{
+    return std::chrono::duration_cast<std::chrono::seconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+// Of the lock the instances sharing a file take to append to it
+std::filesystem::path lock_path_of(std::filesystem::path path)
+{
+    path += ".lock";
+    return path;
+}
+
+// The reminders of an item and of its subtasks
+std::vector<Reminder> reminders_of(const TodoItem& item)
+{
+    std::vector<Reminder> reminders;
+    collect_reminders(TodoList{}.push_back(item), reminders);
+    return reminders;
+}
+
+// Takes `merged` as the main list of `state`, updating the indexes for what
+// the merge changed only; the due dates it brought in go to `reminders`
+void take_merged(AppState& state,
+                 TodoList merged,
+                 std::vector<Reminder>& reminders)
+{
+    const DueIndex scheduled = state.due_index;
+    const ListDiff diff      = diff_lists(state.todos, merged);
+    for (const ListEdit& edit : diff.edits) {
+        const TodoItem* before = edit.change == ListChange::Added
+                                     ? nullptr
+                                     : &state.todos[edit.before];
+        const TodoItem* after  = edit.change == ListChange::Removed
+                                     ? nullptr
+                                     : &merged[edit.after];
+        reindex_priority(state, 0, before, after);
+        if (before)
+            state.due_index = unindex_subtree(state.due_index, *before);
+        if (!after)
+            continue;
+        for (auto& reminder : reminders_of(*after)) {
+            state.due_index = state.due_index.insert(reminder);
+            if (!scheduled.contains(reminder))
+                reminders.push_back(std::move(reminder));
+        }
+    }
+    state.todos  = std::move(merged);
+    state.synced = state.todos;
+}
+
+// Takes `columns` as the board of `state`; the due dates of the columns are
+// indexed again if they changed
+void take_columns(AppState& state,
+                  immer::vector<BoardColumn> columns,
+                  std::vector<Reminder>& reminders)
+{
+    if (state.columns == columns)
+        return;
+    const DueIndex scheduled = state.due_index;
+    for (const auto& column : state.columns) {
+        for (const auto& item : column.items)
+            state.due_index = unindex_subtree(state.due_index, item);
+    }
+    std::vector<Reminder> due;
+    for (const auto& column : columns)
+        collect_reminders(column.items, due);
+    for (auto& reminder : due) {
+        state.due_index = state.due_index.insert(reminder);
+        if (!scheduled.contains(reminder))
+            reminders.push_back(std::move(reminder));
+    }
+    state.columns = std::move(columns);
+}
+
+} // namespace
+
+Workspace::Workspace(std::filesystem::path directory,
+                     std::size_t budget_items,
+                     std::int64_t archive_after,
+                     Persistence::Encoding encoding,
+                     bool shared)
+    : directory_(std::move(directory))
+    , budget_items_(budget_items)
+    , archive_after_(archive_after)
+    , encoding_(encoding)
+{
+    // The lists and their counts as of the last run
+    try {
+        std::ifstream in(directory_ / sidecar_name);
+        if (in) {
+            auto j  = nlohmann::json::parse(in);
+            active_ = j.value("active", active_);
+            for (std::uint32_t id :
+                 j.value("replicas", std::vector<std::uint32_t>{})) {
+                if (id != 0 && id >> Replica::replica_bits == 0)
+                    replica_ids_.push_back(id);
+            }
+            for (const auto& list : j.at("lists")) {
+                ListInfo info{list.at("name").get<std::string>(),
+                              list.value("items", -1),
+                              list.value("done", 0)};
+                if (valid_list_name(info.name))
+                    lists_.push_back(std::move(info));
+            }
+        }
+    } catch (const std::exception& e) {
+        spdlog::warn("Ignoring {}: {}", sidecar_name, e.what());
+        lists_.clear();
+        replica_ids_.clear();
+    }
+
+    // Lists it doesn't know about (it was lost, or files were copied in)
+    std::error_code error;
+    for (const auto& entry :
+         std::filesystem::directory_iterator(directory_, error)) {
+        const auto& path = entry.path();
+        std::string name = path.stem().string();
+        if (path.extension() != ".json" || !valid_list_name(name))
+            continue;
+        if (std::none_of(lists_.begin(), lists_.end(), [&](auto& list) {
+                return list.name == name;
+            }))
+            lists_.push_back(ListInfo{std::move(name)});
+    }
+
+    if (!valid_list_name(active_))
+        active_ = "todos";
+    for (const char* name : {"todos", active_.c_str()}) {
+        if (std::none_of(lists_.begin(), lists_.end(), [&](auto& list) {
+                return list.name == name;
+            }))
+            lists_.push_back(ListInfo{name});
+    }
+
+    // Shared, an instance takes the id of an earlier run that no running
+    // instance holds, so that its ops go on in the same files
+    if (shared) {
+        auto lock = [&](std::uint32_t id) {
+            replica_lock_.emplace(
+                lock_path_of(directory_ /
+                             (Replica::replica_name(id) + ".replica")),
+                false);
+            return replica_lock_->locked();
+        };
+        for (std::uint32_t id : replica_ids_) {
+            if (lock(id)) {
+                replica_ = id;
+                break;
+            }
+        }
+        if (replica_ == 0) {
+            while (replica_ == 0 || std::count(replica_ids_.begin(),
+                                               replica_ids_.end(),
+                                               replica_))
+                replica_ = Replica::new_replica_id();
+            lock(replica_);
+            replica_ids_.push_back(replica_);
+            write_sidecar();
+        }
+    }
+    spdlog::info("Workspace {}: {} lists, {} open",
+                 directory_.string(),
+                 lists_.size(),
+                 active_);
+    if (replica_ != 0)
+        spdlog::info("Shared, as replica {:06x}", replica_);
+}
+
+std::filesystem::path Workspace::path_of(const std::string& name) const
+{
+    return directory_ / (name + ".json");
+}
+
+std::filesystem::path Workspace::archive_path_of(const std::string& name) const
+{
+    return directory_ / (name + ".archive");
+}
+
+std::filesystem::path Workspace::history_path_of(const std::string& name) const
+{
+    return directory_ / (name + ".history");
+}
+
+std::filesystem::path
+Workspace::replicas_path_of(const std::string& name) const
+{
+    return directory_ / (name + ".replicas");
+}
+
+AppState Workspace::open_active()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto loaded = load(active_);
+    AppState state;
+    if (!loaded) {
+        state.status_message = "ERROR loading " + active_ + ", started empty.";
+    } else {
+        state = std::move(*loaded);
+        state.status_message = std::filesystem::exists(path_of(active_))
+                                   ? "State loaded."
+                                   : "Ready (new list).";
+    }
+    active_as_saved_ = state;
+    count(active_, state);
+    state.list_name = active_;
+    state.lists     = lists();
+    return state;
+}
+
+Workspace::Opened Workspace::open(const AppState& leaving,
+                                  const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string left = active_;
+
+    // The structure is shared with what was saved unless it was edited, so
+    // this is quick when nothing changed
+    bool changed = !(leaving.todos == active_as_saved_.todos &&
+                     leaving.columns == active_as_saved_.columns);
+    Saved saved;
+    if (changed && !write(leaving, &saved))
+        return {std::nullopt, lists(), "ERROR saving " + left + "."};
+
+    std::optional<AppState> state;
+    bool created = false;
+    if (auto at = cached_.find(name); at != cached_.end()) {
+        state = std::move(at->second->state);
+        cached_items_ -= state->todos.size();
+        cache_.erase(at->second);
+        cached_.erase(at);
+    } else {
+        created = !std::filesystem::exists(path_of(name));
+        state   = load(name);
+    }
+    if (!state)
+        return {std::nullopt, lists(), "ERROR loading " + name + "."};
+
+    std::string message = (created ? "Created " : "Opened ") + name + ".";
+    if (changed)
+        message = "Saved " + left + ". " + message;
+    keep(std::move(left), saved.merged ? std::move(*saved.merged) : leaving);
+    active_          = name;
+    active_as_saved_ = *state;
+    count(name, *state);
+    write_sidecar();
+    return {std::move(state), lists(), std::move(message)};
+}
+
+Workspace::Saved Workspace::save(const AppState& state)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    Saved saved;
+    if (!write(state, &saved))
+        return saved;
+    if (state.list_name == active_)
+        active_as_saved_ = saved.merged ? *saved.merged : state;
+    write_sidecar();
+    saved.ok = true;
+    return saved;
+}
+
+std::optional<AppState> Workspace::reload(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    note_time(name);
+    auto state = Persistence::load_state(path_of(name));
+    if (state && replica_ != 0)
+        state->next_id = Replica::next_id(*state, replica_);
+    if (state && name == active_) {
+        active_as_saved_ = *state;
+        count(name, *state);
+    }
+    return state;
+}
+
+std::optional<Workspace::ChangedOnDisk> Workspace::reload_if_changed()
+{
+    std::string name;
+    std::filesystem::file_time_type time;
+    std::error_code error;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (replica_ != 0)
+            return std::nullopt;
+        name = active_;
+        time = std::filesystem::last_write_time(path_of(name), error);
+        if (error || time == times_[name])
+            return std::nullopt;
+    }
+
+    // Saves go on while it is read
+    auto loaded = Persistence::load_state(path_of(name));
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!loaded || name != active_)
+        return std::nullopt;
+    // Written again meanwhile, by this program (which knows what it wrote)
+    // or by another one (and then the next change is for that)
+    if (std::filesystem::last_write_time(path_of(name), error) != time ||
+        error)
+        return std::nullopt;
+    times_[name] = time;
+    if (loaded->todos == active_as_saved_.todos &&
+        loaded->columns == active_as_saved_.columns)
+        return std::nullopt;
+
+    spdlog::info("{} was changed on disk", name);
+    ChangedOnDisk changed{name, active_as_saved_, active_as_saved_, {}};
+    take_merged(changed.after, std::move(loaded->todos), changed.reminders);
+    take_columns(changed.after, std::move(loaded->columns), changed.reminders);
+    changed.after.next_id = std::max(changed.after.next_id, loaded->next_id);
+    return changed;
+}
+
+void Workspace::took_change(const std::string& name, const AppState& on_disk)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (name != active_)
+        return;
+    active_as_saved_ = on_disk;
+    count(name, on_disk);
+}
+
+std::optional<std::vector<std::uint64_t>>
+Workspace::archive(const AppState& state, std::int64_t now)
+{
+    std::vector<std::uint64_t> ids;
+    if (archive_after_ <= 0)
+        return ids;
+    std::vector<TodoItem> items;
+    for (const auto& item : state.todos) {
+        if (item.done && item.done_at != 0 &&
+            item.done_at <= now - archive_after_) {
+            items.push_back(item);
+            ids.push_back(item.id);
+        }
+    }
+    if (items.empty())
+        return ids;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    spdlog::debug("Archiving {} items of {}", items.size(), state.list_name);
+    const auto path = archive_path_of(state.list_name);
+    // Shared, other instances append to the same archive: one at a time, or
+    // one could take another's segment being written for one cut short
+    std::optional<Persistence::FileLock> shared;
+    if (replica_ != 0) {
+        shared.emplace(lock_path_of(path));
+        if (!shared->locked()) {
+            spdlog::error("Could not lock {}", path.string());
+            return std::nullopt;
+        }
+    }
+    if (!Archive::append(path, items))
+        return std::nullopt;
+    return ids;
+}
+
+std::optional<AppState> Workspace::load(const std::string& name)
+{
+    auto path                     = path_of(name);
+    std::optional<AppState> state = AppState{};
+    if (std::filesystem::exists(path)) {
+        spdlog::debug("Loading list {} from {}", name, path.string());
+        note_time(name);
+        state = Persistence::load_state(path);
+    }
+    if (state && replica_ != 0)
+        state->next_id = Replica::next_id(*state, replica_);
+    return state;
+}
+
+bool Workspace::write(const AppState& state, Saved* saved)
+{
+    spdlog::debug("Saving list {}", state.list_name);
+    const AppState* written = &state;
+    AppState merged;
+    std::vector<Reminder> reminders;
+    if (replica_ != 0) {
+        // Unmerged, the edits are saved in the file alone, and merged with
+        // the next save (`synced` stays as it was)
+        auto [replicas, added] = replicas_.try_emplace(
+            state.list_name,
+            replicas_path_of(state.list_name),
+            replica_,
+            encoding_);
+        auto todos = replicas->second.sync(state.synced, state.todos);
+        if (todos) {
+            merged = state;
+            take_merged(merged, std::move(*todos), reminders);
+            written = &merged;
+        } else {
+            spdlog::error("Could not merge {} with the other instances",
+                          state.list_name);
+        }
+    }
+
+    auto path = path_of(state.list_name);
+    if (replica_ == 0) {
+        if (!Persistence::save_state(path, *written, encoding_))
+            return false;
+    } else {
+        // Other instances write the file too, and read it: each writes a
+        // file of its own and renames it over the list, so that the list
+        // is always someone's whole save
+        auto temporary = path;
+        temporary += "." + std::to_string(replica_) + ".tmp";
+        std::error_code error;
+        if (!Persistence::save_state(temporary, *written, encoding_))
+            return false;
+        std::filesystem::rename(temporary, path, error);
+        if (error) {
+            spdlog::error("Could not replace {}: {}",
+                          path.string(),
+                          error.message());
+            std::filesystem::remove(temporary, error);
+            return false;
+        }
+    }
+    note_time(state.list_name);
+    count(state.list_name, *written);
+
+    // The list file is saved either way, the history only misses a version.
+    // Shared, the instances take turns appending to it.
+    auto [history, added] = histories_.try_emplace(
+        state.list_name, history_path_of(state.list_name));
+    std::optional<Persistence::FileLock> shared;
+    if (replica_ != 0)
+        shared.emplace(lock_path_of(history->second.path()));
+    if ((shared && !shared->locked()) ||
+        !history->second.append(*written, seconds_since_epoch()))
+        spdlog::error("Could not add to the history of {}", state.list_name);
+    if (saved && written == &merged) {
+        saved->merged    = std::move(merged);
+        saved->reminders = std::move(reminders);
+    }
+    return true;
+}
+
+// Taken before reading the file, so that a write while it is read makes it
+// look changed and is read again
+void Workspace::note_time(const std::string& name)
+{
+    std::error_code error;
+    auto time = std::filesystem::last_write_time(path_of(name), error);
+    if (!error)
+        times_[name] = time;
+}
+
+// Lists that were left stay in memory up to the budget; the least recently
+// used go first
+void Workspace::keep(std::string name, AppState state)
+{
+    cached_items_ += state.todos.size();
+    cache_.push_front(Cached{name, std::move(state)});
+    cached_[std::move(name)] = cache_.begin();
+    while (cached_items_ > budget_items_ && !cache_.empty()) {
+        const Cached& cold = cache_.back();
+        spdlog::debug("Dropping list {} from memory", cold.name);
+        cached_items_ -= cold.state.todos.size();
+        cached_.erase(cold.name);
+        cache_.pop_back();
+    }
+}
+
+void Workspace::count(const std::string& name, const AppState& state)
+{
+    auto at = std::find_if(lists_.begin(), lists_.end(), [&](auto& list) {
+        return list.name == name;
+    });
+    if (at == lists_.end())
+        at = lists_.insert(lists_.end(), ListInfo{name});
+    at->items = static_cast<int>(state.todos.size());
+    at->done  = static_cast<int>(std::count_if(
+        state.todos.begin(), state.todos.end(), [](const TodoItem& item) {
+            return item.done;
+        }));
+}
+
+immer::vector<ListInfo> Workspace::lists() const
+{
+    return immer::vector<ListInfo>(lists_.begin(), lists_.end());
+}
+
+void Workspace::write_sidecar() const
+{
+    nlohmann::json lists = nlohmann::json::array();
+    for (const auto& list : lists_)
+        lists.push_back(
+            {{"name", list.name}, {"items", list.items}, {"done", list.done}});
+    std::ofstream out(directory_ / sidecar_name);
+    out << nlohmann::json{{"active", active_},
+                          {"lists", std::move(lists)},
+                          {"replicas", replica_ids_}}
+               .dump(4);
+    if (!out)
+        spdlog::warn("Could not write {}", sidecar_name);
+}
+
+// --- Effects ---
+
+AppEffect save_effect(AppState state_to_save)
+{
+    return [state_to_save](lager::context<Action> ctx) {
+        TraceScope traced{"save", "effect"};
+        if (!global_workspace) {
+            spdlog::error("Save effect failed: Workspace not initialized!");
+            ctx.dispatch(SetStatusAction{"ERROR: Save path not configured."});
+            return;
+        }
+        spdlog::debug("Executing save effect for {}", state_to_save.list_name);
+        auto saved   = global_workspace->save(state_to_save);
+        bool success = saved.ok;
+        std::string msg =
+            success ? "State saved successfully." : "ERROR saving state!";
+        if (success)
+            spdlog::info("Save successful.");
+        else
+            spdlog::error("Save failed.");
+        ctx.dispatch(SetStatusAction{msg});
+        if (saved.merged)
+            ctx.dispatch(ListMergedAction{state_to_save.list_name,
+                                          state_to_save,
+                                          std::move(saved.merged),
+                                          std::move(saved.reminders)});
+    };
+}
+
+AppEffect load_effect(std::string name)
+{
+    return [name](lager::context<Action> ctx) {
+        TraceScope traced{"load", "effect"};
+        if (!global_workspace) {
+            spdlog::error("Load effect failed: Workspace not initialized!");
+            ctx.dispatch(LoadCompleteAction{
+                std::nullopt, "ERROR: Load path not configured."});
+            return;
+        }
+        spdlog::debug("Executing load effect for {}", name);
+        auto loaded_state_opt = global_workspace->reload(name);
+        std::string msg;
+        if (loaded_state_opt) {
+            msg = "State loaded successfully.";
+            spdlog::info("Load successful.");
+        } else {
+            msg = "ERROR loading state or file not found.";
+            spdlog::warn("Load failed or file not found.");
+        }
+        ctx.dispatch(LoadCompleteAction{loaded_state_opt, msg});
+    };
+}
+
+AppEffect
+open_list_effect(AppState leaving, std::string name, std::uint64_t select_id)
+{
+    return [leaving, name, select_id](lager::context<Action> ctx) {
+        TraceScope traced{"open list", "effect"};
+        if (!global_workspace) {
+            spdlog::error("Open list effect failed: Workspace not "
+                          "initialized!");
+            ctx.dispatch(SetStatusAction{"ERROR: Workspace not configured."});
+            return;
+        }
+        auto opened = global_workspace->open(leaving, name);
+        spdlog::info("{}", opened.message);
+        bool loaded = opened.state.has_value();
+        ctx.dispatch(ListOpenedAction{std::move(name),
+                                      std::move(opened.lists),
+                                      std::move(opened.state),
+                                      std::move(opened.message),
+                                      select_id});
+        // Lists are archived as they are opened
+        if (loaded)
+            ctx.dispatch(ArchiveDoneAction{seconds_since_epoch()});
+    };
+}
+
+AppEffect took_change_effect(std::string name, AppState on_disk)
+{
+    return [name, on_disk](lager::context<Action>) {
+        if (global_workspace)
+            global_workspace->took_change(name, on_disk);
+    };
+}
+
+AppState merge_changed_lists(const AppState& state,
+                             const AppState& before,
+                             const AppState& after,
+                             std::vector<Reminder>& reminders)
+{
+    // Both sides' edits are replayed as replicas of `before` (see
+    // replica.hpp), the file's first, so that ours come later and win
+    Replica::Document theirs(1, before.todos);
+    Replica::Document ours(2, before.todos);
+    ours.apply(theirs.update(before.todos, after.todos));
+    ours.update(before.todos, state.todos);
+
+    AppState merged = state;
+    take_merged(merged, ours.items(), reminders);
+    merged.synced = state.synced;
+    // Columns aren't merged item by item: the file's are taken unless they
+    // were edited here too
+    if (state.columns == before.columns)
+        take_columns(merged, after.columns, reminders);
+    merged.next_id = std::max(state.next_id, after.next_id);
+    return merged;
+}
+
+AppEffect archive_effect(AppState state, std::int64_t now)
+{
+    return [state, now](lager::context<Action> ctx) {
+        TraceScope traced{"archive", "effect"};
+        if (!global_workspace) {
+            spdlog::error("Archive effect failed: Workspace not initialized!");
+            return;
+        }
+        auto ids = global_workspace->archive(state, now);
+        if (!ids)
+            ctx.dispatch(SetStatusAction{"ERROR archiving done items!"});
+        else if (!ids->empty())
+            ctx.dispatch(ArchivedAction{state.list_name, std::move(*ids)});
+    };
+}
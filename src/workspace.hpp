@@ -0,0 +1,148 @@
+#pragma once
+
+#include "history.hpp"     // History::Store
+#include "persistence.hpp" // Persistence::Encoding
+#include "replica.hpp"     // Replica::Shared
+#include "state.hpp"       // AppState, ListInfo
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Several lists (one per project, say), each in a file of its own in one
+// directory: "todos.json" is the default list, "<name>.json" the others.
+// Only the list shown is in the store. The others are kept in memory once
+// opened, most recently used first, until together they go over a budget of
+// items; past that the least recently used are dropped and only known again
+// by their name and counts, from the sidecar file "lists.meta", until they
+// are opened again.
+//
+// Leaving a list saves it if it changed, so what is kept in memory is always
+// what is on disk and dropping it loses nothing.
+//
+// Done items that have been done for long enough are moved out of a list's
+// file to its archive, "<name>.archive" (see archive.hpp), which is not
+// loaded with the list.
+//
+// Every version saved is also added to the list's history, "<name>.history"
+// (see history.hpp), which keeps them all at the cost of what changed.
+//
+// Shared (--shared), several instances of the app can edit the same lists at
+// once: saving a list merges its edits with theirs, through "<name>.replicas"
+// (see replica.hpp), rather than overwriting them. The list file is then
+// replaced whole, written aside and renamed over it, and the history and
+// archive all of them append to are appended to holding "<file>.lock". An
+// instance is the same replica from one run to the next: the ids of the
+// runs so far are kept in "lists.meta", and each run takes one that no
+// running instance holds ("<replica>.replica.lock").
+//
+// Used by the effects, from whichever thread reduces. Thread-safe.
+class Workspace
+{
+public:
+    // Done items are archived once they have been done for `archive_after`
+    // seconds, or never if it is 0. Lists are saved in `encoding`, and
+    // loaded whichever they were saved in.
+    Workspace(std::filesystem::path directory,
+              std::size_t budget_items,
+              std::int64_t archive_after,
+              Persistence::Encoding encoding = Persistence::Encoding::Json,
+              bool shared                    = false);
+
+    const std::filesystem::path& directory() const { return directory_; }
+    std::filesystem::path path_of(const std::string& name) const;
+    std::filesystem::path archive_path_of(const std::string& name) const;
+    std::filesystem::path history_path_of(const std::string& name) const;
+    std::filesystem::path replicas_path_of(const std::string& name) const;
+
+    // The list that was shown last time, as loaded from its file; an empty
+    // one if it has no file yet or it can't be read (see status_message)
+    AppState open_active();
+
+    struct Opened
+    {
+        std::optional<AppState> state; // Nullopt if it couldn't be read
+        immer::vector<ListInfo> lists;
+        std::string message;
+    };
+    // Leaves `leaving`, the list shown, for the list `name`, which is
+    // created (empty) if there is no such list yet
+    Opened open(const AppState& leaving, const std::string& name);
+
+    struct Saved
+    {
+        bool ok = false;
+        // Shared, what was written once merged with the others' edits, and
+        // the due dates they brought in
+        std::optional<AppState> merged;
+        std::vector<Reminder> reminders;
+    };
+    // Writes the list `state` is to its file
+    Saved save(const AppState& state);
+    // The list shown, from its file again (edits since it was saved are
+    // dropped). Nullopt if it has no file or it can't be read.
+    std::optional<AppState> reload(const std::string& name);
+
+    struct ChangedOnDisk
+    {
+        std::string name;
+        AppState before; // As last loaded or saved
+        AppState after;  // As the file now has it, indexed
+        std::vector<Reminder> reminders; // Due dates the change brought in
+    };
+    // The list shown, read again if its file was written by another program
+    // since it was last loaded or saved. Only what changed is indexed, so
+    // past reading the file this costs what changed. Nullopt if it wasn't
+    // changed or can't be read, and always when shared: the other
+    // instances' edits come through the replicas.
+    std::optional<ChangedOnDisk> reload_if_changed();
+    // The app took the change reload_if_changed found, which made the list
+    // `on_disk`: leaving it compares with that from now on
+    void took_change(const std::string& name, const AppState& on_disk);
+
+    // Appends the top-level done items of `state` that were done long enough
+    // before `now` to its list's archive. Their ids, for the reducer to drop
+    // them; nullopt if they couldn't be written.
+    std::optional<std::vector<std::uint64_t>> archive(const AppState& state,
+                                                      std::int64_t now);
+
+private:
+    struct Cached
+    {
+        std::string name;
+        AppState state;
+    };
+
+    // An empty list if `name` has no file yet
+    std::optional<AppState> load(const std::string& name);
+    bool write(const AppState& state, Saved* saved = nullptr);
+    void note_time(const std::string& name); // Of the file, loaded or saved
+    void keep(std::string name, AppState state);
+    void count(const std::string& name, const AppState& state);
+    immer::vector<ListInfo> lists() const;
+    void write_sidecar() const;
+
+    mutable std::mutex mutex_;
+    std::filesystem::path directory_;
+    std::size_t budget_items_;
+    std::int64_t archive_after_;
+    Persistence::Encoding encoding_;
+    std::vector<ListInfo> lists_;  // In the order of the tabs
+    std::string active_ = "todos";
+    AppState active_as_saved_;     // To tell whether leaving it must save
+    std::list<Cached> cache_;      // Most recently used first
+    std::unordered_map<std::string, std::list<Cached>::iterator> cached_;
+    std::size_t cached_items_ = 0;
+    std::unordered_map<std::string, History::Store> histories_;
+    std::unordered_map<std::string, std::filesystem::file_time_type> times_;
+    std::uint32_t replica_ = 0; // Of this instance, if shared
+    std::vector<std::uint32_t> replica_ids_; // Of the runs so far
+    std::optional<Persistence::FileLock> replica_lock_; // On replica_
+    std::unordered_map<std::string, Replica::Shared> replicas_;
+};